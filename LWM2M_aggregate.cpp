@@ -0,0 +1,179 @@
+/*
+LWM2M reporting window statistics
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_aggregate.h"
+#include <string.h>
+
+void LWM2M_aggregate_reset(LWM2M_aggregate *a)
+{
+    memset(a, 0, sizeof(*a));
+}
+
+void LWM2M_aggregate_add(LWM2M_aggregate *a, float s)
+{
+    if (s != s){
+        return; // NaN
+    }
+    if (a->count == 0){
+        a->min = a->max = s;
+    }
+    else{
+        a->min = (s < a->min) ? s : a->min;
+        a->max = (s > a->max) ? s : a->max;
+    }
+    a->count++;
+    float delta = s - a->mean;
+    a->mean += delta / a->count;
+    a->m2 += delta * (s - a->mean);
+}
+
+/*
+count, sum, min and max of the block in one pass, the squared deviations
+from its mean in a second, then merged with the window so far
+*/
+void LWM2M_aggregate_add_block(LWM2M_aggregate *a, const float *samples, int count)
+{
+    uint32_t n = 0;
+    float sum = 0, min = 0, max = 0;
+    int i = 0;
+
+    for (; i < count && samples[i] != samples[i]; i++){
+        // leading NaN
+    }
+    if (i == count){
+        return;
+    }
+    min = max = samples[i];
+    for (; i < count; i++){
+        float s = samples[i];
+        bool number = (s == s);
+        n += number;
+        sum += number ? s : 0;
+        min = (s < min) ? s : min;
+        max = (s > max) ? s : max;
+    }
+    float mean = sum / n, m2 = 0;
+    for (i = 0; i < count; i++){
+        float deviation = samples[i] - mean;
+        m2 += (samples[i] == samples[i]) ? deviation * deviation : 0;
+    }
+
+    if (a->count == 0){
+        a->count = n;
+        a->min = min;
+        a->max = max;
+        a->mean = mean;
+        a->m2 = m2;
+        return;
+    }
+    uint32_t total = a->count + n;
+    float delta = mean - a->mean;
+    a->m2 += m2 + delta * delta * ((float)a->count * n / total);
+    a->mean += delta * n / total;
+    a->count = total;
+    a->min = (min < a->min) ? min : a->min;
+    a->max = (max > a->max) ? max : a->max;
+}
+
+float LWM2M_aggregate_variance(const LWM2M_aggregate *a)
+{
+    return a->count ? a->m2 / a->count : 0;
+}
+
+void LWM2M_sketch_reset(LWM2M_sketch *sketch)
+{
+    sketch->count = 0;
+    sketch->skip = 0;
+    sketch->stride = 1;
+}
+
+void LWM2M_sketch_add(LWM2M_sketch *sketch, float s)
+{
+#if LWM2M_SKETCH_SIZE
+    if (s != s){
+        return;
+    }
+    if (sketch->skip){
+        sketch->skip--;
+        return;
+    }
+    sketch->values[sketch->count++] = s;
+    sketch->skip = sketch->stride - 1;
+    if (sketch->count == LWM2M_SKETCH_SIZE){
+        // keep every other one, the next kept sample is still stride after
+        // the last kept one, which is dropped, so the spacing doubles
+        for (int i = 0; i < LWM2M_SKETCH_SIZE / 2; i++){
+            sketch->values[i] = sketch->values[2 * i];
+        }
+        sketch->count = LWM2M_SKETCH_SIZE / 2;
+        if (sketch->stride < 0x80000000u){
+            sketch->stride *= 2;
+        }
+    }
+#else
+    (void)sketch;
+    (void)s;
+#endif
+}
+
+bool LWM2M_sketch_quantile(const LWM2M_sketch *sketch, float q, float *value)
+{
+#if LWM2M_SKETCH_SIZE
+    float sorted[LWM2M_SKETCH_SIZE];
+    int n = sketch->count;
+    if (n == 0){
+        return false;
+    }
+    // insertion sort, there are few
+    for (int i = 0; i < n; i++){
+        float s = sketch->values[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > s; j--){
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = s;
+    }
+    q = (q < 0) ? 0 : (q > 1) ? 1 : q;
+    *value = sorted[(int)(q * (n - 1) + 0.5f)];
+    return true;
+#else
+    (void)sketch;
+    (void)q;
+    (void)value;
+    return false;
+#endif
+}
+
+bool LWM2M_statistic(const LWM2M_aggregate *a, const LWM2M_sketch *sketch, uint8_t statistic, float *value)
+{
+    if (a->count == 0){
+        return false;
+    }
+    switch (statistic){
+    case LWM2M_STAT_MIN: *value = a->min; return true;
+    case LWM2M_STAT_MAX: *value = a->max; return true;
+    case LWM2M_STAT_MEAN: *value = a->mean; return true;
+    case LWM2M_STAT_VARIANCE: *value = LWM2M_aggregate_variance(a); return true;
+    case LWM2M_STAT_COUNT: *value = (float)a->count; return true;
+    case LWM2M_STAT_P10: return sketch && LWM2M_sketch_quantile(sketch, 0.1f, value);
+    case LWM2M_STAT_MEDIAN: return sketch && LWM2M_sketch_quantile(sketch, 0.5f, value);
+    case LWM2M_STAT_P90: return sketch && LWM2M_sketch_quantile(sketch, 0.9f, value);
+    default: return false;
+    }
+}
@@ -0,0 +1,94 @@
+/*
+LWM2M reporting window statistics
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Statistics of the samples an observation saw since its last notification,
+so that a long pmax still tells the server about the excursions in between.
+
+LWM2M_aggregate keeps count, min, max, mean and the sum of squared
+deviations (Welford), O(1) per sample and stable where a plain sum of
+squares cancels out. A block of samples is summed up on its own and merged
+in (Chan et al.), which keeps the loop over the block free of divisions.
+NaN samples are not counted.
+
+LWM2M_sketch keeps percentiles of the window in fixed memory: every
+sample until LWM2M_SKETCH_SIZE are kept, then every other one is dropped
+and from then on only every 2nd sample is kept, then every 4th, and so on.
+What is kept is an evenly spaced sample of the whole window, a percentile
+of it is off by at most the spacing in rank. Adding is O(1), a percentile
+sorts a copy of the kept samples.
+*/
+
+#ifndef LWM2M_AGGREGATE_H
+#define LWM2M_AGGREGATE_H
+
+#include <stdint.h>
+
+// samples kept by a sketch, an even number, 0 leaves the percentiles out
+#ifndef LWM2M_SKETCH_SIZE
+#define LWM2M_SKETCH_SIZE 16
+#endif
+#if LWM2M_SKETCH_SIZE % 2
+#error "LWM2M_SKETCH_SIZE is to be even"
+#endif
+
+// statistics reported along with the value, bits of LWM2M_attributes.statistics
+#define LWM2M_STAT_MIN       0x01
+#define LWM2M_STAT_MAX       0x02
+#define LWM2M_STAT_MEAN      0x04
+#define LWM2M_STAT_VARIANCE  0x08
+#define LWM2M_STAT_COUNT     0x10
+#define LWM2M_STAT_P10       0x20 // percentiles, from the sketch
+#define LWM2M_STAT_MEDIAN    0x40
+#define LWM2M_STAT_P90       0x80
+#define LWM2M_STAT_PERCENTILES (LWM2M_STAT_P10 | LWM2M_STAT_MEDIAN | LWM2M_STAT_P90)
+#define LWM2M_STATISTICS     8 // number of the above
+
+struct LWM2M_aggregate {
+    uint32_t count;
+    float min, max;
+    float mean;
+    float m2; // sum of squared deviations from the mean
+};
+
+struct LWM2M_sketch {
+    float values[LWM2M_SKETCH_SIZE ? LWM2M_SKETCH_SIZE : 1];
+    uint32_t count; // samples kept
+    uint32_t skip; // samples to drop before the next one is kept
+    uint32_t stride; // every stride-th sample is kept
+};
+
+void LWM2M_aggregate_reset(LWM2M_aggregate *a);
+void LWM2M_aggregate_add(LWM2M_aggregate *a, float s);
+void LWM2M_aggregate_add_block(LWM2M_aggregate *a, const float *samples, int count);
+
+// variance of the samples, 0 for none
+float LWM2M_aggregate_variance(const LWM2M_aggregate *a);
+
+void LWM2M_sketch_reset(LWM2M_sketch *sketch);
+void LWM2M_sketch_add(LWM2M_sketch *sketch, float s);
+
+// q-th quantile, q in [0, 1], of the kept samples, false if none is kept
+bool LWM2M_sketch_quantile(const LWM2M_sketch *sketch, float q, float *value);
+
+/*
+one statistic (LWM2M_STAT_*) of the window, false if the window has no
+samples or the statistic is not kept. sketch may be NULL.
+*/
+bool LWM2M_statistic(const LWM2M_aggregate *a, const LWM2M_sketch *sketch, uint8_t statistic, float *value);
+
+#endif // LWM2M_AGGREGATE_H
@@ -0,0 +1,1605 @@
+/*
+LWM2M attribute engine benchmark
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Host benchmark for the notification attribute engine, not part of the
+mbed build. Build on Linux with
+
+  g++ -O2 -std=c++11 -pthread -o lwm2m_bench LWM2M_bench.cpp LWM2M_replay.cpp \
+      LWM2M_host.cpp LWM2M_sensor.cpp LWM2M_resource_attributes.cpp \
+      LWM2M_timer_wheel.cpp LWM2M_notify_queue.cpp LWM2M_confirm.cpp \
+      LWM2M_coalesce.cpp LWM2M_payload.cpp LWM2M_pmax_schedule.cpp \
+      LWM2M_sample_plan.cpp LWM2M_registry.cpp LWM2M_response_cache.cpp \
+      LWM2M_persist.cpp LWM2M_aggregate.cpp LWM2M_histogram.cpp LWM2M_log.cpp
+
+and run
+
+  ./lwm2m_bench                 synthetic traces
+  ./lwm2m_bench trace.csv       a recorded trace, "time_ms,value" lines
+  ./lwm2m_bench queue           threaded stress run of LWM2M_notify_queue
+  ./lwm2m_bench wheel           LWM2M_timer_wheel expiries and next across the ms clock wrap
+  ./lwm2m_bench bands           band lookup for 2 to MAX_LIMITS limits
+  ./lwm2m_bench batch           on_update_batch against on_update, 1 kHz traces
+  ./lwm2m_bench link            LWM2M_confirm over a simulated lossy link
+  ./lwm2m_bench coalesce        packets and bytes saved by LWM2M_coalesce windows
+  ./lwm2m_bench fleet           server arrival rate of 100k devices per pmax schedule
+  ./lwm2m_bench energy          sensor reads and energy of planned against fixed sampling
+  ./lwm2m_bench eval            evaluations, reads and notifications under epmin and epmax
+  ./lwm2m_bench stats           excursions missed at a long pmax with and without window statistics
+  ./lwm2m_bench hysteresis      band change notifications of noisy traces under pmin, hysteresis and dwell
+  ./lwm2m_bench cache           dashboard GETs encoded each time against LWM2M_response_cache
+  ./lwm2m_bench blocks          Block2 transfers resumed by LWM2M_encode_block against restarted
+  ./lwm2m_bench persist [file]  LWM2M_persist log writes, restore time and resets during writes
+  ./lwm2m_bench metrics         engine counters, LWM2M_histogram accuracy and LWM2M_log cost
+
+Add -mavx2 to use the AVX2 path of on_update_batch, SSE2 is the x86-64 default.
+
+Each trace is replayed for every combination of the attribute sets below.
+Per run it prints evaluations per second of wall clock time, notifications
+sent by cause, and p50/p99 trigger latency in simulated ms. Keep the output
+of a baseline and compare the notification counts after a change, a
+different count for the same trace and attributes is a behavior change.
+*/
+
+#include "LWM2M_replay.h"
+#include "LWM2M_host.h"
+#include "LWM2M_notify_queue.h"
+#include "LWM2M_confirm.h"
+#include "LWM2M_coalesce.h"
+#include "LWM2M_payload.h"
+#include "LWM2M_registry.h"
+#include "LWM2M_response_cache.h"
+#include "LWM2M_sensor.h"
+#include "LWM2M_persist.h"
+#include "LWM2M_histogram.h"
+#include "LWM2M_log.h"
+#include "LWM2M_timer_wheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define BENCH_MAX_POINTS 100000
+#define BENCH_OBSERVERS 8
+
+static LWM2M_trace_point trace[BENCH_MAX_POINTS];
+static LWM2M_replay_stats stats;
+
+// attribute combinations, a step or limit of 1e9 never triggers
+static const LWM2M_attributes bench_attributes[] = {
+    // gt      lt     step  pmin   pmax   epmin epmax stat hyst dwell no limits
+    {75.0f, 25.0f,  0.0f,  0.0f,  0.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}, // every change
+    {75.0f, 25.0f,  1.0f,  0.0f,  0.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}},
+    {75.0f, 25.0f, 10.0f,  0.0f, 60.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}},
+    {75.0f, 25.0f, 10.0f,  1.0f, 60.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}},
+    {75.0f, 25.0f, 10.0f, 10.0f, 60.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}, // defaults
+    {1e9f, -1e9f,   5.0f, 10.0f,  0.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}, // step only
+    {75.0f, 25.0f,  1e9f,  0.0f,  0.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}, // bands only
+    {75.0f, 25.0f,  1e9f, 30.0f, 300.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}},
+};
+
+struct bench_trace {
+    const char *name;
+    int shape;
+    uint32_t period_ms;
+    uint32_t interval_ms;
+};
+
+// one hour at 100 ms sampling each
+static const bench_trace bench_traces[] = {
+    {"sine 60s", LWM2M_TRACE_SINE, 60000, 100},
+    {"ramp 10min", LWM2M_TRACE_RAMP, 600000, 100},
+    {"square 20s", LWM2M_TRACE_SQUARE, 20000, 100},
+    {"walk", LWM2M_TRACE_WALK, 30000, 100},
+};
+
+static double wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void bench_header(void)
+{
+    printf("%-12s %6s %6s %5s %5s %5s %12s %6s %5s %5s %5s %5s %6s %6s\n",
+        "trace", "gt", "lt", "step", "pmin", "pmax", "eval/s", "notif", "step", "band",
+        "pmin", "pmax", "p50ms", "p99ms");
+}
+
+static void bench_trace_run(const char *name, int num_points)
+{
+    for (unsigned a = 0; a < sizeof(bench_attributes) / sizeof(bench_attributes[0]); a++){
+        const LWM2M_attributes *attr = &bench_attributes[a];
+        double start = wall_seconds();
+        LWM2M_replay_run(attr, BENCH_OBSERVERS, trace, num_points, &stats);
+        double elapsed = wall_seconds() - start;
+        uint32_t p50 = LWM2M_replay_percentile(&stats, 50);
+        uint32_t p99 = LWM2M_replay_percentile(&stats, 99);
+        printf("%-12s %6g %6g %5g %5g %5g %12.0f %6u %5u %5u %5u %5u %6u %6u\n",
+            name, attr->gt, attr->lt, attr->step, attr->pmin, attr->pmax,
+            elapsed > 0 ? stats.evaluations / elapsed : 0.0, stats.notifications,
+            stats.by_cause[LWM2M_CAUSE_STEP], stats.by_cause[LWM2M_CAUSE_BAND],
+            stats.by_cause[LWM2M_CAUSE_PMIN], stats.by_cause[LWM2M_CAUSE_PMAX], p50, p99);
+    }
+}
+
+/*
+the band lookup before MAX_LIMITS was configurable, the reference for
+bench_bands: early exit linear scan over the limits in use
+*/
+static int band_linear(const sample *limits, int num_limits, sample s)
+{
+    if (s > limits[num_limits - 1]){
+        return num_limits;
+    }
+    for (int limit = 0; limit < num_limits; limit++){
+        if (s <= limits[limit]){
+            return limit;
+        }
+    }
+    return -1;
+}
+
+/*
+classify the synthetic walk with the linear scan, band() per sample and
+band_batch, checking that all three agree
+*/
+static int bench_bands(void)
+{
+    static int8_t bands[BENCH_MAX_POINTS];
+    static sample samples[BENCH_MAX_POINTS];
+    const int rounds = 20;
+    int failed = 0;
+
+    int num_points = LWM2M_trace_synth(LWM2M_TRACE_WALK, 0.0f, 100.0f, 3000, 100, 7, trace, BENCH_MAX_POINTS);
+    for (int i = 0; i < num_points; i++){
+        samples[i] = trace[i].value;
+    }
+    printf("%6s %14s %14s %14s\n", "limits", "linear/s", "band/s", "batch/s");
+    for (int num_limits = 2; num_limits <= MAX_LIMITS; num_limits *= 2){
+        sample limits[MAX_LIMITS];
+        for (int limit = 0; limit < num_limits; limit++){
+            limits[limit] = 100.0f * (limit + 1) / (num_limits + 1);
+        }
+        LWM2M_obs_table_init();
+        LWM2M_attributes attr = *LWM2M_resource_get_attributes(0);
+        LWM2M_attributes_set_limits(&attr, limits, num_limits);
+        LWM2M_resource_set_attributes(0, &attr);
+        uint8_t token = 0;
+        int obs = LWM2M_obs_create(0, &token, sizeof(token));
+
+        volatile int sink = 0;
+        double start = wall_seconds();
+        for (int round = 0; round < rounds; round++){
+            for (int i = 0; i < num_points; i++){
+                sink += band_linear(limits, num_limits, samples[i]);
+            }
+        }
+        double linear = wall_seconds() - start;
+
+        start = wall_seconds();
+        for (int round = 0; round < rounds; round++){
+            for (int i = 0; i < num_points; i++){
+                sink += band(obs, samples[i]);
+            }
+        }
+        double single = wall_seconds() - start;
+
+        start = wall_seconds();
+        for (int round = 0; round < rounds; round++){
+            band_batch(obs, samples, bands, num_points);
+            sink += bands[round];
+        }
+        double batch = wall_seconds() - start;
+
+        for (int i = 0; i < num_points; i++){
+            int expected = band_linear(limits, num_limits, samples[i]);
+            if (band(obs, samples[i]) != expected || bands[i] != expected){
+                failed = 1;
+            }
+        }
+        double evaluated = (double)rounds * num_points;
+        printf("%6d %14.0f %14.0f %14.0f %s\n", num_limits, evaluated / linear, evaluated / single,
+            evaluated / batch, failed ? "MISMATCH" : "");
+    }
+    return failed;
+}
+
+/*
+replay 1 kHz traces in blocks of 256 samples, evaluated a sample at a time
+and with on_update_batch, the notifications must be identical
+*/
+static int bench_batch(void)
+{
+    const int block_size = 256;
+    int failed = 0;
+
+    printf("%-12s %5s %5s %5s %12s %12s %6s\n", "trace", "step", "pmin", "pmax", 
+        "scalar/s", "batch/s", "notif");
+    for (unsigned t = 0; t < sizeof(bench_traces) / sizeof(bench_traces[0]); t++){
+        int num_points = LWM2M_trace_synth(bench_traces[t].shape, 0.0f, 100.0f,
+            bench_traces[t].period_ms, 1, t + 1, trace, BENCH_MAX_POINTS);
+        for (unsigned a = 0; a < sizeof(bench_attributes) / sizeof(bench_attributes[0]); a++){
+            const LWM2M_attributes *attr = &bench_attributes[a];
+            double start = wall_seconds();
+            LWM2M_replay_run_blocks(attr, BENCH_OBSERVERS, trace, num_points, block_size, false, &stats);
+            double scalar = wall_seconds() - start;
+            uint32_t notifications = stats.notifications, checksum = stats.checksum;
+
+            start = wall_seconds();
+            LWM2M_replay_run_blocks(attr, BENCH_OBSERVERS, trace, num_points, block_size, true, &stats);
+            double batch = wall_seconds() - start;
+            bool same = stats.notifications == notifications && stats.checksum == checksum;
+            failed |= !same;
+
+            printf("%-12s %5g %5g %5g %12.0f %12.0f %6u %s\n", bench_traces[t].name, 
+                attr->step, attr->pmin, attr->pmax, stats.evaluations / scalar, 
+                stats.evaluations / batch, stats.notifications, same ? "" : "MISMATCH");
+        }
+    }
+    return failed;
+}
+
+/*
+observers notifying every period_ms over a link losing loss_pct of the
+messages and of the ACKs, with a round trip of rtt_ms. Notifications wait in
+a FIFO for LWM2M_confirm, an observer whose notification finds it full
+tries again a period later, as the engine does. The pmin floor stretches
+the period. An observer given up on or reset observes again at once.
+*/
+struct bench_link_result {
+    uint32_t offered; // notifications generated
+    uint32_t packets; // messages put on the link, retransmissions included
+    uint32_t delivered; // notifications received by the server
+    uint32_t held_back; // not generated because the sender queue was full
+    uint32_t max_floor_ms;
+};
+
+static void bench_link_run(int observers, uint32_t period_ms, int loss_pct, uint32_t rtt_ms,
+    uint32_t duration_ms, bench_link_result *result)
+{
+    const int fifo_size = 32;
+    int fifo[fifo_size], fifo_head = 0, fifo_count = 0;
+    uint32_t next_notify[LWM2M_MAX_OBSERVATIONS];
+    // ACKs in flight, msg_id and arrival time
+    uint16_t ack_ids[LWM2M_MAX_OBSERVATIONS * (LWM2M_MAX_RETRANSMIT + 1)];
+    uint32_t ack_times[LWM2M_MAX_OBSERVATIONS * (LWM2M_MAX_RETRANSMIT + 1)];
+    int num_acks = 0;
+    uint16_t msg_id = 1;
+    uint32_t random = 12345;
+
+    memset(result, 0, sizeof(*result));
+    LWM2M_confirm_init(0);
+    for (int obs = 0; obs < observers; obs++){
+        LWM2M_confirm_open(obs, LWM2M_CON_POLICY_DEFAULT, LWM2M_CON_EVERY_DEFAULT);
+        next_notify[obs] = obs * period_ms / observers;
+    }
+
+    for (uint32_t now = 0; now < duration_ms; now += LWM2M_TIMER_TICK_MS){
+        uint32_t floor_ms = LWM2M_confirm_pmin_floor_ms(observers);
+        if (floor_ms > result->max_floor_ms){
+            result->max_floor_ms = floor_ms;
+        }
+        for (int obs = 0; obs < observers; obs++){
+            if ((int32_t)(now - next_notify[obs]) < 0){
+                continue;
+            }
+            next_notify[obs] = now + ((period_ms > floor_ms) ? period_ms : floor_ms);
+            if (fifo_count == fifo_size){
+                result->held_back++;
+                continue;
+            }
+            fifo[(fifo_head + fifo_count++) % fifo_size] = obs;
+            result->offered++;
+        }
+
+        for (int i = 0; i < num_acks; i++){
+            if (ack_times[i] == now){
+                int obs = LWM2M_confirm_response(ack_ids[i], false);
+                (void)obs;
+                ack_ids[i--] = ack_ids[--num_acks];
+                ack_times[i + 1] = ack_times[num_acks];
+            }
+        }
+
+        // the sender pass of LWM2M_send_notifications
+        while (fifo_count){
+            int obs = fifo[fifo_head];
+            int how = LWM2M_confirm_decide(obs, (sample)now, LWM2M_CAUSE_PMAX, now);
+            if (how == LWM2M_SEND_WAIT){
+                break;
+            }
+            fifo_head = (fifo_head + 1) % fifo_size;
+            fifo_count--;
+            if (how == LWM2M_SEND_HOLD){
+                continue;
+            }
+            random = random * 1103515245 + 12345;
+            bool lost = (int)((random >> 16) % 100) < loss_pct;
+            random = random * 1103515245 + 12345;
+            bool ack_lost = (int)((random >> 16) % 100) < loss_pct;
+            result->packets++;
+            result->delivered += !lost;
+            if (how == LWM2M_SEND_CON && !lost && !ack_lost){
+                ack_ids[num_acks] = msg_id;
+                ack_times[num_acks++] = now + rtt_ms;
+            }
+            LWM2M_confirm_sent(obs, how == LWM2M_SEND_CON, msg_id++, now);
+        }
+        LWM2M_confirm_send send;
+        for (int obs = LWM2M_confirm_due(0, now, &send); obs >= 0; obs = LWM2M_confirm_due(obs + 1, now, &send)){
+            if (send.give_up){
+                LWM2M_confirm_open(obs, LWM2M_CON_POLICY_DEFAULT, LWM2M_CON_EVERY_DEFAULT);
+                continue;
+            }
+            random = random * 1103515245 + 12345;
+            bool lost = (int)((random >> 16) % 100) < loss_pct;
+            random = random * 1103515245 + 12345;
+            bool ack_lost = (int)((random >> 16) % 100) < loss_pct;
+            result->packets++;
+            result->delivered += !lost;
+            if (send.confirmable && !lost && !ack_lost){
+                ack_ids[num_acks] = msg_id;
+                ack_times[num_acks++] = now + rtt_ms;
+            }
+            LWM2M_confirm_sent(obs, send.confirmable, msg_id++, now);
+        }
+    }
+}
+
+/*
+a pmax storm of observers over a link getting worse, against sending every
+notification NON as before: packets put on the link and notifications
+that arrive
+*/
+static int bench_link(void)
+{
+    const int observers = 16;
+    const uint32_t period_ms = 10000, rtt_ms = 300, duration_ms = 3600000;
+    static const int loss[] = {0, 10, 30, 50, 80};
+
+    printf("%d observers, period %u ms, rtt %u ms, %u s\n", observers, period_ms, rtt_ms, duration_ms / 1000);
+    printf("%5s | %8s %8s | %8s %8s %8s %6s %6s %6s %6s %8s %8s\n", "loss%", "NON pkts", "arrived", 
+        "offered", "pkts", "arrived", "con", "retx", "given", "super", "waits", "floor ms");
+    for (unsigned l = 0; l < sizeof(loss) / sizeof(loss[0]); l++){
+        bench_link_result result;
+        bench_link_run(observers, period_ms, loss[l], rtt_ms, duration_ms, &result);
+        const LWM2M_confirm_stats *cs = LWM2M_confirm_get_stats();
+        uint32_t non_packets = observers * (duration_ms / period_ms);
+        printf("%5d | %8u %8u | %8u %8u %8u %6u %6u %6u %6u %8u %8u\n", loss[l], 
+            non_packets, non_packets * (100 - loss[l]) / 100,
+            result.offered, result.packets, result.delivered, cs->confirmable, cs->retransmissions, 
+            cs->given_up, cs->superseded, cs->waits, result.max_floor_ms);
+    }
+    return 0;
+}
+
+// CoAP header, 8 byte token, Observe, Content-Format and payload marker, UDP and IPv6
+#define BENCH_PACKET_OVERHEAD 66
+
+/*
+encode a batch as LWM2M_resource.cpp sends it, a single value as text/plain
+and several as a senml+json composite, returns the packet size
+*/
+static int bench_batch_bytes(LWM2M_coalesce *batch, uint32_t now)
+{
+    static LWM2M_record records[LWM2M_COALESCE_RECORDS];
+    uint8_t payload[64 + 48 * LWM2M_COALESCE_RECORDS];
+    memcpy(records, LWM2M_coalesce_records(batch, now), batch->num_records * sizeof(LWM2M_record));
+    int len;
+    if (batch->num_items == 1 && batch->num_records == 1){
+        len = LWM2M_encode(LWM2M_CT_TEXT_PLAIN, NULL, records, 1, payload, sizeof(payload));
+    }
+    else{
+        len = LWM2M_encode(LWM2M_CT_SENML_JSON, "/", records, batch->num_records, payload, sizeof(payload));
+    }
+    return (len < 0) ? -1 : len + BENCH_PACKET_OVERHEAD;
+}
+
+/*
+observers resources of object 3300 notifying at pmax_ms, all in step if
+aligned, else spread over the period, and on step changes at random with
+a mean interval of step_ms if set. Every notification is one value.
+*/
+static void bench_coalesce_run(int observers, uint32_t pmax_ms, bool aligned, uint32_t step_ms, 
+    uint32_t window_ms, uint32_t duration_ms, uint32_t *notifications, uint32_t *packets, uint32_t *bytes)
+{
+    static LWM2M_coalesce batch;
+    uint32_t next_pmax[LWM2M_MAX_OBSERVATIONS];
+    uint32_t random = 777;
+
+    LWM2M_coalesce_init(&batch, window_ms);
+    *notifications = *packets = *bytes = 0;
+    for (int obs = 0; obs < observers; obs++){
+        next_pmax[obs] = aligned ? 0 : obs * pmax_ms / observers;
+    }
+    for (uint32_t now = 0; now < duration_ms; now += LWM2M_TIMER_TICK_MS){
+        for (int obs = 0; obs < observers; obs++){
+            bool due = (int32_t)(now - next_pmax[obs]) >= 0;
+            if (step_ms){
+                random = random * 1103515245 + 12345;
+                due |= (random >> 8) % (step_ms / LWM2M_TIMER_TICK_MS) == 0;
+            }
+            if (!due){
+                continue;
+            }
+            next_pmax[obs] = now + pmax_ms;
+            LWM2M_record record = {3300, 0, (uint16_t)(5700 + obs), 20.0f + obs * 0.5f, 0};
+            if (LWM2M_coalesce_due(&batch, now) || !LWM2M_coalesce_add(&batch, obs, LWM2M_CAUSE_PMAX, false, &record, 1, now)){
+                *bytes += bench_batch_bytes(&batch, now);
+                (*packets)++;
+                LWM2M_coalesce_clear(&batch);
+                LWM2M_coalesce_add(&batch, obs, LWM2M_CAUSE_PMAX, false, &record, 1, now);
+            }
+            (*notifications)++;
+        }
+        if (LWM2M_coalesce_due(&batch, now)){
+            *bytes += bench_batch_bytes(&batch, now);
+            (*packets)++;
+            LWM2M_coalesce_clear(&batch);
+        }
+    }
+}
+
+/*
+a composite as LWM2M_send_batch sends it, after the notification of a cancelled
+observation is taken out: the records of the others keep their full paths and
+their times relative to the sending. True if it encodes as expected.
+*/
+static bool bench_coalesce_composite(void)
+{
+    static LWM2M_coalesce batch;
+    static const char expected[] = 
+        "[{\"bn\":\"/\",\"n\":\"3300/0/5700\",\"v\":20.5,\"t\":-2},"
+        "{\"n\":\"3304/2/5700\",\"v\":40,\"t\":-1.5},"
+        "{\"n\":\"3304/2/5700\",\"v\":41,\"t\":-1}]";
+    LWM2M_record temperature = {3300, 0, 5700, 20.5f, 0};
+    LWM2M_record humidity[2] = {{3303, 1, 5700, 60.0f, -0.5f}, {3303, 1, 5700, 61.0f, 0}};
+    LWM2M_record pressure[2] = {{3304, 2, 5700, 40.0f, -0.5f}, {3304, 2, 5700, 41.0f, 0}};
+    uint8_t payload[256];
+
+    LWM2M_coalesce_init(&batch, 1000);
+    LWM2M_coalesce_add(&batch, 0, LWM2M_CAUSE_PMAX, false, &temperature, 1, 10000);
+    LWM2M_coalesce_add(&batch, 1, LWM2M_CAUSE_STEP, true, humidity, 2, 10500);
+    LWM2M_coalesce_add(&batch, 2, LWM2M_CAUSE_BAND, false, pressure, 2, 11000);
+    LWM2M_coalesce_remove(&batch, 1);
+    int len = LWM2M_encode(LWM2M_CT_SENML_JSON, "/", LWM2M_coalesce_records(&batch, 12000), 
+        batch.num_records, payload, sizeof(payload) - 1);
+    bool ok = batch.num_items == 2 && batch.items[1].first_record == 1 && len == (int)strlen(expected) 
+        && memcmp(payload, expected, len) == 0;
+    payload[(len < 0) ? 0 : len] = 0;
+    printf("composite of 3 notifications, one cancelled: %s, %s\n", (const char *)payload, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+/*
+packets and bytes with coalescing windows against sending every notification alone
+*/
+static int bench_coalesce(void)
+{
+    struct scenario {
+        const char *name;
+        bool aligned;
+        uint32_t step_ms;
+    };
+    static const scenario scenarios[] = {
+        {"pmax storm", true, 0},
+        {"pmax spread", false, 0},
+        {"storm + steps", true, 20000},
+        {"spread + steps", false, 20000},
+    };
+    static const uint32_t windows[] = {0, 100, 1000, 5000};
+    const int observers = 30;
+    const uint32_t pmax_ms = 60000, duration_ms = 3600000;
+
+    bool composite_ok = bench_coalesce_composite();
+    printf("%d resources, pmax %u ms, %u s, %d bytes per packet besides the payload\n", 
+        observers, pmax_ms, duration_ms / 1000, BENCH_PACKET_OVERHEAD);
+    printf("%-15s %7s %7s %7s %9s %8s %8s\n", "scenario", "window", "notif", "packets", "bytes", 
+        "pkts -%", "bytes -%");
+    for (unsigned sc = 0; sc < sizeof(scenarios) / sizeof(scenarios[0]); sc++){
+        uint32_t base_packets = 0, base_bytes = 0;
+        for (unsigned w = 0; w < sizeof(windows) / sizeof(windows[0]); w++){
+            uint32_t notifications, packets, bytes;
+            bench_coalesce_run(observers, pmax_ms, scenarios[sc].aligned, scenarios[sc].step_ms, 
+                windows[w], duration_ms, &notifications, &packets, &bytes);
+            if (w == 0){
+                base_packets = packets;
+                base_bytes = bytes;
+            }
+            printf("%-15s %7u %7u %7u %9u %7.1f%% %7.1f%%\n", scenarios[sc].name, windows[w], notifications, 
+                packets, bytes, 100.0 * (base_packets - packets) / base_packets, 
+                100.0 * ((double)base_bytes - bytes) / base_bytes);
+        }
+    }
+    return composite_ok ? 0 : 1;
+}
+
+/*
+a fleet of devices provisioned together, booting within boot_spread_ms and
+each reporting resources observations at pmax only. All get an attribute
+write within write_spread_ms at write_ms, which restarts their observations
+as LWM2M_notification_init does. Counts pmax notifications arriving at the
+server per second, the init notifications are a burst in every mode, and
+device wakeups (distinct 10 ms ticks with a report).
+epoch_at_boot puts the epoch of an aligned grid at each device's boot, as
+LWM2M_resource.cpp does, else at the shared fleet time 0.
+*/
+struct bench_fleet_result {
+    uint32_t peak; // pmax notifications in the busiest second
+    uint32_t p999; // 99.9th percentile of pmax notifications per second
+    double mean;
+    double wakeups; // per device and hour
+    uint32_t late; // intervals longer than pmax, must be 0
+};
+
+static void bench_fleet_run(int devices, int resources, uint32_t pmax_s, uint32_t duration_s,
+    const LWM2M_pmax_schedule *schedule, bool spread, bool epoch_at_boot, bench_fleet_result *result)
+{
+    const uint32_t boot_spread_ms = 2000, write_spread_ms = 1000;
+    const uint32_t pmax_ms = pmax_s * 1000, duration_ms = duration_s * 1000, write_ms = duration_ms / 2;
+    std::vector<uint32_t> per_second(duration_s, 0);
+    std::vector<uint32_t> ticks;
+    uint64_t wakeups = 0;
+    uint32_t random = 99991;
+
+    memset(result, 0, sizeof(*result));
+    for (int device = 0; device < devices; device++){
+        random = random * 1103515245 + 12345;
+        uint32_t boot = (random >> 8) % boot_spread_ms;
+        random = random * 1103515245 + 12345;
+        uint32_t write = write_ms + (random >> 8) % write_spread_ms;
+
+        LWM2M_pmax_schedule device_schedule = *schedule;
+        // local clock 0 at boot
+        device_schedule.epoch_ms = epoch_at_boot ? 0 : (uint32_t)0 - boot;
+        if (spread){
+            uint8_t id[4] = {(uint8_t)device, (uint8_t)(device >> 8), (uint8_t)(device >> 16), 0x42};
+            device_schedule.phase_ms = LWM2M_pmax_device_phase(id, sizeof(id),
+                schedule->period_ms ? schedule->period_ms : pmax_ms);
+        }
+        uint32_t jitter = device * 2654435761u + 1;
+
+        ticks.clear();
+        for (int res = 0; res < resources; res++){
+            uint32_t t = boot; // init notification at boot
+            bool restarted = false, init = true;
+            while (t < duration_ms){
+                if (!init){
+                    per_second[t / 1000]++;
+                }
+                ticks.push_back(t / LWM2M_TIMER_TICK_MS);
+                uint32_t delay = LWM2M_pmax_delay(&device_schedule, t - boot, pmax_ms, &jitter);
+                result->late += delay > pmax_ms;
+                // the timer wheel fires on the tick after the deadline
+                uint32_t next = t + (delay + LWM2M_TIMER_TICK_MS - 1) / LWM2M_TIMER_TICK_MS * LWM2M_TIMER_TICK_MS;
+                init = !restarted && next >= write;
+                if (init){
+                    next = write; // attributes written, init notification
+                    restarted = true;
+                }
+                t = next;
+            }
+        }
+        std::sort(ticks.begin(), ticks.end());
+        wakeups += std::unique(ticks.begin(), ticks.end()) - ticks.begin();
+    }
+
+    uint64_t total = 0;
+    for (uint32_t second = 0; second < duration_s; second++){
+        total += per_second[second];
+        if (per_second[second] > result->peak){
+            result->peak = per_second[second];
+        }
+    }
+    std::sort(per_second.begin(), per_second.end());
+    result->p999 = per_second[duration_s * 999 / 1000];
+    result->mean = (double)total / duration_s;
+    result->wakeups = (double)wakeups / devices / (duration_s / 3600.0);
+}
+
+static int bench_fleet(void)
+{
+    struct mode {
+        const char *name;
+        LWM2M_pmax_schedule schedule;
+        bool spread, epoch_at_boot;
+    };
+    //                                   mode             jitter  period epoch phase
+    static const mode modes[] = {
+        {"exact",                       {LWM2M_PMAX_EXACT,      0,     0, 0, 0}, false, false},
+        {"jitter 5 s",                  {LWM2M_PMAX_JITTER,  5000,     0, 0, 0}, false, false},
+        {"jitter 60 s",                 {LWM2M_PMAX_JITTER, 60000,     0, 0, 0}, false, false},
+        {"aligned, boot epoch",         {LWM2M_PMAX_ALIGNED,    0,     0, 0, 0}, false, true},
+        {"aligned, fleet epoch",        {LWM2M_PMAX_ALIGNED,    0,     0, 0, 0}, false, false},
+        {"aligned, spread",             {LWM2M_PMAX_ALIGNED,    0,     0, 0, 0}, true, false},
+        {"aligned 60 s, spread",        {LWM2M_PMAX_ALIGNED,    0, 60000, 0, 0}, true, false},
+    };
+    const int devices = 100000, resources = 4;
+    const uint32_t pmax_s = 300, duration_s = 7200;
+    int failed = 0;
+
+    printf("%d devices, %d resources each at pmax %u s, %u s, attributes rewritten at %u s\n",
+        devices, resources, pmax_s, duration_s, duration_s / 2);
+    printf("%-22s %8s %8s %8s %12s\n", "schedule", "peak/s", "p99.9/s", "mean/s", "wakeups/dev/h");
+    for (unsigned m = 0; m < sizeof(modes) / sizeof(modes[0]); m++){
+        bench_fleet_result result;
+        bench_fleet_run(devices, resources, pmax_s, duration_s, &modes[m].schedule, modes[m].spread, 
+            modes[m].epoch_at_boot, &result);
+        failed |= result.late != 0;
+        printf("%-22s %8u %8u %8.1f %12.1f %s\n", modes[m].name, result.peak, result.p999, result.mean,
+            result.wakeups, result.late ? "LATE" : "");
+    }
+    return failed;
+}
+
+/*
+producer thread pushes numbered groups of 1 to LWM2M_QUIET_QUEUE_DEPTH+1
+entries, the consumer checks that every group arrives whole and in order
+*/
+/*
+energy of one sensor read (wakeup, ADC conversion, conversion to units)
+and of one notification sent, for a low power MCU and an NB-IoT class radio
+*/
+#define BENCH_READ_UJ     30
+#define BENCH_NOTIFY_UJ   2000
+
+struct bench_energy_case {
+    const char *name;
+    LWM2M_attributes attr;
+};
+
+static const bench_energy_case bench_energy_cases[] = {
+    //                  gt      lt     step   pmin   pmax   epmin epmax stat hyst dwell no limits
+    {"pmin/pmax",    {1e9f,  -1e9f,   1e9f, 10.0f, 300.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"defaults",     {75.0f, 25.0f,  10.0f, 10.0f,  60.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"step 2",       {1e9f,  -1e9f,   2.0f,  1.0f, 300.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"bands",        {75.0f, 25.0f,   1e9f,  0.0f, 300.0f, 0, 0, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+};
+
+static int bench_energy(void)
+{
+    static const bench_trace traces[] = {
+        {"sine 10min", LWM2M_TRACE_SINE, 600000, 100},
+        {"sine 60s", LWM2M_TRACE_SINE, 60000, 100},
+        {"square 20s", LWM2M_TRACE_SQUARE, 20000, 100},
+        {"walk", LWM2M_TRACE_WALK, 300000, 100},
+    };
+    static LWM2M_replay_stats fixed;
+
+    printf("one hour per run, %d uJ per read, %d uJ per notification\n", BENCH_READ_UJ, BENCH_NOTIFY_UJ);
+    printf("%-12s %-10s %7s %7s %6s %6s %6s %6s %6s %6s %6s %6s %9s %9s %6s\n", "trace", "attributes",
+        "reads", "planned", "notif", "plan", "s+b", "plan", "pmin", "plan", "error", "plan", 
+        "fixed mJ", "plan mJ", "saved");
+    for (unsigned t = 0; t < sizeof(traces) / sizeof(traces[0]); t++){
+        int num_points = LWM2M_trace_synth(traces[t].shape, 0.0f, 100.0f,
+            traces[t].period_ms, traces[t].interval_ms, t + 1, trace, 36000);
+        for (unsigned c = 0; c < sizeof(bench_energy_cases) / sizeof(bench_energy_cases[0]); c++){
+            const LWM2M_attributes *attr = &bench_energy_cases[c].attr;
+            LWM2M_replay_run_sampled(attr, 1, trace, num_points, 100, 100, &fixed);
+            LWM2M_replay_run_sampled(attr, 1, trace, num_points, 100, 60000, &stats);
+            double fixed_mj = (fixed.reads * BENCH_READ_UJ + fixed.notifications * BENCH_NOTIFY_UJ) / 1000.0;
+            double planned_mj = (stats.reads * BENCH_READ_UJ + stats.notifications * BENCH_NOTIFY_UJ) / 1000.0;
+            printf("%-12s %-10s %7u %7u %6u %6u %6u %6u %6u %6u %6.1f %6.1f %9.1f %9.1f %5.0f%%\n", traces[t].name,
+                bench_energy_cases[c].name, fixed.reads, stats.reads, fixed.notifications, stats.notifications,
+                fixed.by_cause[LWM2M_CAUSE_STEP] + fixed.by_cause[LWM2M_CAUSE_BAND],
+                stats.by_cause[LWM2M_CAUSE_STEP] + stats.by_cause[LWM2M_CAUSE_BAND],
+                fixed.by_cause[LWM2M_CAUSE_PMIN], stats.by_cause[LWM2M_CAUSE_PMIN],
+                fixed.max_error, stats.max_error, fixed_mj, planned_mj, fixed_mj > 0 ? 100.0 * (fixed_mj - planned_mj) / fixed_mj : 0.0);
+        }
+    }
+    printf("s+b: step and band reports, sent when the change is read; pmin: changes read in the quiet\n"
+        "period, sent at its end. A planned read can see a change later than the fixed 100 ms reads,\n"
+        "its report then moves from s+b to pmin, or waits for a later pmax.\n");
+    return 0;
+}
+
+/*
+evaluations under epmin and epmax, the same attributes otherwise. Each
+trace is pushed every 100 ms, then read by planned sampling (100 ms to
+60 s) from the simulated ADC.
+*/
+struct bench_eval_case {
+    const char *name;
+    LWM2M_attributes attr;
+};
+
+static const bench_eval_case bench_eval_cases[] = {
+    //                        gt      lt   step  pmin   pmax   epmin  epmax stat hyst dwell no limits
+    {"none",               {75.0f, 25.0f, 2.0f, 1.0f, 300.0f,  0.0f,  0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"epmin 1",            {75.0f, 25.0f, 2.0f, 1.0f, 300.0f,  1.0f,  0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"epmin 5",            {75.0f, 25.0f, 2.0f, 1.0f, 300.0f,  5.0f,  0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"epmax 10",           {75.0f, 25.0f, 2.0f, 1.0f, 300.0f,  0.0f, 10.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"epmin 1 epmax 10",   {75.0f, 25.0f, 2.0f, 1.0f, 300.0f,  1.0f, 10.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"epmin 5 epmax 30",   {75.0f, 25.0f, 2.0f, 1.0f, 300.0f,  5.0f, 30.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+};
+
+static int bench_eval(void)
+{
+    static const bench_trace traces[] = {
+        {"sine 60s", LWM2M_TRACE_SINE, 60000, 100},
+        {"square 20s", LWM2M_TRACE_SQUARE, 20000, 100},
+        {"walk", LWM2M_TRACE_WALK, 300000, 100},
+    };
+    static LWM2M_replay_stats sampled;
+
+    printf("one hour per run, %d observers\n", BENCH_OBSERVERS);
+    printf("%-10s %-17s %8s %6s %6s %7s | %6s %7s %6s %6s\n", "trace", "epmin/epmax",
+        "evals", "notif", "s+b", "p99 ms", "reads", "evals", "notif", "error");
+    for (unsigned t = 0; t < sizeof(traces) / sizeof(traces[0]); t++){
+        int num_points = LWM2M_trace_synth(traces[t].shape, 0.0f, 100.0f,
+            traces[t].period_ms, traces[t].interval_ms, t + 1, trace, 36000);
+        for (unsigned c = 0; c < sizeof(bench_eval_cases) / sizeof(bench_eval_cases[0]); c++){
+            const LWM2M_attributes *attr = &bench_eval_cases[c].attr;
+            LWM2M_replay_run(attr, BENCH_OBSERVERS, trace, num_points, &stats);
+            LWM2M_replay_run_sampled(attr, BENCH_OBSERVERS, trace, num_points, 100, 60000, &sampled);
+            printf("%-10s %-17s %8u %6u %6u %7u | %6u %7u %6u %6.1f\n", traces[t].name,
+                bench_eval_cases[c].name, stats.evaluations, stats.notifications,
+                stats.by_cause[LWM2M_CAUSE_STEP] + stats.by_cause[LWM2M_CAUSE_BAND],
+                LWM2M_replay_percentile(&stats, 99), sampled.reads, sampled.evaluations,
+                sampled.notifications, sampled.max_error);
+        }
+    }
+    return 0;
+}
+
+/*
+periodic reporting only, band and step never trigger: the excursions
+between two notifications that the server never sees, at pmax 60 s and at
+10 times that with the statistics of the reporting window sent along. The
+traces are pushed every 100 ms, records counts the values and statistics
+sent.
+*/
+struct bench_stats_case {
+    const char *name;
+    LWM2M_attributes attr;
+};
+
+#define BENCH_MINMAX (LWM2M_STAT_MIN | LWM2M_STAT_MAX)
+#define BENCH_ALL_STATS (BENCH_MINMAX | LWM2M_STAT_MEAN | LWM2M_STAT_VARIANCE | LWM2M_STAT_COUNT \
+    | LWM2M_STAT_PERCENTILES)
+
+static const bench_stats_case bench_stats_cases[] = {
+    //                        gt     lt   step  pmin   pmax   epmin epmax statistics hyst dwell no limits
+    {"pmax 60",            {1e9f, -1e9f, 1e9f, 1.0f,  60.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"pmax 600",           {1e9f, -1e9f, 1e9f, 1.0f, 600.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"pmax 600 min max",   {1e9f, -1e9f, 1e9f, 1.0f, 600.0f, 0.0f, 0.0f, BENCH_MINMAX, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"pmax 600 all",       {1e9f, -1e9f, 1e9f, 1.0f, 600.0f, 0.0f, 0.0f, BENCH_ALL_STATS, 0.0f, 0.0f, 0, {0}, {0}}},
+};
+
+static int bench_stats(void)
+{
+    static const bench_trace traces[] = {
+        {"sine 60s", LWM2M_TRACE_SINE, 60000, 100},
+        {"square 20s", LWM2M_TRACE_SQUARE, 20000, 100},
+        {"walk", LWM2M_TRACE_WALK, 300000, 100},
+    };
+
+    printf("one hour per run, %d observers\n", BENCH_OBSERVERS);
+    printf("%-10s %-17s %12s %6s %8s %7s\n", "trace", "attributes", "eval/s", "notif", "records", "missed");
+    for (unsigned t = 0; t < sizeof(traces) / sizeof(traces[0]); t++){
+        int num_points = LWM2M_trace_synth(traces[t].shape, 0.0f, 100.0f,
+            traces[t].period_ms, traces[t].interval_ms, t + 1, trace, 36000);
+        for (unsigned c = 0; c < sizeof(bench_stats_cases) / sizeof(bench_stats_cases[0]); c++){
+            double start = wall_seconds();
+            LWM2M_replay_run(&bench_stats_cases[c].attr, BENCH_OBSERVERS, trace, num_points, &stats);
+            double elapsed = wall_seconds() - start;
+            printf("%-10s %-17s %12.0f %6u %8u %7.1f\n", traces[t].name, bench_stats_cases[c].name,
+                elapsed > 0 ? stats.evaluations / elapsed : 0.0, stats.notifications,
+                stats.notifications + stats.events + stats.statistics, stats.max_missed);
+        }
+    }
+    return 0;
+}
+
+/*
+band changes of noisy traces, lt 25 and gt 75 and no step, held back by
+pmin, by hysteresis and by dwell. hover sits at gt with 1 unit of noise,
+the others swing over the whole range with 2 units. Each square period 
+has 2 real band changes. p99 is the trigger latency, the time a band 
+change waited for pmin or, with dwell, from the first sample out of band.
+*/
+struct bench_hysteresis_case {
+    const char *name;
+    LWM2M_attributes attr;
+};
+
+static const bench_hysteresis_case bench_hysteresis_cases[] = {
+    //                      gt     lt    step  pmin  pmax  epmin epmax stat  hyst  dwell no limits
+    {"none",             {75.0f, 25.0f, 1e9f,  0.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"pmin 10",          {75.0f, 25.0f, 1e9f, 10.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0, {0}, {0}}},
+    {"hyst 1",           {75.0f, 25.0f, 1e9f,  0.0f, 0.0f, 0.0f, 0.0f, 0, 1.0f, 0.0f, 0, {0}, {0}}},
+    {"hyst 3",           {75.0f, 25.0f, 1e9f,  0.0f, 0.0f, 0.0f, 0.0f, 0, 3.0f, 0.0f, 0, {0}, {0}}},
+    {"dwell 1",          {75.0f, 25.0f, 1e9f,  0.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f, 1.0f, 0, {0}, {0}}},
+    {"dwell 5",          {75.0f, 25.0f, 1e9f,  0.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f, 5.0f, 0, {0}, {0}}},
+    {"hyst 1 dwell 1",   {75.0f, 25.0f, 1e9f,  0.0f, 0.0f, 0.0f, 0.0f, 0, 1.0f, 1.0f, 0, {0}, {0}}},
+};
+
+static int bench_hysteresis(void)
+{
+    struct noisy_trace {
+        bench_trace trace;
+        sample lo, hi, noise;
+    };
+    static const noisy_trace traces[] = {
+        {{"hover 75", LWM2M_TRACE_SINE, 600000, 100}, 73.0f, 77.0f, 1.0f},
+        {{"sine 60s", LWM2M_TRACE_SINE, 60000, 100}, 0.0f, 100.0f, 2.0f},
+        {{"square 60s", LWM2M_TRACE_SQUARE, 60000, 100}, 0.0f, 100.0f, 2.0f},
+    };
+
+    printf("one hour per run, %d observers\n", BENCH_OBSERVERS);
+    printf("%-10s %-15s %7s %7s %7s\n", "trace", "attributes", "notif", "band", "p99 ms");
+    for (unsigned t = 0; t < sizeof(traces) / sizeof(traces[0]); t++){
+        const bench_trace *shape = &traces[t].trace;
+        int num_points = LWM2M_trace_synth(shape->shape, traces[t].lo, traces[t].hi,
+            shape->period_ms, shape->interval_ms, t + 1, trace, 36000);
+        LWM2M_trace_noise(trace, num_points, traces[t].noise, t + 1);
+        for (unsigned c = 0; c < sizeof(bench_hysteresis_cases) / sizeof(bench_hysteresis_cases[0]); c++){
+            LWM2M_replay_run(&bench_hysteresis_cases[c].attr, BENCH_OBSERVERS, trace, num_points, &stats);
+            printf("%-10s %-15s %7u %7u %7u\n", shape->name, bench_hysteresis_cases[c].name,
+                stats.notifications, stats.by_cause[LWM2M_CAUSE_BAND] + stats.events,
+                LWM2M_replay_percentile(&stats, 99));
+        }
+    }
+    return 0;
+}
+
+/*
+a dashboard polls GET /3303/0, an instance of 4 resources, every second for
+a day, sending the ETag it last got. The values change every minute and
+the sampling keeps them current for BENCH_CACHE_AGE_MS.
+*/
+#define BENCH_CACHE_POLLS   86400
+#define BENCH_CACHE_POLL_MS 1000
+#define BENCH_CACHE_CHANGE_MS 60000
+#define BENCH_CACHE_AGE_MS  30000
+
+static int bench_cache(void)
+{
+    static uint8_t payload[512];
+    static LWM2M_record records[8];
+    static LWM2M_response_cache cache;
+
+    LWM2M_host_clock_simulated(true);
+    uint32_t start_ms = LWM2M_clock_ms() + 1000;
+    LWM2M_host_clock_set(start_ms);
+    LWM2M_obs_table_init();
+    LWM2M_registry_init();
+    for (uint16_t resource = 0; resource < 4; resource++){
+        LWM2M_sensor_register(resource, NULL, NULL, 0);
+        LWM2M_registry_add(3303, 0, 5700 + resource, NULL, NULL, resource, LWM2M_OP_READ);
+    }
+    int instance = LWM2M_registry_find(LWM2M_make_key(3303, 0, LWM2M_ID_NONE));
+
+    printf("%-8s %10s %8s %8s %10s\n", "mode", "GET/s", "encodes", "2.03", "bytes");
+    for (int cached = 0; cached < 2; cached++){
+        LWM2M_response_cache_init(&cache);
+        uint8_t client_etag[LWM2M_ETAG_LEN] = {0};
+        uint8_t etag[LWM2M_ETAG_LEN];
+        uint32_t encodes = 0, valid = 0, bytes = 0;
+        double elapsed = 0;
+        for (uint32_t poll = 0; poll < BENCH_CACHE_POLLS; poll++){
+            uint32_t now = start_ms + poll * BENCH_CACHE_POLL_MS;
+            if (poll * BENCH_CACHE_POLL_MS % BENCH_CACHE_CHANGE_MS == 0){
+                for (uint16_t resource = 0; resource < 4; resource++){
+                    LWM2M_sensor_push(resource, (sample)(poll % 997) / 10 + resource);
+                }
+            }
+            LWM2M_sensor_poll(now);
+
+            double t = wall_seconds();
+            const LWM2M_cached_response *response = cached ? LWM2M_response_cache_find(&cache, instance, 
+                LWM2M_CT_SENML_JSON, LWM2M_sensor_changes(), now) : NULL;
+            int len = response ? response->payload_len : 0;
+            if (!response){
+                int num_records = LWM2M_registry_read(instance, records, 8);
+                len = LWM2M_encode(LWM2M_CT_SENML_JSON, "/3303/0/", records, num_records, payload, sizeof(payload));
+                encodes++;
+                if (cached){
+                    response = LWM2M_response_cache_store(&cache, instance, LWM2M_CT_SENML_JSON, 
+                        LWM2M_sensor_changes(), now, BENCH_CACHE_AGE_MS, payload, len);
+                }
+                else{
+                    LWM2M_etag(LWM2M_CT_SENML_JSON, payload, len, etag);
+                }
+            }
+            const uint8_t *current = response ? response->etag : etag;
+            if (memcmp(client_etag, current, LWM2M_ETAG_LEN) == 0){
+                valid++;
+            }
+            else{
+                bytes += len;
+                memcpy(client_etag, current, LWM2M_ETAG_LEN);
+            }
+            elapsed += wall_seconds() - t;
+        }
+        printf("%-8s %10.0f %8u %8u %10u\n", cached ? "cached" : "encoded", 
+            elapsed > 0 ? BENCH_CACHE_POLLS / elapsed : 0.0, encodes, valid, bytes);
+    }
+    return 0;
+}
+
+/*
+A GET on an object of BENCH_BLOCK_RECORDS values sent in blocks of each size,
+every block encoded by one encoder resuming where the last block ended, and
+by a new encoder per block, as a server re-encoding the representation for
+each Block2 request would. The blocks are checked against the whole payload.
+*/
+#define BENCH_BLOCK_RECORDS 64
+#define BENCH_BLOCK_TRANSFERS 2000
+
+static int bench_blocks(void)
+{
+    static const uint16_t formats[] = {LWM2M_CT_SENML_JSON, LWM2M_CT_SENML_CBOR, LWM2M_CT_TLV};
+    static LWM2M_record records[BENCH_BLOCK_RECORDS];
+    static uint8_t whole[4096], block[1024];
+
+    for (int i = 0; i < BENCH_BLOCK_RECORDS; i++){
+        LWM2M_record record = {LWM2M_RECORD_NO_OBJECT, (uint16_t)(i / 8), (uint16_t)(5700 + i % 8), 
+            (sample)(i * 7 % 101) / 4 - 10, 0};
+        records[i] = record;
+    }
+    printf("%-11s %6s %8s %6s %14s %14s %8s\n", "format", "block", "bytes", "blocks", 
+        "resumed blk/s", "restart blk/s", "check");
+    for (unsigned f = 0; f < sizeof(formats) / sizeof(formats[0]); f++){
+        int whole_len = LWM2M_encode(formats[f], "/3303/", records, BENCH_BLOCK_RECORDS, whole, sizeof(whole));
+        for (uint8_t szx = 0; szx <= 6; szx++){
+            int size = 16 << szx;
+            int blocks = (whole_len + size - 1) / size;
+            double blocks_per_s[2];
+            bool ok = true;
+            for (int resumed = 1; resumed >= 0; resumed--){
+                LWM2M_encoder encoder;
+                double t = wall_seconds();
+                for (int transfer = 0; transfer < BENCH_BLOCK_TRANSFERS; transfer++){
+                    LWM2M_encoder_init(&encoder, formats[f], "/3303/", records, BENCH_BLOCK_RECORDS);
+                    bool more = true;
+                    for (uint32_t num = 0; more; num++){
+                        if (!resumed){
+                            LWM2M_encoder_init(&encoder, formats[f], "/3303/", records, BENCH_BLOCK_RECORDS);
+                        }
+                        int len = LWM2M_encode_block(&encoder, num * size, block, size, &more);
+                        if (transfer == 0 && (len < 0 || memcmp(block, whole + num * size, len) != 0
+                            || more != ((int)num < blocks - 1))){
+                            ok = false;
+                            more = false;
+                        }
+                    }
+                }
+                double elapsed = wall_seconds() - t;
+                blocks_per_s[resumed] = elapsed > 0 ? (double)blocks * BENCH_BLOCK_TRANSFERS / elapsed : 0.0;
+            }
+            printf("%-11s %6d %8d %6d %14.0f %14.0f %8s\n", 
+                formats[f] == LWM2M_CT_TLV ? "tlv" : formats[f] == LWM2M_CT_SENML_CBOR ? "senml+cbor" : "senml+json",
+                size, whole_len, blocks, blocks_per_s[1], blocks_per_s[0], ok ? "ok" : "MISMATCH");
+        }
+    }
+    return 0;
+}
+
+/*
+The full observation table under notification traffic, with observers 
+coming and going, logged by LWM2M_persist. Each reset restores the table 
+and is checked against it: every observation with its tag, the attributes, 
+and observe numbers above any sent. Then writes are cut short at every byte
+of a record and of a compaction, and each restore must hold either the 
+state before or after the change.
+*/
+#define BENCH_PERSIST_NOTIFICATIONS 100000
+#define BENCH_PERSIST_CHURN 50 // notifications per observation replaced
+#define BENCH_PERSIST_RESETS 10
+
+struct bench_persist_obs {
+    uint16_t resource, tag;
+    uint8_t token_len, number;
+    uint8_t token[LWM2M_MAX_TOKEN_LEN];
+};
+
+static int bench_persist_table(bench_persist_obs *table)
+{
+    int n = 0;
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        const LWM2M_observation *o = LWM2M_obs_get(obs);
+        if (o){
+            table[n].resource = o->resource;
+            table[n].tag = LWM2M_persist_tag(obs);
+            table[n].token_len = o->token_len;
+            table[n].number = o->obs_number;
+            memcpy(table[n].token, o->token, o->token_len);
+            n++;
+        }
+    }
+    return n;
+}
+
+/*
+true if the engine holds the observations of expected, with their tags and
+numbers not below the ones sent, and attributes pmin = resource + 1
+*/
+static bool bench_persist_check(const bench_persist_obs *expected, int n)
+{
+    static bench_persist_obs restored[LWM2M_MAX_OBSERVATIONS];
+    if (bench_persist_table(restored) != n){
+        return false;
+    }
+    for (int i = 0; i < n; i++){
+        int obs = LWM2M_obs_find(expected[i].resource, expected[i].token, expected[i].token_len);
+        const LWM2M_observation *o = LWM2M_obs_get(obs);
+        if (!o || LWM2M_persist_tag(obs) != expected[i].tag || (int8_t)(o->obs_number - expected[i].number) < 0){
+            return false;
+        }
+    }
+    for (uint16_t resource = 0; resource < LWM2M_MAX_RESOURCES; resource++){
+        if (LWM2M_resource_get_attributes(resource)->pmin != resource + 1){
+            return false;
+        }
+    }
+    return true;
+}
+
+static void bench_persist_token(uint8_t *token, uint32_t id)
+{
+    for (int i = 0; i < LWM2M_MAX_TOKEN_LEN; i++){
+        token[i] = (uint8_t)(id >> (8 * (i % 4))) ^ (uint8_t)i;
+    }
+}
+
+// a new observation of resource with a token made from id, logged
+static int bench_persist_observe(uint16_t resource, uint32_t id)
+{
+    uint8_t token[LWM2M_MAX_TOKEN_LEN];
+    bench_persist_token(token, id);
+    int obs = LWM2M_obs_create(resource, token, sizeof(token));
+    LWM2M_persist_observe(obs, (uint16_t)id);
+    return obs;
+}
+
+static int bench_persist_any(void)
+{
+    int obs = 0;
+    while (!LWM2M_obs_get(obs)){
+        obs++;
+    }
+    return obs;
+}
+
+// advance observe numbers until a new observation no longer fits the region
+static void bench_persist_fill(void)
+{
+    LWM2M_persist_stats stats;
+    int obs = bench_persist_any();
+    for (LWM2M_persist_get_stats(&stats); LWM2M_PERSIST_REGION_SIZE - stats.used >= 24; 
+        LWM2M_persist_get_stats(&stats)){
+        LWM2M_obs_get(obs)->obs_number += LWM2M_PERSIST_SEQ_STRIDE;
+        LWM2M_persist_sequence(obs);
+    }
+}
+
+static int bench_persist(const char *path)
+{
+    static bench_persist_obs before[LWM2M_MAX_OBSERVATIONS], after[LWM2M_MAX_OBSERVATIONS];
+    LWM2M_persist_stats stats;
+
+    remove(path);
+    if (!LWM2M_host_persist_open(path)){
+        fprintf(stderr, "cant map %s\n", path);
+        return 1;
+    }
+    LWM2M_host_clock_simulated(true);
+    LWM2M_obs_table_init();
+    LWM2M_persist_restore();
+    for (uint16_t resource = 0; resource < LWM2M_MAX_RESOURCES; resource++){
+        LWM2M_attributes attr = *LWM2M_resource_get_attributes(resource);
+        attr.pmin = resource + 1;
+        LWM2M_resource_set_attributes(resource, &attr);
+        LWM2M_persist_attributes(resource);
+    }
+    uint32_t id = 0;
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++, id++){
+        bench_persist_observe(id % LWM2M_MAX_RESOURCES, id);
+    }
+
+    // notifications round robin, an observer replaced every BENCH_PERSIST_CHURN,
+    // a reset every BENCH_PERSIST_NOTIFICATIONS / BENCH_PERSIST_RESETS
+    bool ok = true;
+    double restore_s = 0;
+    int resets = 0;
+    uint32_t appends = 0, compactions = 0;
+    for (uint32_t i = 1; i <= BENCH_PERSIST_NOTIFICATIONS; i++){
+        int obs = i % LWM2M_MAX_OBSERVATIONS;
+        if (i % BENCH_PERSIST_CHURN == 0){
+            uint16_t resource = LWM2M_obs_get(obs)->resource;
+            LWM2M_persist_cancel(obs);
+            LWM2M_obs_release(obs);
+            obs = bench_persist_observe(resource, id++);
+        }
+        LWM2M_obs_get(obs)->obs_number++;
+        LWM2M_persist_sequence(obs);
+        if (i % (BENCH_PERSIST_NOTIFICATIONS / BENCH_PERSIST_RESETS) == 0){
+            int n = bench_persist_table(before);
+            LWM2M_persist_get_stats(&stats);
+            appends += stats.appends;
+            compactions += stats.compactions;
+            double t = wall_seconds();
+            LWM2M_obs_table_init();
+            int restored = LWM2M_persist_restore();
+            restore_s += wall_seconds() - t;
+            resets++;
+            ok &= restored == n && bench_persist_check(before, n);
+        }
+    }
+    printf("%-26s %10u\n", "notifications", BENCH_PERSIST_NOTIFICATIONS);
+    printf("%-26s %10u\n", "observers replaced", BENCH_PERSIST_NOTIFICATIONS / BENCH_PERSIST_CHURN);
+    printf("%-26s %10u\n", "records appended", appends);
+    printf("%-26s %10.1f\n", "appends per 100 notif.", 100.0 * appends / BENCH_PERSIST_NOTIFICATIONS);
+    printf("%-26s %10u\n", "compactions", compactions);
+    printf("%-26s %10u\n", "log bytes at last reset", stats.used);
+    printf("%-26s %10.1f\n", "restore us, 64 obs", 1e6 * restore_s / resets);
+    printf("%-26s %10s\n", "restored state", ok ? "ok" : "MISMATCH");
+
+    // a write cut short at each byte of an append, and of the compaction the
+    // append causes when the region is full
+    int cuts = 0, failed = 0;
+    for (int compacting = 0; compacting < 2; compacting++){
+        for (uint32_t cut = 0; ; cut++){
+            // make room for the new observation, unless the last one was lost
+            if (bench_persist_table(before) == LWM2M_MAX_OBSERVATIONS){
+                int obs = bench_persist_any();
+                LWM2M_persist_cancel(obs);
+                LWM2M_obs_release(obs);
+            }
+            if (compacting){
+                bench_persist_fill();
+            }
+            int n = bench_persist_table(before);
+            LWM2M_host_persist_fail_after(cut);
+            bench_persist_observe(1, id++);
+            int m = bench_persist_table(after);
+            LWM2M_host_persist_fail_after(LWM2M_HOST_PERSIST_NO_LIMIT);
+            LWM2M_persist_get_stats(&stats);
+            bool done = stats.failures == 0;
+            LWM2M_obs_table_init();
+            LWM2M_persist_restore();
+            cuts++;
+            if (!bench_persist_check(before, n) && !bench_persist_check(after, m)){
+                failed++;
+            }
+            if (done){
+                break; // the cut was past the end of the write
+            }
+        }
+    }
+    printf("%-26s %10d\n", "resets during a write", cuts);
+    printf("%-26s %10s\n", "restored old or new", failed ? "MISMATCH" : "ok");
+    LWM2M_host_persist_close();
+    remove(path);
+    return (ok && !failed) ? 0 : 1;
+}
+
+/*
+timers armed at random delays, 10 ms to 50 hours so that every level and the
+parked timers are used, over the wrap of the 32 bit ms clock. Each expiry is
+checked against the time it was armed for and against LWM2M_timer_expiry, 
+and LWM2M_timer_wheel_next against the earliest armed timer. Timers are also
+re-armed between two advances, in the middle of a tick, as the CoAP callback
+does: none may expire before its delay has passed.
+*/
+#define BENCH_WHEEL_TIMERS 256
+#define BENCH_WHEEL_TICK_MS 10
+#define BENCH_WHEEL_STEP_MS 100
+#define BENCH_WHEEL_HOURS 52
+
+struct bench_wheel_state {
+    LWM2M_timer_wheel wheel;
+    LWM2M_timer timers[BENCH_WHEEL_TIMERS];
+    uint32_t armed_ms[BENCH_WHEEL_TIMERS], delay_ms[BENCH_WHEEL_TIMERS], expiry_ms[BENCH_WHEEL_TIMERS];
+    uint32_t now, random;
+    uint32_t fired, late, early;
+};
+
+static void bench_wheel_arm(bench_wheel_state *state, int32_t timer, uint32_t now)
+{
+    state->random ^= state->random << 13;
+    state->random ^= state->random >> 17;
+    state->random ^= state->random << 5;
+    // mostly seconds to minutes, one in 16 up to 50 hours
+    uint32_t range_ms = (state->random & 15) ? 1200000 : 180000000;
+    state->delay_ms[timer] = BENCH_WHEEL_TICK_MS + (state->random >> 4) % range_ms;
+    state->armed_ms[timer] = now;
+    LWM2M_timer_arm(&state->wheel, timer, state->delay_ms[timer], now);
+    LWM2M_timer_expiry(&state->wheel, timer, &state->expiry_ms[timer]);
+}
+
+static void bench_wheel_expired(int32_t timer, void *context)
+{
+    bench_wheel_state *state = (bench_wheel_state *)context;
+    int32_t late_ms = (int32_t)(state->now - state->expiry_ms[timer]);
+    int32_t from_armed_ms = (int32_t)(state->now - state->armed_ms[timer]);
+    state->early += late_ms < 0 || from_armed_ms < (int32_t)state->delay_ms[timer];
+    state->late += late_ms >= BENCH_WHEEL_STEP_MS;
+    state->fired++;
+    // re-armed at the tick of the expiry, the wheel is at it, behind now within the step
+    bench_wheel_arm(state, timer, state->expiry_ms[timer]);
+}
+
+static int bench_wheel(void)
+{
+    static bench_wheel_state state;
+    uint32_t start = 0xFFFFFFFFu - 5000; // the clock wraps 5 s in
+    uint32_t next_checks = 0, next_wrong = 0;
+
+    state.now = start;
+    state.random = 2463534242u;
+    LWM2M_timer_wheel_init(&state.wheel, state.timers, BENCH_WHEEL_TIMERS, BENCH_WHEEL_TICK_MS, start, 
+        &bench_wheel_expired, &state);
+    for (int32_t timer = 0; timer < BENCH_WHEEL_TIMERS; timer++){
+        bench_wheel_arm(&state, timer, start);
+    }
+    // the 10 s timer armed 5 s before the wrap
+    LWM2M_timer_arm(&state.wheel, 0, 10000, start);
+    state.delay_ms[0] = 10000;
+    LWM2M_timer_expiry(&state.wheel, 0, &state.expiry_ms[0]);
+
+    double started = wall_seconds();
+    uint32_t steps = BENCH_WHEEL_HOURS * 3600000u / BENCH_WHEEL_STEP_MS;
+    for (uint32_t step = 0; step < steps; step++){
+        state.now += BENCH_WHEEL_STEP_MS;
+        if (step % 1000 == 0){
+            // next is the earliest expiry of the armed timers
+            uint32_t next, earliest = 0;
+            int32_t earliest_in = INT32_MAX;
+            for (int32_t timer = 0; timer < BENCH_WHEEL_TIMERS; timer++){
+                int32_t in = (int32_t)(state.expiry_ms[timer] - state.now);
+                if (in < earliest_in){
+                    earliest_in = in;
+                    earliest = state.expiry_ms[timer];
+                }
+            }
+            next_wrong += !LWM2M_timer_wheel_next(&state.wheel, &next) || next != earliest;
+            next_checks++;
+        }
+        LWM2M_timer_wheel_advance(&state.wheel, state.now);
+        if (step % 7 == 0){
+            // a timer re-armed 3 ms into a tick, before the next advance
+            bench_wheel_arm(&state, step % BENCH_WHEEL_TIMERS, state.now + 3);
+        }
+    }
+    double elapsed = wall_seconds() - started;
+    bool failed = state.early || state.late || next_wrong || state.fired < BENCH_WHEEL_TIMERS;
+    printf("timer wheel: %u timers over %u hours from 5 s before the clock wrap, %.0f ms\n", 
+        BENCH_WHEEL_TIMERS, BENCH_WHEEL_HOURS, elapsed * 1000);
+    printf("%u expired, %u early, %u late, next wrong %u of %u, %s\n", state.fired, state.early, state.late, 
+        next_wrong, next_checks, failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
+
+static int bench_queue(void)
+{
+    static LWM2M_notify_queue queue;
+    const uint32_t groups = 1000000;
+    volatile bool failed = false;
+
+    LWM2M_notify_queue_init(&queue);
+    double start = wall_seconds();
+    std::thread producer([&]{
+        LWM2M_notify_entry group[LWM2M_QUIET_QUEUE_DEPTH + 1];
+        for (uint32_t seq = 0; seq < groups && !failed; seq++){
+            uint32_t count = 1 + seq % (LWM2M_QUIET_QUEUE_DEPTH + 1);
+            for (uint32_t i = 0; i < count; i++){
+                LWM2M_notify_entry entry = {(int32_t)seq, (sample)i, i, LWM2M_CAUSE_PMIN,
+                    (uint8_t)((i + 1 == count) ? LWM2M_NOTIFY_LAST : LWM2M_NOTIFY_EVENT), 0};
+                group[i] = entry;
+            }
+            while (!LWM2M_notify_queue_push(&queue, group, count)){
+                std::this_thread::yield(); // full
+            }
+        }
+    });
+
+    uint32_t seq = 0;
+    while (seq < groups && !failed){
+        uint32_t available = LWM2M_notify_queue_count(&queue);
+        uint32_t count = 1 + seq % (LWM2M_QUIET_QUEUE_DEPTH + 1);
+        if (available == 0){
+            std::this_thread::yield();
+            continue;
+        }
+        if (available < count){
+            failed = true; // a partial group was visible
+            break;
+        }
+        for (uint32_t i = 0; i < count; i++){
+            const LWM2M_notify_entry *entry = LWM2M_notify_queue_peek(&queue, i);
+            if (entry->obs != (int32_t)seq || entry->time_ms != i
+                || ((entry->flags & LWM2M_NOTIFY_LAST) != 0) != (i + 1 == count)){
+                failed = true;
+            }
+        }
+        LWM2M_notify_queue_pop(&queue, count);
+        seq++;
+    }
+    producer.join();
+    double elapsed = wall_seconds() - start;
+    printf("notify queue: %u groups, %.0f groups/s, %s\n", seq,
+        elapsed > 0 ? seq / elapsed : 0.0, failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
+
+/*
+the observability surface: the engine counters against what the replay 
+counted, percentiles of LWM2M_histogram against the exact ones, and the 
+cost of a log record against printing its line. A line to a UART at 
+115200 baud takes 87 us per character on top of the formatting.
+*/
+#define BENCH_METRICS_VALUES 1000000
+#define BENCH_LOG_PRODUCERS 4
+#define BENCH_LOG_RECORDS 1000000
+
+static int bench_metrics_counters(void)
+{
+    bool failed = false;
+    int num_points = LWM2M_trace_synth(LWM2M_TRACE_WALK, 0.0f, 100.0f, 30000, 100, 4, trace, 36000);
+    printf("%-5s %5s %5s %8s %6s %5s %5s %5s %5s %5s %s\n", "step", "pmin", "pmax", "evals", "notif", 
+        "init", "step", "band", "pmin", "pmax", "counters");
+    for (unsigned a = 0; a < sizeof(bench_attributes) / sizeof(bench_attributes[0]); a++){
+        const LWM2M_attributes *attr = &bench_attributes[a];
+        LWM2M_replay_run(attr, BENCH_OBSERVERS, trace, num_points, &stats);
+        LWM2M_obs_counters total;
+        LWM2M_obs_get_counters(LWM2M_OBS_ALL, &total);
+        bool same = total.evaluations == stats.evaluations && total.send_failures == 0;
+        uint32_t reports = 0;
+        for (int cause = 0; cause < LWM2M_CAUSES; cause++){
+            same = same && total.reports[cause] == stats.by_cause[cause];
+            reports += total.reports[cause];
+        }
+        same = same && reports == stats.notifications;
+        failed = failed || !same;
+        printf("%5g %5g %5g %8u %6u %5u %5u %5u %5u %5u %s\n", attr->step, attr->pmin, attr->pmax,
+            total.evaluations, reports, total.reports[LWM2M_CAUSE_INIT], total.reports[LWM2M_CAUSE_STEP],
+            total.reports[LWM2M_CAUSE_BAND], total.reports[LWM2M_CAUSE_PMIN], total.reports[LWM2M_CAUSE_PMAX], 
+            same ? "ok" : "MISMATCH");
+    }
+
+    // the replay cancels its observations at the end, these two are kept: 
+    // per observation counters add up to the engine's
+    LWM2M_obs_table_init();
+    LWM2M_resource_set_attributes(0, &bench_attributes[1]);
+    uint8_t tokens[2] = {1, 2};
+    LWM2M_obs_counters total, sum;
+    memset(&sum, 0, sizeof(sum));
+    for (int i = 0; i < 2; i++){
+        LWM2M_notification_init(LWM2M_obs_create(0, &tokens[i], 1));
+    }
+    for (int i = 0; i < num_points; i++){
+        LWM2M_resource_update(0, trace[i].value);
+    }
+    LWM2M_obs_get_counters(LWM2M_OBS_ALL, &total);
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        LWM2M_obs_counters counters;
+        if (!LWM2M_obs_get_counters(obs, &counters)){
+            continue;
+        }
+        sum.evaluations += counters.evaluations;
+        for (int cause = 0; cause < LWM2M_CAUSES; cause++){
+            sum.reports[cause] += counters.reports[cause];
+        }
+    }
+    bool same = sum.evaluations == total.evaluations && total.evaluations == 2u * num_points;
+    for (int cause = 0; cause < LWM2M_CAUSES; cause++){
+        same = same && sum.reports[cause] == total.reports[cause];
+    }
+    LWM2M_resource_cancel(0);
+    failed = failed || !same;
+    printf("per observation counters add up: %s\n\n", same ? "ok" : "MISMATCH");
+    return failed ? 1 : 0;
+}
+
+static int bench_metrics_histogram(void)
+{
+    static LWM2M_histogram h;
+    static const float percents[] = {50, 90, 99, 99.9f};
+    std::vector<uint32_t> values(BENCH_METRICS_VALUES);
+    bool failed = false;
+
+    // log uniform from 1 ms to 10 min, as the latencies from pmin 0 to pmax
+    uint32_t random = 2463534242u;
+    for (uint32_t i = 0; i < BENCH_METRICS_VALUES; i++){
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        values[i] = (uint32_t)expf((random >> 8) / 16777216.0f * logf(600000.0f));
+    }
+    LWM2M_histogram_reset(&h);
+    double start = wall_seconds();
+    for (uint32_t i = 0; i < BENCH_METRICS_VALUES; i++){
+        LWM2M_histogram_add(&h, values[i]);
+    }
+    double elapsed = wall_seconds() - start;
+    std::sort(values.begin(), values.end());
+    printf("LWM2M_histogram: %u buckets, %u bytes, %.1f ns per value\n", LWM2M_HISTOGRAM_BUCKETS, 
+        (unsigned)sizeof(h), elapsed * 1e9 / BENCH_METRICS_VALUES);
+    printf("%8s %10s %10s %8s\n", "percent", "exact", "histogram", "error %");
+    for (unsigned p = 0; p < sizeof(percents) / sizeof(percents[0]); p++){
+        uint32_t rank = (uint32_t)ceilf(percents[p] / 100 * BENCH_METRICS_VALUES);
+        uint32_t exact = values[rank - 1];
+        uint32_t approximate = LWM2M_histogram_percentile(&h, percents[p]);
+        float error = exact ? 100.0f * ((float)approximate - exact) / exact : 0.0f;
+        bool within = approximate >= exact && error <= 100.0f / (1 << LWM2M_HISTOGRAM_SUB_BITS);
+        failed = failed || !within;
+        printf("%8g %10u %10u %8.2f %s\n", percents[p], exact, approximate, error, within ? "" : "MISMATCH");
+    }
+    printf("\n");
+    return failed ? 1 : 0;
+}
+
+static int bench_metrics_log(void)
+{
+    static LWM2M_log log;
+    LWM2M_log_record record;
+    char line[LWM2M_LOG_LINE_SIZE];
+    memset(&record, 0, sizeof(record));
+    record.event = LWM2M_LOG_NOTIFY;
+    record.cause = LWM2M_CAUSE_BAND;
+    record.flags = LWM2M_LOG_CON;
+    record.content_format = LWM2M_CT_SENML_JSON;
+    record.arg = 41;
+
+    // one thread, put and take in turn, against formatting the line
+    LWM2M_log_init(&log);
+    double start = wall_seconds();
+    for (uint32_t i = 0; i < BENCH_LOG_RECORDS; i++){
+        record.time_ms = i;
+        LWM2M_log_put(&log, &record);
+        LWM2M_log_take(&log, &record);
+    }
+    double put_ns = (wall_seconds() - start) * 1e9 / BENCH_LOG_RECORDS;
+    int len = 0;
+    start = wall_seconds();
+    for (uint32_t i = 0; i < BENCH_LOG_RECORDS; i++){
+        record.time_ms = i;
+        len = LWM2M_log_format(&record, line, sizeof(line));
+    }
+    double format_ns = (wall_seconds() - start) * 1e9 / BENCH_LOG_RECORDS;
+    printf("LWM2M_log: %u byte records, put and take %.1f ns, format %.1f ns, "
+        "\"%s\" to a UART %.0f us\n", (unsigned)sizeof(LWM2M_log_record), put_ns, format_ns, line, 
+        (len + 2) * 1e6 / 11520);
+
+    // producers racing for the ring, each record is taken once and in order per producer
+    LWM2M_log_init(&log);
+    std::atomic<int> running(BENCH_LOG_PRODUCERS);
+    std::vector<std::thread> producers;
+    start = wall_seconds();
+    for (int producer = 0; producer < BENCH_LOG_PRODUCERS; producer++){
+        producers.push_back(std::thread([&running, producer]{
+            LWM2M_log_record r;
+            memset(&r, 0, sizeof(r));
+            r.obs = producer;
+            for (uint32_t i = 0; i < BENCH_LOG_RECORDS; i++){
+                r.arg = i;
+                while (!LWM2M_log_put(&log, &r)){
+                    std::this_thread::yield(); // full, retried so that none is lost
+                }
+            }
+            running--;
+        }));
+    }
+    int32_t next[BENCH_LOG_PRODUCERS] = {0};
+    uint32_t taken = 0;
+    bool failed = false;
+    while (true){
+        bool done = running.load() == 0;
+        while (LWM2M_log_take(&log, &record)){
+            failed = failed || record.obs < 0 || record.obs >= BENCH_LOG_PRODUCERS || record.arg != next[record.obs];
+            if (!failed){
+                next[record.obs]++;
+            }
+            taken++;
+        }
+        if (done){
+            break;
+        }
+        std::this_thread::yield();
+    }
+    for (int producer = 0; producer < BENCH_LOG_PRODUCERS; producer++){
+        producers[producer].join();
+    }
+    double elapsed = wall_seconds() - start;
+    failed = failed || taken != BENCH_LOG_PRODUCERS * BENCH_LOG_RECORDS;
+    printf("LWM2M_log: %d producers, %u records taken, %.0f records/s, %u puts on a full ring, %s\n", BENCH_LOG_PRODUCERS, 
+        taken, elapsed > 0 ? taken / elapsed : 0.0, LWM2M_log_dropped(&log), failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
+
+static int bench_metrics(void)
+{
+    int failed = bench_metrics_counters();
+    failed |= bench_metrics_histogram();
+    failed |= bench_metrics_log();
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "queue") == 0){
+        return bench_queue();
+    }
+    if (argc > 1 && strcmp(argv[1], "wheel") == 0){
+        return bench_wheel();
+    }
+    if (argc > 1 && strcmp(argv[1], "bands") == 0){
+        return bench_bands();
+    }
+    if (argc > 1 && strcmp(argv[1], "batch") == 0){
+        return bench_batch();
+    }
+    if (argc > 1 && strcmp(argv[1], "link") == 0){
+        return bench_link();
+    }
+    if (argc > 1 && strcmp(argv[1], "coalesce") == 0){
+        return bench_coalesce();
+    }
+    if (argc > 1 && strcmp(argv[1], "fleet") == 0){
+        return bench_fleet();
+    }
+    if (argc > 1 && strcmp(argv[1], "energy") == 0){
+        return bench_energy();
+    }
+    if (argc > 1 && strcmp(argv[1], "eval") == 0){
+        return bench_eval();
+    }
+    if (argc > 1 && strcmp(argv[1], "stats") == 0){
+        return bench_stats();
+    }
+    if (argc > 1 && strcmp(argv[1], "hysteresis") == 0){
+        return bench_hysteresis();
+    }
+    if (argc > 1 && strcmp(argv[1], "cache") == 0){
+        return bench_cache();
+    }
+    if (argc > 1 && strcmp(argv[1], "blocks") == 0){
+        return bench_blocks();
+    }
+    if (argc > 1 && strcmp(argv[1], "persist") == 0){
+        return bench_persist(argc > 2 ? argv[2] : "lwm2m_persist.bin");
+    }
+    if (argc > 1 && strcmp(argv[1], "metrics") == 0){
+        return bench_metrics();
+    }
+
+    bench_header();
+    if (argc > 1){
+        int num_points = LWM2M_trace_load(argv[1], trace, BENCH_MAX_POINTS);
+        if (num_points <= 0){
+            fprintf(stderr, "cant read trace %s\n", argv[1]);
+            return 1;
+        }
+        bench_trace_run("recorded", num_points);
+        return 0;
+    }
+    for (unsigned t = 0; t < sizeof(bench_traces) / sizeof(bench_traces[0]); t++){
+        int num_points = LWM2M_trace_synth(bench_traces[t].shape, 0.0f, 100.0f,
+            bench_traces[t].period_ms, bench_traces[t].interval_ms, t + 1, trace, 36000);
+        bench_trace_run(bench_traces[t].name, num_points);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+LWM2M block-wise transfer
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_block.h"
+#include <string.h>
+
+bool LWM2M_block_parse(const uint8_t *ptr, uint8_t len, LWM2M_block *block)
+{
+    uint32_t value = 0;
+    if (len > LWM2M_BLOCK_OPTION_SIZE){
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++){
+        value = (value << 8) | ptr[i];
+    }
+    block->num = value >> 4;
+    block->more = (value & 0x08) != 0;
+    block->szx = value & 0x07;
+    return block->szx != 7;
+}
+
+uint8_t LWM2M_block_option(const LWM2M_block *block, uint8_t *buf)
+{
+    uint32_t value = (block->num << 4) | (block->more ? 0x08 : 0) | block->szx;
+    uint8_t len = (value > 0xFFFF) ? 3 : (value > 0xFF) ? 2 : 1;
+    for (uint8_t i = 0; i < len; i++){
+        buf[i] = (uint8_t)(value >> (8 * (len - 1 - i)));
+    }
+    return len;
+}
+
+void LWM2M_block1_init(LWM2M_block1_transfer *transfer)
+{
+    transfer->entry = -1;
+    transfer->received = 0;
+}
+
+int LWM2M_block1_receive(LWM2M_block1_transfer *transfer, int entry, const LWM2M_block *block,
+    const uint8_t *data, uint16_t len, uint32_t now)
+{
+    uint32_t offset = LWM2M_block_offset(block);
+
+    if (block->num == 0){
+        transfer->entry = (int16_t)entry;
+        transfer->received = 0;
+    }
+    else if (transfer->entry != entry || now - transfer->last_ms >= LWM2M_BLOCK1_TIMEOUT_MS){
+        transfer->entry = -1;
+        return LWM2M_BLOCK1_INCOMPLETE;
+    }
+    else if (offset != transfer->received){
+        // a retransmission of the block just stored, its answer was lost
+        if (block->more && offset < transfer->received && offset + len == transfer->received){
+            transfer->last_ms = now;
+            return LWM2M_BLOCK1_CONTINUE;
+        }
+        transfer->entry = -1;
+        return LWM2M_BLOCK1_INCOMPLETE;
+    }
+    // all but the last block are full (RFC 7959 2.3)
+    if (block->more && len != LWM2M_block_size(block)){
+        transfer->entry = -1;
+        return LWM2M_BLOCK1_INCOMPLETE;
+    }
+    if (offset + len > LWM2M_BLOCK1_PAYLOAD_SIZE){
+        transfer->entry = -1;
+        return LWM2M_BLOCK1_TOO_LARGE;
+    }
+    memcpy(transfer->payload + offset, data, len);
+    transfer->received = (uint16_t)(offset + len);
+    transfer->last_ms = now;
+    if (block->more){
+        return LWM2M_BLOCK1_CONTINUE;
+    }
+    transfer->entry = -1;
+    return LWM2M_BLOCK1_DONE;
+}
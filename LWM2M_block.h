@@ -0,0 +1,107 @@
+/*
+LWM2M block-wise transfer
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Block1 and Block2 options (RFC 7959) and the reassembly of a request
+payload sent in Block1 blocks.
+
+A block option value is NUM, M and SZX in one CoAP uint: the block number,
+more blocks follow, and the block size as 16 << SZX bytes. The byte offset
+of a block is NUM times its size, so a transfer can change to a smaller
+size between blocks.
+
+Block2 responses are encoded a block at a time by LWM2M_encode_block, see
+LWM2M_payload.h. Block1 payloads are assembled in a fixed buffer of
+LWM2M_BLOCK1_PAYLOAD_SIZE bytes, one transfer at a time, in order: a
+repeat of the last block is acknowledged again, any other block out of
+order fails the transfer.
+*/
+
+#ifndef LWM2M_BLOCK_H
+#define LWM2M_BLOCK_H
+
+#include <stdint.h>
+
+// largest block, 16 << LWM2M_BLOCK_SZX bytes, smaller blocks are used when asked for
+#ifndef LWM2M_BLOCK_SZX
+#define LWM2M_BLOCK_SZX 4
+#endif
+#if LWM2M_BLOCK_SZX > 6
+#error "LWM2M_BLOCK_SZX is at most 6, 1024 byte blocks"
+#endif
+#define LWM2M_BLOCK_SIZE (16 << LWM2M_BLOCK_SZX)
+
+// largest request payload assembled from Block1 blocks
+#ifndef LWM2M_BLOCK1_PAYLOAD_SIZE
+#define LWM2M_BLOCK1_PAYLOAD_SIZE 64
+#endif
+// a Block1 transfer not continued within this time is dropped
+#ifndef LWM2M_BLOCK1_TIMEOUT_MS
+#define LWM2M_BLOCK1_TIMEOUT_MS 30000
+#endif
+
+// block option values are at most 3 bytes
+#define LWM2M_BLOCK_OPTION_SIZE 3
+
+struct LWM2M_block {
+    uint32_t num; // block number
+    bool more; // M, more blocks follow
+    uint8_t szx; // size exponent, 0-6
+};
+
+// bytes in a block and the offset of its first byte
+#define LWM2M_block_size(block) (16UL << (block)->szx)
+#define LWM2M_block_offset(block) ((block)->num << ((block)->szx + 4))
+
+/*
+parse a Block1 or Block2 option value, false if it is longer than 3 bytes
+or has the reserved SZX 7
+*/
+bool LWM2M_block_parse(const uint8_t *ptr, uint8_t len, LWM2M_block *block);
+
+/*
+write a block option value, returns the length. A value of 0 is written
+as one zero byte rather than an empty option, so it reads as present.
+*/
+uint8_t LWM2M_block_option(const LWM2M_block *block, uint8_t *buf);
+
+// result of LWM2M_block1_receive
+enum {
+    LWM2M_BLOCK1_CONTINUE, // stored, answer 2.31 Continue
+    LWM2M_BLOCK1_DONE, // the last block, the payload is complete
+    LWM2M_BLOCK1_INCOMPLETE, // not the next block, answer 4.08
+    LWM2M_BLOCK1_TOO_LARGE // beyond the buffer, answer 4.13
+};
+
+struct LWM2M_block1_transfer {
+    int16_t entry; // registry entry written, -1 = none
+    uint32_t last_ms; // time of the last block
+    uint16_t received; // bytes so far, the offset of the next block
+    uint8_t payload[LWM2M_BLOCK1_PAYLOAD_SIZE];
+};
+
+void LWM2M_block1_init(LWM2M_block1_transfer *transfer);
+
+/*
+add a Block1 block of a request to entry. Block 0 starts a new transfer,
+dropping any other. After LWM2M_BLOCK1_DONE payload holds received bytes
+and the transfer is closed.
+*/
+int LWM2M_block1_receive(LWM2M_block1_transfer *transfer, int entry, const LWM2M_block *block,
+    const uint8_t *data, uint16_t len, uint32_t now);
+
+#endif // LWM2M_BLOCK_H
@@ -0,0 +1,98 @@
+/*
+LWM2M notification coalescing
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_coalesce.h"
+#include <string.h>
+
+void LWM2M_coalesce_init(LWM2M_coalesce *batch, uint32_t window_ms)
+{
+    batch->window_ms = window_ms;
+    LWM2M_coalesce_clear(batch);
+}
+
+bool LWM2M_coalesce_add(LWM2M_coalesce *batch, int obs, uint8_t cause, bool confirmable,
+    const LWM2M_record *records, int num_records, uint32_t now)
+{
+    if (num_records <= 0 || batch->num_records + num_records > LWM2M_COALESCE_RECORDS){
+        return false;
+    }
+    if (batch->num_items == 0){
+        batch->opened_ms = now;
+    }
+    LWM2M_coalesce_item *item = &batch->items[batch->num_items++];
+    item->obs = (int16_t)obs;
+    item->cause = cause;
+    item->confirmable = confirmable;
+    item->first_record = (uint8_t)batch->num_records;
+    item->num_records = (uint8_t)num_records;
+    item->added_ms = now;
+    memcpy(&batch->records[batch->num_records], records, num_records * sizeof(LWM2M_record));
+    batch->num_records += num_records;
+    return true;
+}
+
+bool LWM2M_coalesce_due(const LWM2M_coalesce *batch, uint32_t now)
+{
+    return batch->num_items && (int32_t)(now - (batch->opened_ms + batch->window_ms)) >= 0;
+}
+
+bool LWM2M_coalesce_next(const LWM2M_coalesce *batch, uint32_t *next_ms)
+{
+    if (batch->num_items == 0){
+        return false;
+    }
+    *next_ms = batch->opened_ms + batch->window_ms;
+    return true;
+}
+
+const LWM2M_record *LWM2M_coalesce_records(LWM2M_coalesce *batch, uint32_t now)
+{
+    for (int i = 0; i < batch->num_items; i++){
+        LWM2M_coalesce_item *item = &batch->items[i];
+        float held = (float)(now - item->added_ms) / 1000;
+        for (int r = item->first_record; r < item->first_record + item->num_records; r++){
+            batch->records[r].time -= held;
+        }
+        item->added_ms = now; // rebased, a retry after a refused send rebases from here
+    }
+    return batch->records;
+}
+
+void LWM2M_coalesce_remove(LWM2M_coalesce *batch, int index)
+{
+    if (index < 0 || index >= batch->num_items){
+        return;
+    }
+    LWM2M_coalesce_item removed = batch->items[index];
+    int records_after = batch->num_records - (removed.first_record + removed.num_records);
+    memmove(&batch->records[removed.first_record], &batch->records[removed.first_record + removed.num_records], 
+        records_after * sizeof(LWM2M_record));
+    batch->num_records -= removed.num_records;
+    for (int i = index + 1; i < batch->num_items; i++){
+        batch->items[i - 1] = batch->items[i];
+        batch->items[i - 1].first_record -= removed.num_records;
+    }
+    batch->num_items--;
+}
+
+void LWM2M_coalesce_clear(LWM2M_coalesce *batch)
+{
+    batch->num_items = 0;
+    batch->num_records = 0;
+}
@@ -0,0 +1,91 @@
+/*
+LWM2M notification coalescing
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Collects the notifications for one server that fall due within a window
+and hands them to the sender as one batch, to be sent as one composite
+payload: a SenML pack naming every record by its full path, as in the
+LWM2M 1.1 Observe-Composite. When 30 observed resources hit pmax together
+that is one radio wakeup instead of 30.
+
+The window opens with the first notification added and the batch is due
+window_ms later, or at once if it can't take the next notification. Each
+notification keeps its records, values queued in the pmin quiet period
+included, and the time it was added, so record times stay relative to the
+time of sending however long the batch was held. A window of 0 makes every
+batch a single notification, sent as it comes.
+
+Not locked, used by the sender only.
+*/
+
+#ifndef LWM2M_COALESCE_H
+#define LWM2M_COALESCE_H
+
+#include <stdint.h>
+#include "LWM2M_payload.h"
+
+// records in one batch
+#ifndef LWM2M_COALESCE_RECORDS
+#define LWM2M_COALESCE_RECORDS 16
+#endif
+
+// one notification in a batch
+struct LWM2M_coalesce_item {
+    int16_t obs;
+    uint8_t cause;
+    uint8_t confirmable;
+    uint8_t first_record, num_records;
+    uint32_t added_ms;
+};
+
+struct LWM2M_coalesce {
+    uint32_t window_ms;
+    uint32_t opened_ms; // first notification of the batch added
+    int num_items, num_records;
+    LWM2M_coalesce_item items[LWM2M_COALESCE_RECORDS];
+    LWM2M_record records[LWM2M_COALESCE_RECORDS];
+};
+
+void LWM2M_coalesce_init(LWM2M_coalesce *batch, uint32_t window_ms);
+
+/*
+add a notification of obs, records timed relative to now. False if the
+batch can't take it, it is then due: send it, clear it and add again.
+*/
+bool LWM2M_coalesce_add(LWM2M_coalesce *batch, int obs, uint8_t cause, bool confirmable,
+    const LWM2M_record *records, int num_records, uint32_t now);
+
+// true if the batch is to be sent at now
+bool LWM2M_coalesce_due(const LWM2M_coalesce *batch, uint32_t now);
+
+// when the batch falls due, false if it is empty
+bool LWM2M_coalesce_next(const LWM2M_coalesce *batch, uint32_t *next_ms);
+
+/*
+the records of the batch, times made relative to now, the time of sending
+*/
+const LWM2M_record *LWM2M_coalesce_records(LWM2M_coalesce *batch, uint32_t now);
+
+/*
+take the notification at index out of the batch with its records, e.g. of
+an observation cancelled while it was held
+*/
+void LWM2M_coalesce_remove(LWM2M_coalesce *batch, int index);
+
+void LWM2M_coalesce_clear(LWM2M_coalesce *batch);
+
+#endif // LWM2M_COALESCE_H
@@ -0,0 +1,245 @@
+/*
+LWM2M confirmable notifications and congestion control
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_confirm.h"
+#include <string.h>
+
+static LWM2M_confirm_state confirm_table[LWM2M_MAX_OBSERVATIONS];
+static LWM2M_confirm_stats confirm_stats;
+
+// rate limiter, no notification is sent before next_send_ms
+static uint32_t send_interval_ms;
+static uint32_t next_send_ms;
+
+// for the random part of the first timeout
+static uint32_t random_state;
+
+static bool time_reached(uint32_t time_ms, uint32_t now)
+{
+    return (int32_t)(now - time_ms) >= 0;
+}
+
+static uint32_t random_next(void)
+{
+    // xorshift32
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static int confirmable_in_flight(void)
+{
+    int count = 0;
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        count += confirm_table[obs].transmissions != 0;
+    }
+    return count;
+}
+
+static bool policy_confirmable(const LWM2M_confirm_state *st, uint8_t cause)
+{
+    if (st->every && st->since_confirmable + 1 >= st->every){
+        return true;
+    }
+    return (st->policy & LWM2M_CON_BAND) && (cause == LWM2M_CAUSE_BAND || cause == LWM2M_CAUSE_INIT);
+}
+
+// a timeout, back off
+static void congestion_loss(void)
+{
+    send_interval_ms = (send_interval_ms < LWM2M_SEND_INTERVAL_MAX_MS / 2) ? 
+        2 * send_interval_ms : LWM2M_SEND_INTERVAL_MAX_MS;
+}
+
+// an ACK, recover by a quarter of the interval, at least a step
+static void congestion_ack(void)
+{
+    uint32_t step = send_interval_ms / 4;
+    if (step < LWM2M_SEND_INTERVAL_STEP_MS){
+        step = LWM2M_SEND_INTERVAL_STEP_MS;
+    }
+    send_interval_ms = (send_interval_ms > LWM2M_SEND_INTERVAL_MIN_MS + step) ?
+        send_interval_ms - step : LWM2M_SEND_INTERVAL_MIN_MS;
+}
+
+void LWM2M_confirm_init(uint32_t now)
+{
+    memset(confirm_table, 0, sizeof(confirm_table));
+    memset(&confirm_stats, 0, sizeof(confirm_stats));
+    send_interval_ms = LWM2M_SEND_INTERVAL_MIN_MS;
+    next_send_ms = now;
+    random_state = now | 1;
+}
+
+void LWM2M_confirm_open(int obs, uint8_t policy, uint8_t every)
+{
+    LWM2M_confirm_close(obs);
+    confirm_table[obs].policy = policy;
+    confirm_table[obs].every = every;
+}
+
+void LWM2M_confirm_close(int obs)
+{
+    memset(&confirm_table[obs], 0, sizeof(LWM2M_confirm_state));
+}
+
+int LWM2M_confirm_decide(int obs, sample value, uint8_t cause, uint32_t now)
+{
+    LWM2M_confirm_state *st = &confirm_table[obs];
+    if (st->transmissions){
+        // RFC 7641 4.5.2, the newer notification goes in place of the next retransmission
+        st->value = value;
+        st->cause = cause;
+        st->superseded = 1;
+        confirm_stats.superseded++;
+        return LWM2M_SEND_HOLD;
+    }
+    bool confirmable = policy_confirmable(st, cause);
+    if (!time_reached(next_send_ms, now) || (confirmable && confirmable_in_flight() >= LWM2M_NSTART)){
+        confirm_stats.waits++;
+        return LWM2M_SEND_WAIT;
+    }
+    st->value = value;
+    st->cause = cause;
+    return confirmable ? LWM2M_SEND_CON : LWM2M_SEND_NON;
+}
+
+void LWM2M_confirm_sent(int obs, bool confirmable, uint16_t msg_id, uint32_t now)
+{
+    LWM2M_confirm_state *st = &confirm_table[obs];
+    st->last_msg_id = msg_id;
+    st->superseded = 0;
+    next_send_ms = now + send_interval_ms;
+    if (!confirmable){
+        if (st->since_confirmable < 0xFF){
+            st->since_confirmable++;
+        }
+        confirm_stats.non_confirmable++;
+        return;
+    }
+    if (st->transmissions == 0){
+        uint32_t spread = LWM2M_ACK_TIMEOUT_MS * (LWM2M_ACK_RANDOM_FACTOR_PCT - 100) / 100;
+        st->timeout_ms = LWM2M_ACK_TIMEOUT_MS + (spread ? random_next() % spread : 0);
+        st->since_confirmable = 0;
+        confirm_stats.confirmable++;
+    }
+    else{
+        st->timeout_ms *= 2;
+        confirm_stats.retransmissions++;
+    }
+    st->msg_ids[st->transmissions++] = msg_id;
+    st->deadline_ms = now + st->timeout_ms;
+}
+
+int LWM2M_confirm_response(uint16_t msg_id, bool reset)
+{
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        LWM2M_confirm_state *st = &confirm_table[obs];
+        bool match = reset && st->last_msg_id == msg_id && (st->since_confirmable || st->transmissions);
+        for (int i = 0; i < st->transmissions; i++){
+            match |= st->msg_ids[i] == msg_id;
+        }
+        if (!match){
+            continue;
+        }
+        if (reset){
+            confirm_stats.resets++;
+            LWM2M_confirm_close(obs);
+            return obs;
+        }
+        // an ACK to any transmission ends the exchange, a superseding
+        // notification not sent yet is now due
+        st->transmissions = 0;
+        confirm_stats.acks++;
+        congestion_ack();
+        return obs;
+    }
+    return -1;
+}
+
+int LWM2M_confirm_due(int obs, uint32_t now, LWM2M_confirm_send *send)
+{
+    for (; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        LWM2M_confirm_state *st = &confirm_table[obs];
+        if (st->transmissions){
+            if (!time_reached(st->deadline_ms, now)){
+                continue;
+            }
+            if (st->transmissions == 1){
+                congestion_loss(); // once per exchange
+            }
+            send->value = st->value;
+            send->cause = st->cause;
+            send->confirmable = true;
+            send->give_up = st->transmissions > LWM2M_MAX_RETRANSMIT;
+            if (send->give_up){
+                confirm_stats.given_up++;
+                LWM2M_confirm_close(obs);
+            }
+            return obs;
+        }
+        if (st->superseded && time_reached(next_send_ms, now)){
+            send->value = st->value;
+            send->cause = st->cause;
+            send->confirmable = policy_confirmable(st, st->cause) && confirmable_in_flight() < LWM2M_NSTART;
+            send->give_up = false;
+            return obs;
+        }
+    }
+    return -1;
+}
+
+bool LWM2M_confirm_next_deadline(uint32_t *next_ms)
+{
+    bool pending = false;
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        const LWM2M_confirm_state *st = &confirm_table[obs];
+        uint32_t deadline;
+        if (st->transmissions){
+            deadline = st->deadline_ms;
+        }
+        else if (st->superseded){
+            deadline = next_send_ms;
+        }
+        else{
+            continue;
+        }
+        if (!pending || (int32_t)(deadline - *next_ms) < 0){
+            *next_ms = deadline;
+        }
+        pending = true;
+    }
+    return pending;
+}
+
+uint32_t LWM2M_confirm_pmin_floor_ms(int observers)
+{
+    return (send_interval_ms > LWM2M_SEND_INTERVAL_MIN_MS) ? send_interval_ms * observers : 0;
+}
+
+uint32_t LWM2M_confirm_send_interval_ms(void)
+{
+    return send_interval_ms;
+}
+
+const LWM2M_confirm_stats *LWM2M_confirm_get_stats(void)
+{
+    return &confirm_stats;
+}
@@ -0,0 +1,174 @@
+/*
+LWM2M confirmable notifications and congestion control
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Decides, per observation, whether a notification goes confirmable (CON) or
+non-confirmable (NON), and runs the retransmission of CON notifications and
+a rate limiter for all of them. Like the attribute engine it does no I/O,
+the sender asks it how to send and reports what it sent and what the
+server answered.
+
+Policy: an observation sends every Nth notification CON, and optionally all
+band changes and initial notifications. The CON ones tell the client that
+the server is still there and give the rate limiter a loss signal.
+
+Retransmission follows RFC 7252 4.2: the first timeout is random between
+ACK_TIMEOUT and ACK_TIMEOUT * ACK_RANDOM_FACTOR, doubled on each of
+MAX_RETRANSMIT retransmissions, after which the observer is given up on.
+While a CON is in flight a newer notification of the same observation is
+not sent, it supersedes the one in flight (RFC 7641 4.5.2): it goes out at
+the next timeout in place of the retransmission, without resetting the
+retransmission count or timeout, or right after the ACK. A RST to any
+notification cancels the observation.
+
+Congestion control: at most NSTART CONs are in flight, and notifications
+are spaced by a send interval, which doubles on every timeout and shrinks
+by a step on every ACK. While the interval is above its minimum,
+LWM2M_confirm_pmin_floor_ms gives a pmin that spreads the observers over
+it, for LWM2M_obs_set_pmin_floor: a degraded link then gets fewer, later
+notifications instead of a flood, and the sender queue pushes back on the
+engine instead of dropping.
+
+Not locked, LWM2M_resource.cpp calls it under the attribute engine lock.
+*/
+
+#ifndef LWM2M_CONFIRM_H
+#define LWM2M_CONFIRM_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// RFC 7252 transmission parameters
+#ifndef LWM2M_ACK_TIMEOUT_MS
+#define LWM2M_ACK_TIMEOUT_MS 2000
+#endif
+#ifndef LWM2M_ACK_RANDOM_FACTOR_PCT
+#define LWM2M_ACK_RANDOM_FACTOR_PCT 150
+#endif
+#ifndef LWM2M_MAX_RETRANSMIT
+#define LWM2M_MAX_RETRANSMIT 4
+#endif
+#ifndef LWM2M_NSTART
+#define LWM2M_NSTART 1
+#endif
+
+// send interval bounds and the decrease per ACK
+#ifndef LWM2M_SEND_INTERVAL_MIN_MS
+#define LWM2M_SEND_INTERVAL_MIN_MS 100
+#endif
+#ifndef LWM2M_SEND_INTERVAL_MAX_MS
+#define LWM2M_SEND_INTERVAL_MAX_MS 60000
+#endif
+#ifndef LWM2M_SEND_INTERVAL_STEP_MS
+#define LWM2M_SEND_INTERVAL_STEP_MS 100
+#endif
+
+// default policy of new observations, one CON in LWM2M_CON_EVERY_DEFAULT
+#ifndef LWM2M_CON_EVERY_DEFAULT
+#define LWM2M_CON_EVERY_DEFAULT 16
+#endif
+#ifndef LWM2M_CON_POLICY_DEFAULT
+#define LWM2M_CON_POLICY_DEFAULT LWM2M_CON_BAND
+#endif
+
+// policy flags
+#define LWM2M_CON_BAND   0x01 // band changes and initial notifications are CON
+
+// LWM2M_confirm_decide results
+#define LWM2M_SEND_NON   0 // send now, non-confirmable
+#define LWM2M_SEND_CON   1 // send now, confirmable
+#define LWM2M_SEND_HOLD  2 // superseding a CON in flight, taken over, don't send
+#define LWM2M_SEND_WAIT  3 // rate limited, keep it and ask again later
+
+struct LWM2M_confirm_state {
+    uint32_t deadline_ms; // retransmission timeout of the CON in flight
+    uint32_t timeout_ms;
+    uint16_t msg_ids[LWM2M_MAX_RETRANSMIT + 1]; // every transmission of the CON in flight
+    uint16_t last_msg_id; // of the last notification, a RST to it cancels
+    sample value; // latest notification, sent on the next transmission
+    uint8_t cause;
+    uint8_t transmissions; // of the CON in flight, 0 = none
+    uint8_t superseded; // value is newer than the last transmission
+    uint8_t since_confirmable; // notifications since the last CON
+    uint8_t policy; // LWM2M_CON_* flags
+    uint8_t every; // every Nth notification is CON, 0 = none by count
+};
+
+// a transmission asked for by LWM2M_confirm_due
+struct LWM2M_confirm_send {
+    sample value;
+    uint8_t cause;
+    bool confirmable;
+    bool give_up; // no ACK after MAX_RETRANSMIT, the observation is to be cancelled
+};
+
+struct LWM2M_confirm_stats {
+    uint32_t non_confirmable;
+    uint32_t confirmable; // exchanges started
+    uint32_t retransmissions;
+    uint32_t acks;
+    uint32_t resets;
+    uint32_t given_up;
+    uint32_t superseded; // notifications taken over by a newer one before being sent
+    uint32_t waits; // decisions deferred by the rate limiter
+};
+
+void LWM2M_confirm_init(uint32_t now);
+
+// start an observation with a policy, or end one (nothing more is sent for it)
+void LWM2M_confirm_open(int obs, uint8_t policy, uint8_t every);
+void LWM2M_confirm_close(int obs);
+
+/*
+how to send a new notification of obs, LWM2M_SEND_*. The value is kept for
+retransmission.
+*/
+int LWM2M_confirm_decide(int obs, sample value, uint8_t cause, uint32_t now);
+
+/*
+a notification of obs was handed to the transport with msg_id. A CON
+transmission the transport refused is reported with confirmable set as
+well, it then counts as lost.
+*/
+void LWM2M_confirm_sent(int obs, bool confirmable, uint16_t msg_id, uint32_t now);
+
+/*
+an ACK or RST from the server, returns the observation it answers, -1 if
+none. After a RST the observation is to be cancelled.
+*/
+int LWM2M_confirm_response(uint16_t msg_id, bool reset);
+
+/*
+the first observation from obs on with a transmission due at now: a
+retransmission, the superseding notification after an ACK, or a give up.
+Returns -1 if there is none. Called in a loop from obs 0 after each pass.
+*/
+int LWM2M_confirm_due(int obs, uint32_t now, LWM2M_confirm_send *send);
+
+// when LWM2M_confirm_due next has work, false if nothing is pending
+bool LWM2M_confirm_next_deadline(uint32_t *next_ms);
+
+/*
+pmin for observers observations to stay within the send interval, 0 while
+the link is healthy
+*/
+uint32_t LWM2M_confirm_pmin_floor_ms(int observers);
+
+uint32_t LWM2M_confirm_send_interval_ms(void);
+const LWM2M_confirm_stats *LWM2M_confirm_get_stats(void);
+
+#endif // LWM2M_CONFIRM_H
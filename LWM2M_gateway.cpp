@@ -0,0 +1,400 @@
+/*
+LWM2M gateway runtime
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+The inbox is a single producer, single consumer ring as LWM2M_notify_queue:
+free running head and tail, each written by one side only. The consumer is
+whichever worker holds the busy flag of the shard; taking the flag with
+acquire and dropping it with release hands the engine, the outbox and the
+inbox head from one worker to the next.
+*/
+
+#include "LWM2M_gateway.h"
+#include <atomic>
+#include <new>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#define INBOX_MASK (LWM2M_GATEWAY_INBOX_SIZE - 1)
+
+#if (LWM2M_GATEWAY_INBOX_SIZE & INBOX_MASK) != 0
+#error "LWM2M_GATEWAY_INBOX_SIZE must be a power of 2"
+#endif
+
+// inbox message types
+#define MSG_UPDATE      0
+#define MSG_OBSERVE     1
+#define MSG_CANCEL      2
+#define MSG_ATTRIBUTES  3
+
+struct gateway_message {
+    uint8_t type;
+    uint8_t token_len;
+    uint16_t resource; // in the engine of the shard
+    union {
+        sample value;
+        uint8_t token[LWM2M_MAX_TOKEN_LEN];
+        LWM2M_attributes attributes;
+    };
+};
+
+struct gateway_shard {
+    // producer side
+    std::atomic<uint32_t> tail;
+    uint64_t refused;
+    uint8_t producer_pad[64]; // the sides on cache lines of their own
+
+    // consumer side, owned by the worker holding busy
+    std::atomic<bool> busy;
+    std::atomic<uint32_t> head;
+    LWM2M_engine *engine;
+    sample values[LWM2M_MAX_RESOURCES]; // last value of each resource, for get_sample
+    LWM2M_gateway_stats stats;
+    LWM2M_notify_queue outbox;
+
+    gateway_message inbox[LWM2M_GATEWAY_INBOX_SIZE];
+};
+
+static gateway_shard *shards = NULL;
+static int num_shards = 0;
+static int num_workers = 0;
+static pthread_t workers[LWM2M_GATEWAY_MAX_WORKERS];
+static std::atomic<bool> running(false);
+static LWM2M_gateway_send send_callback = NULL;
+static void *send_context = NULL;
+
+// the shard the calling worker runs, for the engine hooks
+static __thread gateway_shard *current = NULL;
+
+/*
+Platform hooks, the engine of the current shard queues its notifications in
+the outbox of the shard, a full outbox is retried by the engine
+*/
+bool send_notification(int obs, sample s, uint8_t cause, const LWM2M_quiet_queue *events)
+{
+    LWM2M_notify_entry group[LWM2M_NOTIFY_GROUP_SIZE];
+    uint32_t count = LWM2M_notify_group(group, obs, s, cause, events);
+    if (!LWM2M_notify_queue_push(&current->outbox, group, count)){
+        current->stats.send_failures++;
+        return false;
+    }
+    current->stats.reports[cause]++;
+    return true;
+}
+
+sample get_sample(uint16_t resource)
+{
+    return (current && resource < LWM2M_MAX_RESOURCES) ? current->values[resource] : 0;
+}
+
+static void handle_message(gateway_shard *shard, const gateway_message *m)
+{
+    int obs;
+    switch (m->type){
+    case MSG_UPDATE:
+        shard->values[m->resource] = m->value;
+        LWM2M_resource_update(m->resource, m->value);
+        shard->stats.updates++;
+        return;
+    case MSG_OBSERVE:
+        obs = LWM2M_obs_create(m->resource, m->token, m->token_len);
+        if (obs < 0){
+            shard->stats.table_full++;
+        }
+        else{
+            LWM2M_notification_init(obs); // the first notification answers the observe
+        }
+        break;
+    case MSG_CANCEL:
+        LWM2M_obs_release(LWM2M_obs_find(m->resource, m->token, m->token_len));
+        break;
+    case MSG_ATTRIBUTES:
+        LWM2M_resource_set_attributes(m->resource, &m->attributes);
+        break;
+    }
+    shard->stats.requests++;
+}
+
+/*
+hand the notification groups in the outbox to the send callback, with the
+observe number advanced, as LWM2M_transmit does on the device
+*/
+static uint32_t send_outbox(gateway_shard *shard, uint32_t index, int worker)
+{
+    LWM2M_notify_entry group[LWM2M_NOTIFY_GROUP_SIZE];
+    uint32_t available = LWM2M_notify_queue_count(&shard->outbox);
+    uint32_t sent = 0;
+    if (available == 0){
+        return 0;
+    }
+    shard->stats.outbox_high = (available > shard->stats.outbox_high) ? available : shard->stats.outbox_high;
+    uint32_t now = LWM2M_clock_ms();
+    for (uint32_t i = 0; i < available; ){
+        uint32_t count = 0;
+        do {
+            group[count++] = *LWM2M_notify_queue_peek(&shard->outbox, i++);
+        } while (!(group[count - 1].flags & LWM2M_NOTIFY_LAST));
+        LWM2M_observation *o = LWM2M_obs_get(group[count - 1].obs);
+        if (o){
+            int32_t latency_ms = (int32_t)(now - group[count - 1].time_ms);
+            LWM2M_histogram_add(&shard->stats.latency, (latency_ms > 0) ? latency_ms : 0);
+            o->obs_number++;
+            send_callback(send_context, worker, (uint32_t)o->resource * num_shards + index, o, group, count);
+            sent++;
+        }
+    }
+    LWM2M_notify_queue_pop(&shard->outbox, available);
+    shard->stats.notifications += sent;
+    return sent;
+}
+
+/*
+one run of a shard if no other worker has it, returns the work done,
+messages handled and notifications sent
+*/
+static uint32_t run_shard(int index, int worker)
+{
+    gateway_shard *shard = &shards[index];
+    if (shard->busy.exchange(true, std::memory_order_acquire)){
+        return 0;
+    }
+    current = shard;
+    LWM2M_engine_select(shard->engine);
+
+    uint32_t head = shard->head.load(std::memory_order_relaxed);
+    uint32_t available = shard->tail.load(std::memory_order_acquire) - head;
+    uint32_t count = (available < LWM2M_GATEWAY_BATCH) ? available : LWM2M_GATEWAY_BATCH;
+    for (uint32_t i = 0; i < count; i++){
+        handle_message(shard, &shard->inbox[(head + i) & INBOX_MASK]);
+    }
+    shard->head.store(head + count, std::memory_order_release);
+    LWM2M_obs_tick(LWM2M_clock_ms());
+    uint32_t sent = send_outbox(shard, index, worker);
+
+    shard->stats.runs++;
+    shard->stats.stolen += (index % num_workers) != worker;
+    LWM2M_engine_select(NULL);
+    current = NULL;
+    shard->busy.store(false, std::memory_order_release);
+    return count + sent;
+}
+
+// the shard away from home with the longest inbox, -1 if none is worth a steal
+static int steal_target(int worker)
+{
+    int target = -1;
+    uint32_t longest = LWM2M_GATEWAY_STEAL_BACKLOG - 1;
+    for (int index = 0; index < num_shards; index++){
+        gateway_shard *shard = &shards[index];
+        uint32_t backlog = shard->tail.load(std::memory_order_relaxed) - shard->head.load(std::memory_order_relaxed);
+        if (index % num_workers != worker && backlog > longest
+            && !shard->busy.load(std::memory_order_relaxed)){
+            target = index;
+            longest = backlog;
+        }
+    }
+    return target;
+}
+
+static void *worker_thread(void *arg)
+{
+    int worker = (int)(intptr_t)arg;
+    while (running.load(std::memory_order_relaxed)){
+        uint32_t work = 0;
+        for (int index = worker; index < num_shards; index += num_workers){
+            work += run_shard(index, worker);
+        }
+        if (work == 0){
+            int target = steal_target(worker);
+            if (target >= 0){
+                work = run_shard(target, worker);
+            }
+        }
+        if (work == 0){
+            struct timespec idle = {0, LWM2M_GATEWAY_IDLE_US * 1000L};
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void free_shards(void)
+{
+    for (int index = 0; index < num_shards; index++){
+        LWM2M_engine_destroy(shards[index].engine);
+    }
+    delete[] shards;
+    shards = NULL;
+    num_shards = 0;
+}
+
+bool LWM2M_gateway_start(int shard_count, int worker_count, LWM2M_gateway_send send, void *context)
+{
+    if (running.load() || shard_count < 1 || worker_count < 1 || worker_count > LWM2M_GATEWAY_MAX_WORKERS){
+        return false;
+    }
+    free_shards(); // of the last start
+    shards = new (std::nothrow) gateway_shard[shard_count];
+    if (!shards){
+        return false;
+    }
+    num_shards = shard_count;
+    for (int index = 0; index < num_shards; index++){
+        gateway_shard *shard = &shards[index];
+        shard->tail.store(0, std::memory_order_relaxed);
+        shard->head.store(0, std::memory_order_relaxed);
+        shard->busy.store(false, std::memory_order_relaxed);
+        shard->refused = 0;
+        memset(shard->values, 0, sizeof(shard->values));
+        memset(&shard->stats, 0, sizeof(shard->stats));
+        LWM2M_notify_queue_init(&shard->outbox);
+        shard->engine = LWM2M_engine_create();
+    }
+    for (int index = 0; index < num_shards; index++){
+        if (!shards[index].engine){
+            free_shards();
+            return false;
+        }
+        LWM2M_engine_select(shards[index].engine);
+        LWM2M_obs_table_init();
+    }
+    LWM2M_engine_select(NULL);
+
+    send_callback = send;
+    send_context = context;
+    num_workers = worker_count; // before the workers read it
+    running.store(true);
+    for (int worker = 0; worker < worker_count; worker++){
+        if (pthread_create(&workers[worker], NULL, &worker_thread, (void *)(intptr_t)worker) != 0){
+            num_workers = worker;
+            LWM2M_gateway_stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void LWM2M_gateway_stop(void)
+{
+    running.store(false);
+    for (int worker = 0; worker < num_workers; worker++){
+        pthread_join(workers[worker], NULL);
+    }
+}
+
+int LWM2M_gateway_shards(void)
+{
+    return num_shards;
+}
+
+/*
+producer side of the inbox of the shard of key, NULL if it is full
+*/
+static gateway_message *post_begin(uint32_t key, uint8_t type, gateway_shard **shard)
+{
+    if (num_shards == 0 || key / num_shards >= LWM2M_MAX_RESOURCES){
+        return NULL;
+    }
+    *shard = &shards[key % num_shards];
+    uint32_t tail = (*shard)->tail.load(std::memory_order_relaxed);
+    if (tail - (*shard)->head.load(std::memory_order_acquire) >= LWM2M_GATEWAY_INBOX_SIZE){
+        (*shard)->refused++;
+        return NULL;
+    }
+    gateway_message *m = &(*shard)->inbox[tail & INBOX_MASK];
+    m->type = type;
+    m->resource = (uint16_t)(key / num_shards);
+    return m;
+}
+
+static bool post_end(gateway_shard *shard)
+{
+    shard->tail.store(shard->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return true;
+}
+
+bool LWM2M_gateway_update(uint32_t key, sample value)
+{
+    gateway_shard *shard;
+    gateway_message *m = post_begin(key, MSG_UPDATE, &shard);
+    if (!m){
+        return false;
+    }
+    m->value = value;
+    return post_end(shard);
+}
+
+static bool post_token(uint32_t key, uint8_t type, const uint8_t *token, uint8_t token_len)
+{
+    gateway_shard *shard;
+    if (token_len > LWM2M_MAX_TOKEN_LEN){
+        return false;
+    }
+    gateway_message *m = post_begin(key, type, &shard);
+    if (!m){
+        return false;
+    }
+    m->token_len = token_len;
+    memcpy(m->token, token, token_len);
+    return post_end(shard);
+}
+
+bool LWM2M_gateway_observe(uint32_t key, const uint8_t *token, uint8_t token_len)
+{
+    return post_token(key, MSG_OBSERVE, token, token_len);
+}
+
+bool LWM2M_gateway_cancel(uint32_t key, const uint8_t *token, uint8_t token_len)
+{
+    return post_token(key, MSG_CANCEL, token, token_len);
+}
+
+bool LWM2M_gateway_set_attributes(uint32_t key, const LWM2M_attributes *attr)
+{
+    gateway_shard *shard;
+    gateway_message *m = post_begin(key, MSG_ATTRIBUTES, &shard);
+    if (!m){
+        return false;
+    }
+    m->attributes = *attr;
+    return post_end(shard);
+}
+
+void LWM2M_gateway_get_stats(int shard, LWM2M_gateway_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int index = 0; index < num_shards; index++){
+        if (shard != LWM2M_GATEWAY_ALL_SHARDS && shard != index){
+            continue;
+        }
+        const LWM2M_gateway_stats *s = &shards[index].stats;
+        stats->updates += s->updates;
+        stats->requests += s->requests;
+        stats->notifications += s->notifications;
+        stats->runs += s->runs;
+        stats->stolen += s->stolen;
+        stats->refused += shards[index].refused;
+        stats->table_full += s->table_full;
+        for (int cause = 0; cause < LWM2M_CAUSES; cause++){
+            stats->reports[cause] += s->reports[cause];
+        }
+        stats->send_failures += s->send_failures;
+        stats->outbox_high = (s->outbox_high > stats->outbox_high) ? s->outbox_high : stats->outbox_high;
+        LWM2M_histogram_merge(&stats->latency, &s->latency);
+    }
+}
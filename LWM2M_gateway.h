@@ -0,0 +1,128 @@
+/*
+LWM2M gateway runtime
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+The attribute engine run server side in a gateway that proxies observations
+of downstream sensors, on a Linux host with several cores.
+
+Resources are named by key. The observations are split into shards by key:
+key % shards is the shard, key / shards the resource in the engine of the
+shard, so keys run up to shards * LWM2M_MAX_RESOURCES - 1 and each shard
+holds up to LWM2M_MAX_OBSERVATIONS observations. A gateway build raises both
+at compile time, see LWM2M_gateway_bench.cpp.
+
+Every shard owns its engine (tables and timer wheel, see
+LWM2M_resource_attributes.h), an inbox of requests and sensor values and an
+outbox of triggered notifications. A shard is run by one worker thread at a
+time, claimed with an atomic flag, so nothing on the path from a sensor
+value to a notification takes a lock or touches another shard.
+
+Shard s is at home on worker s % workers, which runs its home shards round
+robin: takes up to LWM2M_GATEWAY_BATCH messages from the inbox, runs the
+expired pmin and pmax timers and hands the notifications in the outbox to
+the send callback. A worker with nothing to do at home steals a run of the
+shard with the longest inbox elsewhere. Stealing moves whole shards, so
+several shards per worker give it room to balance an uneven load.
+
+The inboxes have a single producer each: the functions that post to a shard
+are called for the keys of one shard from one thread, e.g. one receive
+thread per group of shards. This file provides the send_notification and
+get_sample hooks, it replaces LWM2M_resource.cpp in a gateway build.
+*/
+
+#ifndef LWM2M_GATEWAY_H
+#define LWM2M_GATEWAY_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+#include "LWM2M_notify_queue.h"
+#include "LWM2M_histogram.h"
+
+// messages per inbox, a power of 2
+#ifndef LWM2M_GATEWAY_INBOX_SIZE
+#define LWM2M_GATEWAY_INBOX_SIZE 4096
+#endif
+// messages taken from an inbox per run of a shard
+#ifndef LWM2M_GATEWAY_BATCH
+#define LWM2M_GATEWAY_BATCH 256
+#endif
+// a worker idle at home steals from a shard with at least this many messages waiting
+#ifndef LWM2M_GATEWAY_STEAL_BACKLOG
+#define LWM2M_GATEWAY_STEAL_BACKLOG 64
+#endif
+// sleep of a worker that found no work anywhere
+#ifndef LWM2M_GATEWAY_IDLE_US
+#define LWM2M_GATEWAY_IDLE_US 200
+#endif
+#ifndef LWM2M_GATEWAY_MAX_WORKERS
+#define LWM2M_GATEWAY_MAX_WORKERS 64
+#endif
+
+/*
+a notification group taken from the outbox of a shard (see
+LWM2M_notify_queue.h), entries[count-1] is the reported value. o is the
+observation with the observe number of this notification, valid only
+during the call.
+*/
+typedef void (*LWM2M_gateway_send)(void *context, int worker, uint32_t key,
+    const LWM2M_observation *o, const LWM2M_notify_entry *entries, uint32_t count);
+
+// counters of a shard, complete once LWM2M_gateway_stop returned
+struct LWM2M_gateway_stats {
+    uint64_t updates; // sensor values evaluated
+    uint64_t requests; // observe, cancel and attribute messages handled
+    uint64_t notifications;
+    uint64_t runs; // runs of the shard
+    uint64_t stolen; // runs by a worker the shard is not at home on
+    uint64_t refused; // posts to a full inbox
+    uint64_t table_full; // observations not started, no free row
+    uint64_t reports[LWM2M_CAUSES]; // notifications queued in the outbox, by cause
+    uint64_t send_failures; // notifications refused by a full outbox, retried by the engine
+    uint32_t outbox_high; // most entries in the outbox at the end of a run
+    LWM2M_histogram latency; // ms from the report of a value to the send callback
+};
+
+/*
+create shards engines, each with resources for keys and no observations,
+and start workers threads on them. The send callback runs on the workers.
+false if the memory or threads can't be had, or the gateway is running.
+*/
+bool LWM2M_gateway_start(int shards, int workers, LWM2M_gateway_send send, void *context);
+
+// stop the workers. Messages still in the inboxes are dropped, the shards
+// and their counters are kept until the next start.
+void LWM2M_gateway_stop(void);
+
+int LWM2M_gateway_shards(void);
+
+/*
+post to the shard of key, false if the inbox of the shard is full or the key
+is out of range
+*/
+// a new sensor value, evaluated against every observation of the resource
+bool LWM2M_gateway_update(uint32_t key, sample value);
+// start an observation by token, with the attributes of the resource
+bool LWM2M_gateway_observe(uint32_t key, const uint8_t *token, uint8_t token_len);
+bool LWM2M_gateway_cancel(uint32_t key, const uint8_t *token, uint8_t token_len);
+// Write Attributes of the resource, applied to its observations
+bool LWM2M_gateway_set_attributes(uint32_t key, const LWM2M_attributes *attr);
+
+// counters of one shard, or summed over LWM2M_GATEWAY_ALL_SHARDS
+#define LWM2M_GATEWAY_ALL_SHARDS -1
+void LWM2M_gateway_get_stats(int shard, LWM2M_gateway_stats *stats);
+
+#endif // LWM2M_GATEWAY_H
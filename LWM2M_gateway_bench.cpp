@@ -0,0 +1,351 @@
+/*
+LWM2M gateway benchmark
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Host benchmark for LWM2M_gateway, not part of the mbed build. The tables are
+sized for a gateway at compile time, build on Linux with
+
+  g++ -O2 -std=c++11 -pthread -DLWM2M_MAX_OBSERVATIONS=16384 \
+      -DLWM2M_MAX_RESOURCES=1024 -DLWM2M_NOTIFY_QUEUE_SIZE=1024 -DLWM2M_SKETCH_SIZE=0 \
+      -o lwm2m_gateway_bench LWM2M_gateway_bench.cpp LWM2M_gateway.cpp \
+      LWM2M_resource_attributes.cpp LWM2M_timer_wheel.cpp \
+      LWM2M_pmax_schedule.cpp LWM2M_notify_queue.cpp LWM2M_payload.cpp \
+      LWM2M_host.cpp LWM2M_sensor.cpp LWM2M_sample_plan.cpp \
+      LWM2M_aggregate.cpp LWM2M_histogram.cpp
+
+and run
+
+  ./lwm2m_gateway_bench [workers [shards [observers]]]
+
+64 shards of 1024 resources each, observed by 16 observers (1M observations
+with the defaults), with gt 75, lt 25, step 5 and no pmin or pmax. Feeder
+threads, one per 4 workers, post random walk values of every resource, and
+the notifications are sent as CoAP NON datagrams with a SenML payload over
+UDP on the loopback interface to a receiver thread, which stands in for the
+upstream servers. Datagrams are sent with sendmmsg in batches per worker.
+
+For 1, 2, 4 ... up to workers (the number of cores by default) the gateway
+is started and fed for BENCH_SECONDS. Per run it prints sensor values and
+evaluations (values times observers) per second, notifications per second,
+datagrams received, the share of shard runs that were stolen, the 99th
+percentile of the time from the report of a value to its send callback, and
+the posts refused by a full inbox, which shows the workers, not the
+feeders, were the limit.
+*/
+
+#include "LWM2M_gateway.h"
+#include "LWM2M_payload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define BENCH_SECONDS 3
+#define BENCH_SHARDS 64
+#define BENCH_OBSERVERS 16
+#define BENCH_WORKERS_PER_FEEDER 4
+#define BENCH_DATAGRAM_SIZE 256
+#define BENCH_SEND_BATCH 64
+
+// notification attributes of every resource
+static const LWM2M_attributes bench_attributes = {
+    75.0f, 25.0f, 5.0f, // gt, lt, step
+    0.0f, 0.0f, 0.0f, 0.0f, // pmin, pmax, epmin, epmax
+    0, 0.0f, 0.0f, // statistics, hysteresis, dwell
+    0, {0}, {0} // no application band limits
+};
+
+// datagrams of a worker waiting for sendmmsg, and its counters
+struct bench_worker {
+    int socket;
+    uint16_t msg_id;
+    int pending;
+    uint8_t datagrams[BENCH_SEND_BATCH][BENCH_DATAGRAM_SIZE];
+    struct iovec iov[BENCH_SEND_BATCH];
+    struct mmsghdr msgs[BENCH_SEND_BATCH];
+    std::atomic<uint64_t> notifications;
+    std::atomic<uint64_t> datagrams_sent;
+};
+
+static bench_worker *bench_workers;
+static std::atomic<bool> feeding;
+
+static double wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void bench_flush(bench_worker *w)
+{
+    int done = 0;
+    while (done < w->pending){
+        int n = sendmmsg(w->socket, &w->msgs[done], w->pending - done, 0);
+        if (n <= 0){
+            break; // dropped, the receiver counts what arrived
+        }
+        done += n;
+    }
+    w->datagrams_sent.fetch_add(done, std::memory_order_relaxed);
+    w->pending = 0;
+}
+
+/*
+a notification as a CoAP NON 2.05 with the token, Observe and Content-Format
+options and a SenML JSON payload named after the key
+*/
+static void bench_send(void *context, int worker, uint32_t key,
+    const LWM2M_observation *o, const LWM2M_notify_entry *entries, uint32_t count)
+{
+    (void)context;
+    bench_worker *w = &bench_workers[worker];
+    uint8_t *d = w->datagrams[w->pending];
+    int len = 0;
+    d[len++] = 0x50 | o->token_len; // version 1, NON
+    d[len++] = 0x45; // 2.05 Content
+    d[len++] = (uint8_t)(w->msg_id >> 8);
+    d[len++] = (uint8_t)w->msg_id++;
+    memcpy(&d[len], o->token, o->token_len);
+    len += o->token_len;
+    d[len++] = 0x61; // Observe, 1 byte
+    d[len++] = o->obs_number;
+    d[len++] = 0x61; // Content-Format, delta 6, 1 byte
+    d[len++] = LWM2M_CT_SENML_JSON;
+    d[len++] = 0xFF;
+
+    LWM2M_record records[LWM2M_NOTIFY_GROUP_SIZE];
+    for (uint32_t i = 0; i < count; i++){
+        records[i].object = LWM2M_RECORD_NO_OBJECT;
+        records[i].instance = LWM2M_RECORD_NO_INSTANCE;
+        records[i].resource = 0;
+        records[i].value = entries[i].value;
+        records[i].time = (int32_t)(entries[i].time_ms - entries[count - 1].time_ms) / 1000.0f;
+    }
+    char base_name[16];
+    snprintf(base_name, sizeof(base_name), "/%u/0/", key);
+    int payload = LWM2M_encode(LWM2M_CT_SENML_JSON, base_name, records, count, &d[len], BENCH_DATAGRAM_SIZE - len);
+    if (payload < 0){
+        return;
+    }
+    w->iov[w->pending].iov_len = len + payload;
+    w->notifications.fetch_add(1, std::memory_order_relaxed);
+    if (++w->pending == BENCH_SEND_BATCH){
+        bench_flush(w);
+    }
+}
+
+// the upstream stand-in, counts what arrives until feeding stops and the socket is quiet
+static void bench_receive(int socket, uint64_t *received)
+{
+    static uint8_t buffers[BENCH_SEND_BATCH][BENCH_DATAGRAM_SIZE];
+    struct iovec iov[BENCH_SEND_BATCH];
+    struct mmsghdr msgs[BENCH_SEND_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < BENCH_SEND_BATCH; i++){
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = BENCH_DATAGRAM_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    struct pollfd fd = {socket, POLLIN, 0};
+    while (true){
+        if (poll(&fd, 1, 100) <= 0){
+            if (!feeding.load()){
+                break;
+            }
+            continue;
+        }
+        int n = recvmmsg(socket, msgs, BENCH_SEND_BATCH, MSG_DONTWAIT, NULL);
+        if (n > 0){
+            *received += n;
+        }
+    }
+}
+
+// random walk of the value of each key of the feeder, every key in turn,
+// a value refused by a full inbox is dropped
+static void bench_feed(const std::vector<uint32_t> *keys, uint32_t seed)
+{
+    std::vector<sample> values(keys->size(), 50.0f);
+    uint32_t random = seed;
+    while (feeding.load(std::memory_order_relaxed)){
+        for (size_t i = 0; i < keys->size(); i++){
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            sample v = values[i] + 0.5f * ((int)(random % 5) - 2);
+            values[i] = (v < 0.0f) ? 0.0f : (v > 100.0f) ? 100.0f : v;
+            if (!LWM2M_gateway_update((*keys)[i], values[i])){
+                std::this_thread::yield(); // the workers are behind
+            }
+        }
+    }
+}
+
+static uint64_t bench_notifications(int workers)
+{
+    uint64_t total = 0;
+    for (int worker = 0; worker < workers; worker++){
+        total += bench_workers[worker].notifications.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+static int bench_run(int workers, int shards, uint32_t keys, int observers, int receiver)
+{
+    LWM2M_gateway_stats stats;
+    struct sockaddr_in address;
+    socklen_t address_len = sizeof(address);
+    getsockname(receiver, (struct sockaddr *)&address, &address_len);
+    for (int worker = 0; worker < workers; worker++){
+        bench_worker *w = &bench_workers[worker];
+        w->socket = socket(AF_INET, SOCK_DGRAM, 0);
+        connect(w->socket, (struct sockaddr *)&address, sizeof(address));
+        w->msg_id = 0;
+        w->pending = 0;
+        memset(w->msgs, 0, sizeof(w->msgs));
+        for (int i = 0; i < BENCH_SEND_BATCH; i++){
+            w->iov[i].iov_base = w->datagrams[i];
+            w->msgs[i].msg_hdr.msg_iov = &w->iov[i];
+            w->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        w->notifications.store(0);
+        w->datagrams_sent.store(0);
+    }
+    uint64_t received = 0;
+    feeding.store(true);
+    std::thread receive_thread(bench_receive, receiver, &received);
+    if (!LWM2M_gateway_start(shards, workers, &bench_send, NULL)){
+        fprintf(stderr, "cant start the gateway\n");
+        return 1;
+    }
+
+    // observers of every key, each answered by its first notification
+    uint64_t observations = (uint64_t)keys * observers;
+    for (uint32_t key = 0; key < keys; key++){
+        while (!LWM2M_gateway_set_attributes(key, &bench_attributes)){
+            std::this_thread::yield();
+        }
+    }
+    for (int observer = 0; observer < observers; observer++){
+        for (uint32_t key = 0; key < keys; key++){
+            uint8_t token[4] = {(uint8_t)observer, (uint8_t)(key >> 16), (uint8_t)(key >> 8), (uint8_t)key};
+            while (!LWM2M_gateway_observe(key, token, sizeof(token))){
+                std::this_thread::yield();
+            }
+        }
+    }
+    while (bench_notifications(workers) < observations){
+        std::this_thread::yield();
+    }
+
+    // feeders, each owning the inboxes of a group of shards
+    int feeders = (workers + BENCH_WORKERS_PER_FEEDER - 1) / BENCH_WORKERS_PER_FEEDER;
+    std::vector<std::vector<uint32_t> > feeder_keys(feeders);
+    for (uint32_t key = 0; key < keys; key++){
+        feeder_keys[(key % shards) % feeders].push_back(key);
+    }
+    uint64_t notified = bench_notifications(workers);
+    double start = wall_seconds();
+    std::vector<std::thread> feed_threads;
+    for (int feeder = 0; feeder < feeders; feeder++){
+        feed_threads.push_back(std::thread(bench_feed, &feeder_keys[feeder], 2463534242u + feeder));
+    }
+    sleep(BENCH_SECONDS);
+    feeding.store(false);
+    for (int feeder = 0; feeder < feeders; feeder++){
+        feed_threads[feeder].join();
+    }
+    LWM2M_gateway_stop();
+    double elapsed = wall_seconds() - start;
+    for (int worker = 0; worker < workers; worker++){
+        bench_flush(&bench_workers[worker]);
+    }
+    receive_thread.join();
+    LWM2M_gateway_get_stats(LWM2M_GATEWAY_ALL_SHARDS, &stats);
+    notified = bench_notifications(workers) - notified;
+
+    uint64_t sent = 0;
+    for (int worker = 0; worker < workers; worker++){
+        sent += bench_workers[worker].datagrams_sent.load();
+        close(bench_workers[worker].socket);
+    }
+    printf("%7d %7d %11.0f %12.0f %11.0f %10.1f %8.1f %8lu %9llu %s\n", workers, feeders,
+        stats.updates / elapsed, stats.updates * (double)observers / elapsed, notified / elapsed,
+        sent ? 100.0 * received / sent : 0.0, stats.runs ? 100.0 * stats.stolen / stats.runs : 0.0,
+        (unsigned long)LWM2M_histogram_percentile(&stats.latency, 99), (unsigned long long)stats.refused, stats.table_full ? "TABLE FULL" : "");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int max_workers = (argc > 1) ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int shards = (argc > 2) ? atoi(argv[2]) : BENCH_SHARDS;
+    int observers = (argc > 3) ? atoi(argv[3]) : BENCH_OBSERVERS;
+    if (max_workers < 1){
+        max_workers = 1;
+    }
+    if (max_workers > LWM2M_GATEWAY_MAX_WORKERS){
+        max_workers = LWM2M_GATEWAY_MAX_WORKERS;
+    }
+    uint32_t keys = (uint32_t)shards * LWM2M_MAX_RESOURCES;
+    if (shards < 1 || observers < 1 || observers * LWM2M_MAX_RESOURCES > LWM2M_MAX_OBSERVATIONS){
+        fprintf(stderr, "observers * %d resources are more than %d observations per shard\n",
+            LWM2M_MAX_RESOURCES, LWM2M_MAX_OBSERVATIONS);
+        return 1;
+    }
+
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int buffer = 16 << 20;
+    setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    if (bind(receiver, (struct sockaddr *)&address, sizeof(address)) != 0){
+        fprintf(stderr, "cant bind the loopback receiver\n");
+        return 1;
+    }
+    bench_workers = new bench_worker[max_workers];
+
+    printf("%d shards, %u resources, %llu observations, %d s per run\n", shards, keys,
+        (unsigned long long)keys * observers, BENCH_SECONDS);
+    printf("%7s %7s %11s %12s %11s %10s %8s %8s %9s\n", "workers", "feeders", "values/s",
+        "evals/s", "notif/s", "% arrived", "% stolen", "p99 ms", "refused");
+    for (int workers = 1; ; workers *= 2){
+        if (workers > max_workers){
+            workers = max_workers;
+        }
+        if (bench_run(workers, shards, keys, observers, receiver) != 0){
+            return 1;
+        }
+        if (workers == max_workers){
+            break;
+        }
+    }
+    close(receiver);
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+LWM2M latency histogram
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_histogram.h"
+#include <string.h>
+#include <math.h>
+
+#define SUB_BUCKETS (1u << LWM2M_HISTOGRAM_SUB_BITS)
+#define TOP_VALUE ((uint32_t)((1ull << LWM2M_HISTOGRAM_BITS) - 1))
+
+// index of the highest bit set, value > 0
+static int highest_bit(uint32_t value)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(value);
+#else
+    int bit = 0;
+    while (value >>= 1){
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/*
+values below SUB_BUCKETS are their own bucket. Above, the power of 2 picks
+the group of SUB_BUCKETS buckets and the bits below the highest one the
+bucket in the group.
+*/
+static uint32_t bucket_of(uint32_t value)
+{
+    if (value > TOP_VALUE){
+        value = TOP_VALUE;
+    }
+    if (value < SUB_BUCKETS){
+        return value;
+    }
+    int bit = highest_bit(value);
+    return ((uint32_t)(bit - LWM2M_HISTOGRAM_SUB_BITS + 1) << LWM2M_HISTOGRAM_SUB_BITS)
+        + (value >> (bit - LWM2M_HISTOGRAM_SUB_BITS)) - SUB_BUCKETS;
+}
+
+// highest value counted in a bucket
+static uint32_t bucket_top(uint32_t bucket)
+{
+    uint32_t group = bucket >> LWM2M_HISTOGRAM_SUB_BITS;
+    uint32_t sub = bucket & (SUB_BUCKETS - 1);
+    if (group == 0){
+        return sub;
+    }
+    uint64_t low = (uint64_t)(SUB_BUCKETS + sub) << (group - 1);
+    return (uint32_t)(low + (1ull << (group - 1)) - 1);
+}
+
+void LWM2M_histogram_reset(LWM2M_histogram *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+void LWM2M_histogram_add(LWM2M_histogram *h, uint32_t value)
+{
+    h->buckets[bucket_of(value)]++;
+    h->count++;
+    h->max = (value > h->max) ? value : h->max;
+}
+
+void LWM2M_histogram_merge(LWM2M_histogram *h, const LWM2M_histogram *other)
+{
+    for (int bucket = 0; bucket < LWM2M_HISTOGRAM_BUCKETS; bucket++){
+        h->buckets[bucket] += other->buckets[bucket];
+    }
+    h->count += other->count;
+    h->max = (other->max > h->max) ? other->max : h->max;
+}
+
+uint32_t LWM2M_histogram_percentile(const LWM2M_histogram *h, float q)
+{
+    if (h->count == 0){
+        return 0;
+    }
+    q = (q < 0) ? 0 : (q > 100) ? 100 : q;
+    // rank of the value, 1 to count
+    uint32_t rank = (uint32_t)ceilf(q / 100 * h->count);
+    rank = rank ? rank : 1;
+    uint32_t seen = 0;
+    for (int bucket = 0; bucket < LWM2M_HISTOGRAM_BUCKETS; bucket++){
+        seen += h->buckets[bucket];
+        if (seen >= rank){
+            uint32_t top = bucket_top(bucket);
+            return (top < h->max) ? top : h->max;
+        }
+    }
+    return h->max; // counts behind count, read while being written
+}
@@ -0,0 +1,73 @@
+/*
+LWM2M latency histogram
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Counts of values, e.g. milliseconds from a sample to the sending of its
+notification, in buckets of bounded relative width as in an HDR histogram:
+values below 2^LWM2M_HISTOGRAM_SUB_BITS have a bucket each, above that
+every power of 2 is split into 2^LWM2M_HISTOGRAM_SUB_BITS buckets of equal
+width. A percentile read back is the highest value of its bucket, at or
+above the value recorded and at most 1/2^LWM2M_HISTOGRAM_SUB_BITS above
+it: 3.1% with the default of 5, over the whole range, in fixed memory of
+4 bytes per bucket, 640 buckets (2.5 KB) for values up to 2^24 ms (4.6
+hours). Each sub bit less doubles the bound and halves the memory, 3 gives
+12.5% in 712 bytes. Larger values are counted in the last bucket, the
+maximum is kept exactly.
+
+Adding a value is a few shifts and an increment, with no search. Not
+locked, one writer; a reader on another thread sees counts that may be
+an addition behind each other.
+*/
+
+#ifndef LWM2M_HISTOGRAM_H
+#define LWM2M_HISTOGRAM_H
+
+#include <stdint.h>
+
+// buckets per power of 2, as bits: percentiles within 1/2^bits, 3.1% for 5
+#ifndef LWM2M_HISTOGRAM_SUB_BITS
+#define LWM2M_HISTOGRAM_SUB_BITS 5
+#endif
+// values up to 2^LWM2M_HISTOGRAM_BITS - 1 are told apart
+#ifndef LWM2M_HISTOGRAM_BITS
+#define LWM2M_HISTOGRAM_BITS 24
+#endif
+#if LWM2M_HISTOGRAM_BITS > 32 || LWM2M_HISTOGRAM_SUB_BITS >= LWM2M_HISTOGRAM_BITS
+#error "LWM2M_HISTOGRAM_SUB_BITS is to be less than LWM2M_HISTOGRAM_BITS, at most 32"
+#endif
+#define LWM2M_HISTOGRAM_BUCKETS \
+    ((LWM2M_HISTOGRAM_BITS - LWM2M_HISTOGRAM_SUB_BITS + 1) << LWM2M_HISTOGRAM_SUB_BITS)
+
+struct LWM2M_histogram {
+    uint32_t count; // values added
+    uint32_t max;
+    uint32_t buckets[LWM2M_HISTOGRAM_BUCKETS];
+};
+
+void LWM2M_histogram_reset(LWM2M_histogram *h);
+void LWM2M_histogram_add(LWM2M_histogram *h, uint32_t value);
+
+// add the counts of another histogram, e.g. of another thread
+void LWM2M_histogram_merge(LWM2M_histogram *h, const LWM2M_histogram *other);
+
+/*
+the value at or below which q percent of the values are, the highest value
+of its bucket but not more than the maximum. 0 if the histogram is empty.
+*/
+uint32_t LWM2M_histogram_percentile(const LWM2M_histogram *h, float q);
+
+#endif // LWM2M_HISTOGRAM_H
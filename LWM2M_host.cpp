@@ -0,0 +1,202 @@
+/*
+LWM2M host (Linux) platform backend
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_host.h"
+#include "LWM2M_sensor.h"
+#include "LWM2M_persist.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static bool clock_simulated = false;
+static uint32_t simulated_ms = 0;
+
+// wakeup of the thread running the engine
+static pthread_mutex_t wakeup_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup_cond = PTHREAD_COND_INITIALIZER;
+static bool wakeup_pending = false;
+
+static volatile sample adc_channels[LWM2M_HOST_ADC_CHANNELS];
+
+// mapped storage file, two regions
+static int persist_fd = -1;
+static uint8_t *persist_map = NULL;
+static uint32_t persist_budget = LWM2M_HOST_PERSIST_NO_LIMIT; // bytes left before a simulated reset
+
+void LWM2M_host_clock_simulated(bool simulated)
+{
+    clock_simulated = simulated;
+}
+
+void LWM2M_host_clock_set(uint32_t now_ms)
+{
+    simulated_ms = now_ms;
+}
+
+void LWM2M_host_clock_advance(uint32_t ms, uint32_t step_ms)
+{
+    if (step_ms == 0){
+        step_ms = ms;
+    }
+    while (ms > 0){
+        uint32_t step = (ms < step_ms) ? ms : step_ms;
+        simulated_ms += step;
+        ms -= step;
+        LWM2M_sensor_poll(simulated_ms);
+        LWM2M_obs_tick(simulated_ms);
+    }
+}
+
+void LWM2M_host_wait(uint32_t timeout_ms)
+{
+    pthread_mutex_lock(&wakeup_lock);
+    if (!clock_simulated && !wakeup_pending){
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000){
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while (!wakeup_pending){
+            if (pthread_cond_timedwait(&wakeup_cond, &wakeup_lock, &deadline) != 0){
+                break; // timed out
+            }
+        }
+    }
+    wakeup_pending = false;
+    pthread_mutex_unlock(&wakeup_lock);
+}
+
+void LWM2M_host_adc_set(int channel, sample value)
+{
+    if (channel >= 0 && channel < LWM2M_HOST_ADC_CHANNELS){
+        adc_channels[channel] = value;
+    }
+}
+
+sample LWM2M_host_adc_read(void *context)
+{
+    intptr_t channel = (intptr_t)context;
+    return (channel >= 0 && channel < LWM2M_HOST_ADC_CHANNELS) ? adc_channels[channel] : 0;
+}
+
+bool LWM2M_host_persist_open(const char *path)
+{
+    const off_t size = 2 * LWM2M_PERSIST_REGION_SIZE;
+    struct stat st;
+
+    LWM2M_host_persist_close();
+    persist_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (persist_fd < 0){
+        return false;
+    }
+    bool created = fstat(persist_fd, &st) == 0 && st.st_size < size;
+    if (created && ftruncate(persist_fd, size) != 0){
+        LWM2M_host_persist_close();
+        return false;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, persist_fd, 0);
+    if (map == MAP_FAILED){
+        LWM2M_host_persist_close();
+        return false;
+    }
+    persist_map = (uint8_t *)map;
+    if (created){
+        memset(persist_map, 0xFF, size);
+    }
+    return true;
+}
+
+void LWM2M_host_persist_close(void)
+{
+    if (persist_map){
+        munmap(persist_map, 2 * LWM2M_PERSIST_REGION_SIZE);
+        persist_map = NULL;
+    }
+    if (persist_fd >= 0){
+        close(persist_fd);
+        persist_fd = -1;
+    }
+}
+
+void LWM2M_host_persist_fail_after(uint32_t bytes)
+{
+    persist_budget = bytes;
+}
+
+/*
+platform hooks for the attribute engine and the sensor sources
+*/
+void LWM2M_wakeup(void)
+{
+    pthread_mutex_lock(&wakeup_lock);
+    wakeup_pending = true;
+    pthread_cond_signal(&wakeup_cond);
+    pthread_mutex_unlock(&wakeup_lock);
+}
+
+uint32_t LWM2M_clock_ms(void)
+{
+    if (clock_simulated){
+        return simulated_ms;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+const uint8_t *LWM2M_persist_region(int region)
+{
+    return (persist_map && (region == 0 || region == 1)) ? persist_map + region * LWM2M_PERSIST_REGION_SIZE : NULL;
+}
+
+bool LWM2M_persist_program(int region, uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    uint8_t *base = (uint8_t *)LWM2M_persist_region(region);
+    if (!base || offset + len > LWM2M_PERSIST_REGION_SIZE){
+        return false;
+    }
+    bool complete = true;
+    if (persist_budget != LWM2M_HOST_PERSIST_NO_LIMIT){
+        complete = len <= persist_budget;
+        len = complete ? len : persist_budget;
+        persist_budget -= len;
+    }
+    for (uint32_t i = 0; i < len; i++){
+        base[offset + i] &= data[i];
+    }
+    return complete;
+}
+
+bool LWM2M_persist_erase(int region)
+{
+    uint8_t *base = (uint8_t *)LWM2M_persist_region(region);
+    if (!base || persist_budget == 0){
+        return false;
+    }
+    memset(base, 0xFF, LWM2M_PERSIST_REGION_SIZE);
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+LWM2M host (Linux) platform backend
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Provides LWM2M_clock_ms() and LWM2M_wakeup() for building the attribute
+engine on a host. The clock is the monotonic system clock, or a simulated
+clock that only moves when LWM2M_host_clock_advance() is called, so timer
+expiry can be replayed deterministically and faster than real time.
+
+A simulated ADC stands in for the analog inputs, LWM2M_host_adc_read can be
+registered as an LWM2M_sensor_read with the channel number as context.
+
+The storage of LWM2M_persist is a file of two regions mapped into memory,
+programmed with the AND of the old and new bytes as NOR flash would be.
+*/
+
+#ifndef LWM2M_HOST_H
+#define LWM2M_HOST_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+#define LWM2M_HOST_ADC_CHANNELS 16
+
+// switch between the system clock (default) and the simulated clock
+void LWM2M_host_clock_simulated(bool simulated);
+void LWM2M_host_clock_set(uint32_t now_ms);
+
+// move the simulated clock forward in steps of at most step_ms,
+// running the pmin and pmax timers at every step
+void LWM2M_host_clock_advance(uint32_t ms, uint32_t step_ms);
+
+// block until LWM2M_wakeup() or timeout_ms, returns at once with the simulated clock
+void LWM2M_host_wait(uint32_t timeout_ms);
+
+// simulated ADC, read with context = (void*)(intptr_t)channel
+void LWM2M_host_adc_set(int channel, sample value);
+sample LWM2M_host_adc_read(void *context);
+
+// map path as the LWM2M_persist storage, created erased if it does not exist
+bool LWM2M_host_persist_open(const char *path);
+void LWM2M_host_persist_close(void);
+// program at most bytes more bytes, the write that reaches the limit is cut
+// short and later writes and erases fail, as after a reset.
+// LWM2M_HOST_PERSIST_NO_LIMIT lifts the limit.
+#define LWM2M_HOST_PERSIST_NO_LIMIT 0xFFFFFFFFUL
+void LWM2M_host_persist_fail_after(uint32_t bytes);
+
+#endif // LWM2M_HOST_H
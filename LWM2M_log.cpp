@@ -0,0 +1,145 @@
+/*
+LWM2M event log
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_log.h"
+#include "LWM2M_resource_attributes.h"
+#include <stdio.h>
+
+#define LOG_MASK (LWM2M_LOG_SIZE - 1)
+
+void LWM2M_log_init(LWM2M_log *log)
+{
+    for (uint32_t i = 0; i < LWM2M_LOG_SIZE; i++){
+        log->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    log->head = 0;
+    log->dropped.store(0, std::memory_order_relaxed);
+    log->tail.store(0, std::memory_order_release);
+}
+
+/*
+a slot is free for position pos while its sequence is pos: the producer
+that moves the tail past pos owns it, writes the record and sets the
+sequence to pos + 1, which publishes it to the consumer. A sequence behind
+pos is a slot the consumer has not taken yet, the ring is full.
+*/
+bool LWM2M_log_put(LWM2M_log *log, const LWM2M_log_record *record)
+{
+    uint32_t pos = log->tail.load(std::memory_order_relaxed);
+    LWM2M_log_slot *slot;
+    while (true){
+        slot = &log->slots[pos & LOG_MASK];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0){
+            if (log->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                break;
+            }
+            // pos reloaded, another producer claimed it
+        }
+        else if (diff < 0){
+            log->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else{
+            pos = log->tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = *record;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LWM2M_log_take(LWM2M_log *log, LWM2M_log_record *record)
+{
+    LWM2M_log_slot *slot = &log->slots[log->head & LOG_MASK];
+    if (slot->sequence.load(std::memory_order_acquire) != log->head + 1){
+        return false; // not published yet
+    }
+    *record = slot->record;
+    // free for the position one lap ahead
+    slot->sequence.store(log->head + LWM2M_LOG_SIZE, std::memory_order_release);
+    log->head++;
+    return true;
+}
+
+uint32_t LWM2M_log_dropped(LWM2M_log *log)
+{
+    return log->dropped.exchange(0, std::memory_order_relaxed);
+}
+
+int LWM2M_log_format(const LWM2M_log_record *record, char *line, int size)
+{
+    static const char *cause_names[LWM2M_CAUSES] = {"init", "step", "band", "pmin trigger", "pmax exceeded"};
+    static const char *pool_names[] = {"response", "option"};
+    const char *cause = (record->cause < LWM2M_CAUSES) ? cause_names[record->cause] : "?";
+    int len = snprintf(line, size, "%lu ", (unsigned long)record->time_ms);
+    if (len < 0 || len >= size){
+        return (len < 0) ? 0 : size - 1;
+    }
+    char *text = line + len;
+    int left = size - len;
+    int n;
+
+    switch (record->event){
+    case LWM2M_LOG_NOTIFY:
+        n = snprintf(text, left, "obs %d %s: sent %s%s, %ld bytes, content-format %u", record->obs, cause,
+            (record->flags & LWM2M_LOG_CON) ? "CON" : "NON", (record->flags & LWM2M_LOG_COMPOSITE) ? " composite" : "",
+            (long)record->arg, record->content_format);
+        break;
+    case LWM2M_LOG_NOTIFY_FAILED:
+        n = snprintf(text, left, "obs %d %s: notification failed", record->obs, cause);
+        break;
+    case LWM2M_LOG_ENCODE_FAILED:
+        n = (record->obs >= 0) ? snprintf(text, left, "obs %d: cant encode notification", record->obs)
+            : snprintf(text, left, "cant encode response");
+        break;
+    case LWM2M_LOG_NOT_ANSWERING:
+        n = snprintf(text, left, "obs %d: observer not answering, cancelled", record->obs);
+        break;
+    case LWM2M_LOG_RESET:
+        n = snprintf(text, left, "obs %d: notification reset, observation cancelled", record->obs);
+        break;
+    case LWM2M_LOG_POOL_EMPTY:
+        n = snprintf(text, left, "%s pool empty", pool_names[record->arg == LWM2M_LOG_POOL_OPTIONS]);
+        break;
+    case LWM2M_LOG_GET:
+        n = (record->flags & LWM2M_LOG_VALUE) ?
+            snprintf(text, left, "GET%s, state %3.1f", (record->flags & LWM2M_LOG_CACHED) ? " cached" : "", record->value)
+            : snprintf(text, left, "GET%s", (record->flags & LWM2M_LOG_CACHED) ? " cached" : "");
+        break;
+    case LWM2M_LOG_PUT:
+        n = (record->flags & LWM2M_LOG_VALUE) ?
+            snprintf(text, left, "PUT %3.1f, %ld bytes", record->value, (long)record->arg)
+            : snprintf(text, left, "PUT %ld bytes, not a number", (long)record->arg);
+        break;
+    case LWM2M_LOG_TABLE_FULL:
+        n = snprintf(text, left, "cant add observation");
+        break;
+    case LWM2M_LOG_ATTRIBUTES_ERROR:
+        n = snprintf(text, left, "write attributes error %ld", (long)record->arg);
+        break;
+    default:
+        n = snprintf(text, left, "event %u", record->event);
+        break;
+    }
+    if (n < 0){
+        return len;
+    }
+    return (n < left) ? len + n : size - 1;
+}
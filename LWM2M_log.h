@@ -0,0 +1,112 @@
+/*
+LWM2M event log
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Log of what the client did, e.g. a notification sent and what triggered
+it, kept as fixed size binary records in a ring and written out as text
+later by a thread of low priority. Printing a line over a UART takes
+milliseconds, which the notification thread and the CoAP callback no
+longer wait for: putting a record is a copy of 20 bytes.
+
+The ring is lock-free for any number of producers, threads or interrupt
+handlers, and one consumer (a bounded queue with a sequence number per
+slot, after D. Vyukov): a producer claims a slot by compare and swap on
+the tail and publishes it through the slot's sequence number, the consumer
+takes slots in order as they are published. A producer never waits; when
+the ring is full the record is dropped and counted.
+*/
+
+#ifndef LWM2M_LOG_H
+#define LWM2M_LOG_H
+
+#include <stdint.h>
+#include <atomic>
+
+// records in the ring, a power of 2
+#ifndef LWM2M_LOG_SIZE
+#define LWM2M_LOG_SIZE 32
+#endif
+#if LWM2M_LOG_SIZE & (LWM2M_LOG_SIZE - 1)
+#error "LWM2M_LOG_SIZE is to be a power of 2"
+#endif
+
+// longest line written by LWM2M_log_format
+#define LWM2M_LOG_LINE_SIZE 80
+
+// events
+#define LWM2M_LOG_NOTIFY          1 // a notification sent, arg is its payload length
+#define LWM2M_LOG_NOTIFY_FAILED   2 // the nsdl library did not accept a notification
+#define LWM2M_LOG_ENCODE_FAILED   3 // a notification or response did not encode
+#define LWM2M_LOG_NOT_ANSWERING   4 // confirmable notifications not acknowledged, observation cancelled
+#define LWM2M_LOG_RESET           5 // RST to a notification, observation cancelled
+#define LWM2M_LOG_POOL_EMPTY      6 // no response from the pool, arg is the pool LWM2M_LOG_POOL_*
+#define LWM2M_LOG_GET             7 // a GET answered, value is that of a single resource
+#define LWM2M_LOG_PUT             8 // a value written, arg is its length
+#define LWM2M_LOG_TABLE_FULL      9 // observation not started, no free row
+#define LWM2M_LOG_ATTRIBUTES_ERROR 10 // Write Attributes refused, arg is the LWM2M_ATTR_* result
+
+// flags
+#define LWM2M_LOG_CON        0x01 // confirmable notification
+#define LWM2M_LOG_COMPOSITE  0x02 // notification of several observations
+#define LWM2M_LOG_CACHED     0x04 // response from the response cache
+#define LWM2M_LOG_VALUE      0x08 // value is set
+
+#define LWM2M_LOG_POOL_RESPONSE 0
+#define LWM2M_LOG_POOL_OPTIONS  1
+
+struct LWM2M_log_record {
+    uint32_t time_ms; // LWM2M_clock_ms()
+    uint8_t event; // LWM2M_LOG_*
+    uint8_t cause; // of a notification, LWM2M_CAUSE_*
+    uint8_t flags;
+    int16_t obs; // -1 if none
+    uint16_t content_format;
+    int32_t arg; // by event
+    float value;
+};
+
+struct LWM2M_log_slot {
+    std::atomic<uint32_t> sequence; // position the slot is free for, or published at + 1
+    LWM2M_log_record record;
+};
+
+struct LWM2M_log {
+    std::atomic<uint32_t> tail; // next position to claim, by the producers
+    std::atomic<uint32_t> dropped; // records put while the ring was full
+    uint32_t head; // next position to take, by the consumer
+    LWM2M_log_slot slots[LWM2M_LOG_SIZE];
+};
+
+void LWM2M_log_init(LWM2M_log *log);
+
+// producer: false and counted in dropped if the ring is full
+bool LWM2M_log_put(LWM2M_log *log, const LWM2M_log_record *record);
+
+// consumer: the oldest published record, false if there is none
+bool LWM2M_log_take(LWM2M_log *log, LWM2M_log_record *record);
+
+// records dropped since the last call
+uint32_t LWM2M_log_dropped(LWM2M_log *log);
+
+/*
+one line of text for a record, without line end, e.g.
+"12345 obs 0 band: sent CON, 41 bytes, content-format 110".
+Returns its length, cut at size - 1.
+*/
+int LWM2M_log_format(const LWM2M_log_record *record, char *line, int size);
+
+#endif // LWM2M_LOG_H
@@ -0,0 +1,92 @@
+/*
+LWM2M notification queue
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+head and tail are free running counters, the slot is the counter modulo the 
+size. Each side only writes its own counter: the producer stores tail with
+release after writing the entries, the consumer stores head with release 
+after reading them, and each loads the other's counter with acquire.
+*/
+
+#include "LWM2M_notify_queue.h"
+
+#define QUEUE_MASK (LWM2M_NOTIFY_QUEUE_SIZE - 1)
+
+#if (LWM2M_NOTIFY_QUEUE_SIZE & QUEUE_MASK) != 0
+#error "LWM2M_NOTIFY_QUEUE_SIZE must be a power of 2"
+#endif
+
+void LWM2M_notify_queue_init(LWM2M_notify_queue *queue)
+{
+    queue->head.store(0, std::memory_order_relaxed);
+    queue->tail.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LWM2M_notify_group(LWM2M_notify_entry *group, int obs, sample s, uint8_t cause, 
+    const LWM2M_quiet_queue *events)
+{
+    uint32_t count = 0;
+    uint32_t now = LWM2M_clock_ms();
+    if (events){
+        for (uint8_t i = 0; i < events->count; i++){
+            const LWM2M_quiet_event *event = LWM2M_quiet_event_at(events, i);
+            LWM2M_notify_entry entry = {obs, event->value, event->time_ms, cause, LWM2M_NOTIFY_EVENT, 0};
+            group[count++] = entry;
+        }
+    }
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    for (int bit = 0; o && o->statistics >> bit; bit++){
+        sample value;
+        if (LWM2M_obs_statistic(obs, (uint8_t)(1 << bit), &value)){
+            LWM2M_notify_entry entry = {obs, value, now, cause, LWM2M_NOTIFY_STATISTIC, (uint8_t)(1 << bit)};
+            group[count++] = entry;
+        }
+    }
+    LWM2M_notify_entry entry = {obs, s, now, cause, LWM2M_NOTIFY_LAST, 0};
+    group[count++] = entry;
+    return count;
+}
+
+bool LWM2M_notify_queue_push(LWM2M_notify_queue *queue, const LWM2M_notify_entry *entries, uint32_t count)
+{
+    uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    uint32_t head = queue->head.load(std::memory_order_acquire);
+
+    if (LWM2M_NOTIFY_QUEUE_SIZE - (tail - head) < count){
+        return false; // full
+    }
+    for (uint32_t i = 0; i < count; i++){
+        queue->entries[(tail + i) & QUEUE_MASK] = entries[i];
+    }
+    queue->tail.store(tail + count, std::memory_order_release);
+    return true;
+}
+
+uint32_t LWM2M_notify_queue_count(LWM2M_notify_queue *queue)
+{
+    return queue->tail.load(std::memory_order_acquire) - queue->head.load(std::memory_order_relaxed);
+}
+
+const LWM2M_notify_entry *LWM2M_notify_queue_peek(LWM2M_notify_queue *queue, uint32_t i)
+{
+    return &queue->entries[(queue->head.load(std::memory_order_relaxed) + i) & QUEUE_MASK];
+}
+
+void LWM2M_notify_queue_pop(LWM2M_notify_queue *queue, uint32_t count)
+{
+    queue->head.store(queue->head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
@@ -0,0 +1,87 @@
+/*
+LWM2M notification queue
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Lock-free single producer, single consumer queue carrying triggered
+notifications from the attribute engine (producer, may be an ISR) to the
+thread that encodes and sends them (consumer).
+
+A notification is a group of entries published together: the events queued
+during the pmin quiet period, the statistics of the reporting window asked
+for by the attributes, then the reported value with LWM2M_NOTIFY_LAST set.
+The consumer sees either the whole group or none of it. Entries are never
+overwritten, a full queue refuses the push.
+*/
+
+#ifndef LWM2M_NOTIFY_QUEUE_H
+#define LWM2M_NOTIFY_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include "LWM2M_resource_attributes.h"
+
+// number of entries, a power of 2 holding at least one full group
+#ifndef LWM2M_NOTIFY_QUEUE_SIZE
+#define LWM2M_NOTIFY_QUEUE_SIZE 32
+#endif
+
+// entry flags
+#define LWM2M_NOTIFY_LAST   0x01 // reported value, ends the group
+#define LWM2M_NOTIFY_EVENT  0x02 // quiet period event sent along with the value
+#define LWM2M_NOTIFY_STATISTIC 0x04 // statistic of the reporting window, see LWM2M_obs_statistic
+
+// entries in the largest group
+#define LWM2M_NOTIFY_GROUP_SIZE (LWM2M_QUIET_QUEUE_DEPTH + LWM2M_STATISTICS + 1)
+
+struct LWM2M_notify_entry {
+    int32_t obs;
+    sample value;
+    uint32_t time_ms;
+    uint8_t cause; // LWM2M_CAUSE_*
+    uint8_t flags;
+    uint8_t statistic; // LWM2M_STAT_* of a LWM2M_NOTIFY_STATISTIC entry
+};
+
+struct LWM2M_notify_queue {
+    std::atomic<uint32_t> head; // next entry to read, written by the consumer
+    std::atomic<uint32_t> tail; // next entry to write, written by the producer
+    LWM2M_notify_entry entries[LWM2M_NOTIFY_QUEUE_SIZE];
+};
+
+void LWM2M_notify_queue_init(LWM2M_notify_queue *queue);
+
+/*
+producer: fill group with the entries of a notification from the arguments
+of send_notification, returns their number, at most LWM2M_NOTIFY_GROUP_SIZE
+*/
+uint32_t LWM2M_notify_group(LWM2M_notify_entry *group, int obs, sample s, uint8_t cause, 
+    const LWM2M_quiet_queue *events);
+
+/*
+producer: copy count entries and publish them at once, false if they don't fit
+*/
+bool LWM2M_notify_queue_push(LWM2M_notify_queue *queue, const LWM2M_notify_entry *entries, uint32_t count);
+
+/*
+consumer: number of published entries, the i-th of them, and release of the
+first count entries after they are sent
+*/
+uint32_t LWM2M_notify_queue_count(LWM2M_notify_queue *queue);
+const LWM2M_notify_entry *LWM2M_notify_queue_peek(LWM2M_notify_queue *queue, uint32_t i);
+void LWM2M_notify_queue_pop(LWM2M_notify_queue *queue, uint32_t count);
+
+#endif // LWM2M_NOTIFY_QUEUE_H
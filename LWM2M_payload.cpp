@@ -0,0 +1,475 @@
+/*
+LWM2M payload encoders
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_payload.h"
+#include <string.h>
+
+// fraction digits for senml+json values and times, trailing zeros are trimmed
+#define JSON_VALUE_DECIMALS 4
+#define JSON_TIME_DECIMALS 3
+
+// largest magnitude written in decimal, beyond this the value is rejected
+#define MAX_DECIMAL 1e15
+
+// SenML CBOR labels, RFC 8428
+#define SENML_BN -2
+#define SENML_N 0
+#define SENML_V 2
+#define SENML_T 6
+
+// longest record name, "65535/65535/65535"
+#define RECORD_NAME_SIZE 18
+
+/*
+output window of size bytes from offset start of the representation, pos
+counts every byte written. Bytes before the window are dropped, bytes past
+its end only set the overflow flag.
+*/
+struct writer {
+    uint8_t *buf;
+    int size;
+    uint32_t start;
+    uint32_t pos;
+    bool overflow;
+};
+
+static void put_byte(writer *w, uint8_t b)
+{
+    if (w->pos >= w->start){
+        if (w->pos - w->start < (uint32_t)w->size){
+            w->buf[w->pos - w->start] = b;
+        }
+        else{
+            w->overflow = true;
+        }
+    }
+    w->pos++;
+}
+
+static void put_bytes(writer *w, const void *data, int len)
+{
+    uint32_t end = w->start + w->size;
+    uint32_t from = (w->pos > w->start) ? w->pos : w->start;
+    uint32_t to = (w->pos + len < end) ? w->pos + len : end;
+    if (from < to){
+        memcpy(w->buf + (from - w->start), (const uint8_t *)data + (from - w->pos), to - from);
+    }
+    if (w->pos + len > end){
+        w->overflow = true;
+    }
+    w->pos += len;
+}
+
+static void put_str(writer *w, const char *s)
+{
+    put_bytes(w, s, strlen(s));
+}
+
+/*
+decimal digits of an unsigned value, returns the number of characters
+*/
+static int format_uint(char *out, uint64_t v)
+{
+    char digits[20];
+    int n = 0;
+    do{
+        digits[n++] = '0' + (v % 10);
+        v /= 10;
+    } while (v);
+    for (int i = 0; i < n; i++){
+        out[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+/*
+fixed point decimal, rounded half away from zero, optionally trimming 
+trailing fraction zeros (and the point). false if not representable.
+*/
+static bool put_decimal(writer *w, float value, int decimals, bool trim)
+{
+    static const uint32_t scale[] = {1, 10, 100, 1000, 10000, 100000};
+    char text[48];
+    int n = 0;
+
+    if (!(value > -MAX_DECIMAL && value < MAX_DECIMAL)){
+        return false; // also rejects NaN
+    }
+    bool negative = value < 0;
+    double magnitude = negative ? -(double)value : (double)value;
+    uint64_t scaled = (uint64_t)(magnitude * scale[decimals] + 0.5);
+    uint64_t integer = scaled / scale[decimals];
+    uint32_t fraction = (uint32_t)(scaled % scale[decimals]);
+
+    if (negative && scaled){
+        text[n++] = '-';
+    }
+    n += format_uint(text + n, integer);
+    if (decimals && !(trim && fraction == 0)){
+        text[n++] = '.';
+        for (int d = decimals - 1; d >= 0; d--){
+            text[n + d] = '0' + (fraction % 10);
+            fraction /= 10;
+        }
+        n += decimals;
+        while (trim && text[n - 1] == '0'){
+            n--;
+        }
+    }
+    put_bytes(w, text, n);
+    return true;
+}
+
+/*
+SenML name of a record, "resource", "instance/resource" or 
+"object/instance/resource", returns the length
+*/
+static int format_record_name(char *out, const LWM2M_record *record)
+{
+    int n = 0;
+    if (record->object != LWM2M_RECORD_NO_OBJECT){
+        n = format_uint(out, record->object);
+        out[n++] = '/';
+    }
+    if (record->instance != LWM2M_RECORD_NO_INSTANCE){
+        n += format_uint(out + n, record->instance);
+        out[n++] = '/';
+    }
+    return n + format_uint(out + n, record->resource);
+}
+
+static void put_record_name(writer *w, const LWM2M_record *record)
+{
+    char text[RECORD_NAME_SIZE];
+    put_bytes(w, text, format_record_name(text, record));
+}
+
+/*
+The encoders below write the part of the representation that belongs to
+record i, so that a block can be encoded starting at the record it falls in.
+*/
+
+/*
+text/plain, the most recent value
+*/
+static bool encode_text(writer *w, const LWM2M_record *records, int num_records, int i)
+{
+    return i < num_records - 1 || put_decimal(w, records[i].value, 1, false);
+}
+
+/*
+senml+json
+*/
+static bool encode_senml_json(writer *w, const char *base_name, const LWM2M_record *records, int num_records, int i)
+{
+    if (i == 0){
+        put_byte(w, '[');
+    }
+    put_str(w, i ? ",{" : "{");
+    if (i == 0 && base_name){
+        put_str(w, "\"bn\":\"");
+        put_str(w, base_name);
+        put_str(w, "\",");
+    }
+    put_str(w, "\"n\":\"");
+    put_record_name(w, &records[i]);
+    put_str(w, "\",\"v\":");
+    if (!put_decimal(w, records[i].value, JSON_VALUE_DECIMALS, true)){
+        return false;
+    }
+    if (records[i].time != 0){
+        put_str(w, ",\"t\":");
+        if (!put_decimal(w, records[i].time, JSON_TIME_DECIMALS, true)){
+            return false;
+        }
+    }
+    put_byte(w, '}');
+    if (i == num_records - 1){
+        put_byte(w, ']');
+    }
+    return true;
+}
+
+/*
+CBOR major type and argument, shortest form
+*/
+static void put_cbor_head(writer *w, uint8_t major, uint32_t arg)
+{
+    major <<= 5;
+    if (arg < 24){
+        put_byte(w, major | arg);
+    }
+    else if (arg <= 0xFF){
+        put_byte(w, major | 24);
+        put_byte(w, arg);
+    }
+    else if (arg <= 0xFFFF){
+        put_byte(w, major | 25);
+        put_byte(w, arg >> 8);
+        put_byte(w, arg);
+    }
+    else{
+        put_byte(w, major | 26);
+        put_byte(w, arg >> 24);
+        put_byte(w, arg >> 16);
+        put_byte(w, arg >> 8);
+        put_byte(w, arg);
+    }
+}
+
+static void put_cbor_int(writer *w, int32_t v)
+{
+    if (v >= 0){
+        put_cbor_head(w, 0, v);
+    }
+    else{
+        put_cbor_head(w, 1, (uint32_t)(-1 - v));
+    }
+}
+
+/*
+integral values are sent as CBOR integers, others as single precision
+*/
+static void put_cbor_number(writer *w, float v)
+{
+    if (v >= -2147483648.0f && v < 2147483648.0f && v == (float)(int32_t)v){
+        put_cbor_int(w, (int32_t)v);
+        return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put_byte(w, 0xFA);
+    put_byte(w, bits >> 24);
+    put_byte(w, bits >> 16);
+    put_byte(w, bits >> 8);
+    put_byte(w, bits);
+}
+
+/*
+senml+cbor
+*/
+static bool encode_senml_cbor(writer *w, const char *base_name, const LWM2M_record *records, int num_records, int i)
+{
+    char name[RECORD_NAME_SIZE];
+    if (i == 0){
+        put_cbor_head(w, 4, num_records);
+    }
+    bool has_base = (i == 0 && base_name);
+    bool has_time = records[i].time != 0;
+    put_cbor_head(w, 5, 2 + has_base + has_time);
+    if (has_base){
+        put_cbor_int(w, SENML_BN);
+        put_cbor_head(w, 3, strlen(base_name));
+        put_str(w, base_name);
+    }
+    put_cbor_int(w, SENML_N);
+    int name_len = format_record_name(name, &records[i]);
+    put_cbor_head(w, 3, name_len);
+    put_bytes(w, name, name_len);
+    put_cbor_int(w, SENML_V);
+    put_cbor_number(w, records[i].value);
+    if (has_time){
+        put_cbor_int(w, SENML_T);
+        put_cbor_number(w, records[i].time);
+    }
+    return true;
+}
+
+/*
+true if a later record has the same instance and resource
+*/
+static bool tlv_superseded(const LWM2M_record *records, int num_records, int i)
+{
+    for (int later = i + 1; later < num_records; later++){
+        if (records[later].resource == records[i].resource && records[later].instance == records[i].instance){
+            return true;
+        }
+    }
+    return false;
+}
+
+// size of a Resource with Value TLV holding a float
+static int tlv_resource_size(uint16_t id)
+{
+    return (id > 0xFF ? 3 : 2) + 4;
+}
+
+static void put_tlv_resource(writer *w, uint16_t id, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    // 11 = resource with value, bit 5 = 16 bit identifier, length 4 in type
+    put_byte(w, 0xC0 | (id > 0xFF ? 0x20 : 0x00) | 4);
+    if (id > 0xFF){
+        put_byte(w, id >> 8);
+    }
+    put_byte(w, id);
+    put_byte(w, bits >> 24);
+    put_byte(w, bits >> 16);
+    put_byte(w, bits >> 8);
+    put_byte(w, bits);
+}
+
+/*
+LWM2M TLV, one Resource with Value per resource ID, the latest record wins.
+Records with an instance are grouped into one Object Instance TLV per instance, 
+in order of first appearance, written with the first record of the instance.
+*/
+static bool encode_tlv(writer *w, const LWM2M_record *records, int num_records, int i)
+{
+    if (i == 0){
+        for (int r = 0; r < num_records; r++){
+            if (records[r].object != LWM2M_RECORD_NO_OBJECT){
+                return false; // a TLV payload is below one object
+            }
+        }
+    }
+    uint16_t instance = records[i].instance;
+    if (instance == LWM2M_RECORD_NO_INSTANCE){
+        if (!tlv_superseded(records, num_records, i)){
+            put_tlv_resource(w, records[i].resource, records[i].value);
+        }
+        return true;
+    }
+    for (int earlier = 0; earlier < i; earlier++){
+        if (records[earlier].instance == instance){
+            return true; // written with the first record of the instance
+        }
+    }
+    uint32_t length = 0;
+    for (int r = i; r < num_records; r++){
+        if (records[r].instance == instance && !tlv_superseded(records, num_records, r)){
+            length += tlv_resource_size(records[r].resource);
+        }
+    }
+    // 00 = object instance, bit 5 = 16 bit identifier, bits 4-3 = length field size
+    uint8_t length_size = (length < 8) ? 0 : (length <= 0xFF) ? 1 : (length <= 0xFFFF) ? 2 : 3;
+    put_byte(w, (instance > 0xFF ? 0x20 : 0x00) | (length_size << 3) | (length_size ? 0 : length));
+    if (instance > 0xFF){
+        put_byte(w, instance >> 8);
+    }
+    put_byte(w, instance);
+    for (int b = length_size - 1; b >= 0; b--){
+        put_byte(w, length >> (8 * b));
+    }
+    for (int r = i; r < num_records; r++){
+        if (records[r].instance == instance && !tlv_superseded(records, num_records, r)){
+            put_tlv_resource(w, records[r].resource, records[r].value);
+        }
+    }
+    return true;
+}
+
+static bool encode_record(writer *w, const LWM2M_encoder *encoder, int i)
+{
+    switch (encoder->content_format){
+    case LWM2M_CT_TEXT_PLAIN:
+        return encode_text(w, encoder->records, encoder->num_records, i);
+    case LWM2M_CT_SENML_JSON:
+        return encode_senml_json(w, encoder->base_name, encoder->records, encoder->num_records, i);
+    case LWM2M_CT_SENML_CBOR:
+        return encode_senml_cbor(w, encoder->base_name, encoder->records, encoder->num_records, i);
+    case LWM2M_CT_TLV:
+        return encode_tlv(w, encoder->records, encoder->num_records, i);
+    default:
+        return false;
+    }
+}
+
+void LWM2M_encoder_init(LWM2M_encoder *encoder, uint16_t content_format, const char *base_name,
+    const LWM2M_record *records, int num_records)
+{
+    encoder->content_format = content_format;
+    encoder->base_name = base_name;
+    encoder->records = records;
+    encoder->num_records = num_records;
+    encoder->record = 0;
+    encoder->record_offset = 0;
+}
+
+int LWM2M_encode_block(LWM2M_encoder *encoder, uint32_t offset, uint8_t *buf, int size, bool *more)
+{
+    if (encoder->num_records <= 0){
+        return -1;
+    }
+    if (offset < encoder->record_offset){
+        encoder->record = 0; // an earlier block again
+        encoder->record_offset = 0;
+    }
+    writer w = {buf, size, offset, encoder->record_offset, false};
+    for (int i = encoder->record; i < encoder->num_records && !w.overflow; i++){
+        // the next block starts in the last record begun
+        encoder->record = i;
+        encoder->record_offset = w.pos;
+        if (!encode_record(&w, encoder, i)){
+            return -1;
+        }
+    }
+    *more = w.overflow;
+    if (w.pos <= offset){
+        return 0; // past the end
+    }
+    return w.overflow ? size : (int)(w.pos - offset);
+}
+
+int LWM2M_encode(uint16_t content_format, const char *base_name,
+    const LWM2M_record *records, int num_records, uint8_t *buf, int size)
+{
+    LWM2M_encoder encoder;
+    bool more;
+
+    LWM2M_encoder_init(&encoder, content_format, base_name, records, num_records);
+    int len = LWM2M_encode_block(&encoder, 0, buf, size, &more);
+    return more ? -1 : len;
+}
+
+uint16_t LWM2M_negotiate_content_format(const uint8_t *accept_ptr, uint8_t accept_len,
+    uint16_t default_format)
+{
+    if (!accept_ptr){
+        return default_format;
+    }
+    if (accept_len > 2){
+        return LWM2M_CT_NONE;
+    }
+    uint16_t accept = 0;
+    for (uint8_t i = 0; i < accept_len; i++){
+        accept = (accept << 8) | accept_ptr[i];
+    }
+    switch (accept){
+    case LWM2M_CT_TEXT_PLAIN:
+    case LWM2M_CT_SENML_JSON:
+    case LWM2M_CT_SENML_CBOR:
+    case LWM2M_CT_TLV:
+        return accept;
+    default:
+        return LWM2M_CT_NONE;
+    }
+}
+
+uint8_t LWM2M_content_format_option(uint16_t content_format, uint8_t *buf)
+{
+    if (content_format > 0xFF){
+        buf[0] = content_format >> 8;
+        buf[1] = content_format;
+        return 2;
+    }
+    buf[0] = content_format;
+    return 1;
+}
@@ -0,0 +1,110 @@
+/*
+LWM2M payload encoders
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Encoders for resource values and multi-value notifications, writing into
+caller supplied buffers with no allocation and no printf.
+
+text/plain    single value, the last record, formatted as %3.1f was
+TLV           one Resource TLV per record, 4 byte float, times are not
+              representable and are dropped
+senml+json    one record per value, base name in the first record
+senml+cbor    as senml+json with the RFC 8428 integer labels
+
+A representation larger than a datagram is sent in blocks (RFC 7959
+Block2). LWM2M_encode_block writes the bytes of one block into a block
+sized buffer, encoding only from the record the block starts in: the
+encoder keeps where that record begins, so taking the blocks in order
+encodes each record about once, and an earlier block again starts over
+from the first record. TLV resumes at the Object Instance TLV the block
+starts in.
+
+Records of several object instances (a GET on an object) are named
+"instance/resource" in SenML and wrapped in Object Instance TLVs. Records
+of several objects (a composite notification) are named
+"object/instance/resource" and can't be encoded as TLV.
+*/
+
+#ifndef LWM2M_PAYLOAD_H
+#define LWM2M_PAYLOAD_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// CoAP content-formats
+#define LWM2M_CT_TEXT_PLAIN   0
+#define LWM2M_CT_SENML_JSON   110
+#define LWM2M_CT_SENML_CBOR   112
+#define LWM2M_CT_TLV          11542
+#define LWM2M_CT_NONE         0xFFFF // no acceptable format
+
+// record not below an object instance, or not named with its object
+#define LWM2M_RECORD_NO_INSTANCE 0xFFFF
+#define LWM2M_RECORD_NO_OBJECT   0xFFFF
+
+// one value of a resource
+struct LWM2M_record {
+    uint16_t object; // object ID, or LWM2M_RECORD_NO_OBJECT below the base name
+    uint16_t instance; // object instance ID, or LWM2M_RECORD_NO_INSTANCE
+    uint16_t resource; // resource ID, SenML name and TLV identifier
+    sample value;
+    float time; // seconds relative to the time of sending, 0 = now
+};
+
+/*
+encode records into buf using content_format
+returns the payload length, or -1 if the format is not supported, a value
+cannot be represented or buf is too small
+*/
+int LWM2M_encode(uint16_t content_format, const char *base_name,
+    const LWM2M_record *records, int num_records, uint8_t *buf, int size);
+
+/*
+a representation encoded a block at a time, the base name and records are
+not copied and must stay unchanged while blocks are taken from it
+*/
+struct LWM2M_encoder {
+    uint16_t content_format;
+    const char *base_name;
+    const LWM2M_record *records;
+    int num_records;
+    int record; // where the next block resumes, the record the last block ended in
+    uint32_t record_offset; // offset of its first byte
+};
+
+void LWM2M_encoder_init(LWM2M_encoder *encoder, uint16_t content_format, const char *base_name,
+    const LWM2M_record *records, int num_records);
+
+/*
+encode the size bytes from offset of the representation into buf, sets more
+if bytes follow. Returns the length, size unless it is the last block, 0 if
+offset is past the end, or -1 as LWM2M_encode.
+*/
+int LWM2M_encode_block(LWM2M_encoder *encoder, uint32_t offset, uint8_t *buf, int size, bool *more);
+
+/*
+pick the content-format for a response from the raw Accept option bytes,
+accept_ptr NULL means no Accept option. Returns default_format when there
+is no Accept option and LWM2M_CT_NONE when the accepted format is unsupported.
+*/
+uint16_t LWM2M_negotiate_content_format(const uint8_t *accept_ptr, uint8_t accept_len,
+    uint16_t default_format);
+
+// write a content-format as a CoAP uint option value, returns the length
+uint8_t LWM2M_content_format_option(uint16_t content_format, uint8_t *buf);
+
+#endif // LWM2M_PAYLOAD_H
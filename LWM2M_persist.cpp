@@ -0,0 +1,498 @@
+/*
+LWM2M persistent observation state
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_persist.h"
+#include <string.h>
+
+#define PERSIST_MAGIC 0x504D574CUL // "LWMP"
+
+// record types, 0xFF is erased flash, the end of the log
+enum {
+    REC_HEADER = 1, // magic, version, generation
+    REC_COMMIT, // the snapshot before it is complete
+    REC_ATTRIBUTES, // resource, attributes
+    REC_OBSERVE, // observation key, tag, reserved sequence number
+    REC_CANCEL, // observation key, or resource and CANCEL_ALL
+    REC_SEQUENCE // observation key, reserved sequence number
+};
+
+// token length of a cancel of every observation of a resource
+#define CANCEL_ALL 0xFF
+
+// type and length before the payload, CRC after it
+#define RECORD_OVERHEAD 4
+#define HEADER_PAYLOAD 9
+#define ATTRIBUTES_PAYLOAD(num_limits) (2 + 9 * 4 + 2 + 8 * (num_limits))
+#define KEY_PAYLOAD(token_len) (3 + (token_len))
+#define OBSERVE_PAYLOAD(token_len) (KEY_PAYLOAD(token_len) + 3)
+#define RECORD_MAX_PAYLOAD ATTRIBUTES_PAYLOAD(MAX_LIMITS)
+
+#define ALIGN_UP(n) (((n) + LWM2M_PERSIST_ALIGN - 1) / LWM2M_PERSIST_ALIGN * LWM2M_PERSIST_ALIGN)
+#define RECORD_SIZE(payload) ALIGN_UP(RECORD_OVERHEAD + (payload))
+
+// largest snapshot, every resource with attributes and every observation
+#define SNAPSHOT_SIZE (RECORD_SIZE(HEADER_PAYLOAD) + RECORD_SIZE(0) \
+    + LWM2M_MAX_RESOURCES * RECORD_SIZE(RECORD_MAX_PAYLOAD) \
+    + LWM2M_MAX_OBSERVATIONS * RECORD_SIZE(OBSERVE_PAYLOAD(LWM2M_MAX_TOKEN_LEN)))
+#if SNAPSHOT_SIZE > LWM2M_PERSIST_REGION_SIZE
+#error "LWM2M_PERSIST_REGION_SIZE can't hold a snapshot of the full tables"
+#endif
+#if RECORD_MAX_PAYLOAD > 0xFE
+#error "MAX_LIMITS too large for a record"
+#endif
+
+struct record {
+    uint8_t data[RECORD_OVERHEAD + RECORD_MAX_PAYLOAD];
+    int len; // payload bytes
+};
+
+// active region, -1 = no storage, its generation and where the next record goes
+static int active = -1;
+static uint32_t generation;
+static uint32_t write_offset;
+
+// per observation, the caller's tag and the reserved sequence number
+static uint16_t obs_tags[LWM2M_MAX_OBSERVATIONS];
+static uint8_t obs_reserved[LWM2M_MAX_OBSERVATIONS];
+
+// resources whose attributes were written, the others have the defaults
+static uint8_t written[(LWM2M_MAX_RESOURCES + 7) / 8];
+
+static LWM2M_persist_stats stats;
+
+/*
+CRC-16/CCITT-FALSE
+*/
+static uint16_t crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint32_t i = 0; i < len; i++){
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++){
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void record_start(record *r, uint8_t type)
+{
+    r->data[0] = type;
+    r->len = 0;
+}
+
+static void put(record *r, const void *value, int len)
+{
+    memcpy(r->data + 2 + r->len, value, len);
+    r->len += len;
+}
+
+static void put_key(record *r, uint16_t resource, const uint8_t *token, uint8_t token_len)
+{
+    put(r, &resource, 2);
+    put(r, &token_len, 1);
+    put(r, token, token_len);
+}
+
+static void put_observation(record *r, uint8_t type, int obs)
+{
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    record_start(r, type);
+    put_key(r, o->resource, o->token, o->token_len);
+    if (type == REC_OBSERVE){
+        put(r, &obs_tags[obs], 2);
+    }
+    put(r, &obs_reserved[obs], 1);
+}
+
+static void put_attributes(record *r, uint16_t resource)
+{
+    const LWM2M_attributes *attr = LWM2M_resource_get_attributes(resource);
+    record_start(r, REC_ATTRIBUTES);
+    put(r, &resource, 2);
+    put(r, &attr->gt, 4);
+    put(r, &attr->lt, 4);
+    put(r, &attr->step, 4);
+    put(r, &attr->pmin, 4);
+    put(r, &attr->pmax, 4);
+    put(r, &attr->epmin, 4);
+    put(r, &attr->epmax, 4);
+    put(r, &attr->hysteresis, 4);
+    put(r, &attr->dwell, 4);
+    put(r, &attr->statistics, 1);
+    put(r, &attr->num_limits, 1);
+    put(r, attr->limits, 4 * attr->num_limits);
+    put(r, attr->limit_hysteresis, 4 * attr->num_limits);
+}
+
+/*
+program a record at offset of a region, false if it does not fit
+*/
+static bool write_record(int region, uint32_t *offset, record *r)
+{
+    uint32_t size = RECORD_OVERHEAD + r->len;
+    if (*offset + ALIGN_UP(size) > LWM2M_PERSIST_REGION_SIZE){
+        return false;
+    }
+    r->data[1] = (uint8_t)r->len;
+    uint16_t crc = crc16(r->data, 2 + r->len);
+    r->data[2 + r->len] = (uint8_t)crc;
+    r->data[3 + r->len] = (uint8_t)(crc >> 8);
+    if (!LWM2M_persist_program(region, *offset, r->data, size)){
+        return false;
+    }
+    *offset += ALIGN_UP(size);
+    return true;
+}
+
+/*
+the record at offset of a region, returns the offset of the next one, or 0
+at erased space or a record that fails its CRC
+*/
+static uint32_t read_record(const uint8_t *base, uint32_t offset, uint8_t *type,
+    const uint8_t **payload, uint8_t *len)
+{
+    if (offset + RECORD_OVERHEAD > LWM2M_PERSIST_REGION_SIZE || base[offset] == 0xFF){
+        return 0;
+    }
+    const uint8_t *p = base + offset;
+    uint32_t size = RECORD_OVERHEAD + p[1];
+    if (offset + size > LWM2M_PERSIST_REGION_SIZE
+        || crc16(p, 2 + p[1]) != (p[2 + p[1]] | (p[3 + p[1]] << 8))){
+        return 0;
+    }
+    *type = p[0];
+    *len = p[1];
+    *payload = p + 2;
+    return offset + ALIGN_UP(size);
+}
+
+/*
+generation and end of the log of a region with a complete snapshot, clean if
+only erased space follows the log. false if the header or commit is missing.
+*/
+static bool scan_region(int region, uint32_t *gen, uint32_t *end, bool *clean)
+{
+    const uint8_t *base = LWM2M_persist_region(region);
+    const uint8_t *payload;
+    uint8_t type, len;
+    uint32_t magic;
+
+    uint32_t offset = read_record(base, 0, &type, &payload, &len);
+    if (!offset || type != REC_HEADER || len != HEADER_PAYLOAD){
+        return false;
+    }
+    memcpy(&magic, payload, 4);
+    if (magic != PERSIST_MAGIC || payload[4] != LWM2M_PERSIST_VERSION){
+        return false;
+    }
+    memcpy(gen, payload + 5, 4);
+    bool committed = false;
+    for (uint32_t next; (next = read_record(base, offset, &type, &payload, &len)) != 0; offset = next){
+        committed |= (type == REC_COMMIT);
+    }
+    *end = offset;
+    *clean = true;
+    for (uint32_t i = offset; i < LWM2M_PERSIST_REGION_SIZE && *clean; i++){
+        *clean = base[i] == 0xFF;
+    }
+    return committed;
+}
+
+/*
+an observation key at the start of a payload of key_len + extra bytes,
+false if the lengths don't match
+*/
+static bool parse_key(const uint8_t *payload, uint8_t len, int extra, uint16_t *resource,
+    const uint8_t **token, uint8_t *token_len)
+{
+    if (len < KEY_PAYLOAD(0)){
+        return false;
+    }
+    memcpy(resource, payload, 2);
+    *token_len = payload[2];
+    *token = payload + 3;
+    if (*token_len == CANCEL_ALL){
+        return len == KEY_PAYLOAD(0) + extra;
+    }
+    return *token_len <= LWM2M_MAX_TOKEN_LEN && len == KEY_PAYLOAD(*token_len) + extra;
+}
+
+static void replay_attributes(const uint8_t *payload, uint8_t len)
+{
+    LWM2M_attributes attr;
+    uint16_t resource;
+
+    if (len < ATTRIBUTES_PAYLOAD(0) || payload[39] > MAX_LIMITS || len != ATTRIBUTES_PAYLOAD(payload[39])){
+        return;
+    }
+    memcpy(&resource, payload, 2);
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return;
+    }
+    memcpy(&attr.gt, payload + 2, 4);
+    memcpy(&attr.lt, payload + 6, 4);
+    memcpy(&attr.step, payload + 10, 4);
+    memcpy(&attr.pmin, payload + 14, 4);
+    memcpy(&attr.pmax, payload + 18, 4);
+    memcpy(&attr.epmin, payload + 22, 4);
+    memcpy(&attr.epmax, payload + 26, 4);
+    memcpy(&attr.hysteresis, payload + 30, 4);
+    memcpy(&attr.dwell, payload + 34, 4);
+    attr.statistics = payload[38];
+    attr.num_limits = payload[39];
+    memcpy(attr.limits, payload + 40, 4 * attr.num_limits);
+    memcpy(attr.limit_hysteresis, payload + 40 + 4 * attr.num_limits, 4 * attr.num_limits);
+    // no observation exists yet, nothing is re-initialized
+    LWM2M_resource_set_attributes(resource, &attr);
+    written[resource / 8] |= 1 << (resource % 8);
+}
+
+static void replay_observation(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint16_t resource;
+    const uint8_t *token;
+    uint8_t token_len;
+
+    if (!parse_key(payload, len, (type == REC_OBSERVE) ? 3 : (type == REC_SEQUENCE) ? 1 : 0,
+        &resource, &token, &token_len)){
+        return;
+    }
+    const uint8_t *extra = token + ((token_len == CANCEL_ALL) ? 0 : token_len);
+    if (type == REC_CANCEL && token_len == CANCEL_ALL){
+        LWM2M_resource_cancel(resource);
+        return;
+    }
+    int obs = (type == REC_OBSERVE) ? LWM2M_obs_create(resource, token, token_len)
+        : LWM2M_obs_find(resource, token, token_len);
+    if (obs < 0){
+        return;
+    }
+    switch (type){
+    case REC_OBSERVE:
+        memcpy(&obs_tags[obs], extra, 2);
+        obs_reserved[obs] = extra[2];
+        LWM2M_obs_get(obs)->obs_number = extra[2];
+        break;
+    case REC_SEQUENCE:
+        obs_reserved[obs] = extra[0];
+        LWM2M_obs_get(obs)->obs_number = extra[0];
+        break;
+    case REC_CANCEL:
+        LWM2M_obs_release(obs);
+        break;
+    }
+}
+
+/*
+replay the log of a region, the attributes or the observations
+*/
+static void replay(int region, bool observations)
+{
+    const uint8_t *base = LWM2M_persist_region(region);
+    const uint8_t *payload;
+    uint8_t type, len;
+
+    for (uint32_t offset = 0; (offset = read_record(base, offset, &type, &payload, &len)) != 0;){
+        if (!observations && type == REC_ATTRIBUTES){
+            replay_attributes(payload, len);
+        }
+        else if (observations && (type == REC_OBSERVE || type == REC_CANCEL || type == REC_SEQUENCE)){
+            replay_observation(type, payload, len);
+        }
+    }
+}
+
+int LWM2M_persist_restore(void)
+{
+    uint32_t gens[2], ends[2];
+    bool valid[2], clean[2];
+
+    active = -1;
+    memset(written, 0, sizeof(written));
+    memset(&stats, 0, sizeof(stats));
+    if (!LWM2M_persist_region(0) || !LWM2M_persist_region(1)){
+        return -1;
+    }
+    for (int r = 0; r < 2; r++){
+        valid[r] = scan_region(r, &gens[r], &ends[r], &clean[r]);
+    }
+    int region = -1;
+    if (valid[0] && (!valid[1] || (int32_t)(gens[0] - gens[1]) > 0)){
+        region = 0;
+    }
+    else if (valid[1]){
+        region = 1;
+    }
+    if (region < 0){
+        generation = 0;
+        LWM2M_persist_compact(); // start an empty log
+        return -1;
+    }
+
+    active = region;
+    generation = gens[region];
+    write_offset = ends[region];
+    replay(region, false);
+    replay(region, true);
+    if (!clean[region]){
+        LWM2M_persist_compact(); // a record was cut short, don't append after it
+    }
+    else if (valid[1 - region]){
+        LWM2M_persist_erase(1 - region); // reset before the old region was erased
+    }
+
+    int restored = 0;
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        restored += LWM2M_obs_get(obs) != NULL;
+    }
+    return restored;
+}
+
+/*
+append a change to the active region, compacting into the other one when full
+*/
+static bool append(record *r)
+{
+    if (active < 0){
+        return false;
+    }
+    if (!write_record(active, &write_offset, r)
+        && !(LWM2M_persist_compact() && write_record(active, &write_offset, r))){
+        stats.failures++;
+        return false;
+    }
+    stats.appends++;
+    return true;
+}
+
+bool LWM2M_persist_attributes(uint16_t resource)
+{
+    record r;
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return false;
+    }
+    written[resource / 8] |= 1 << (resource % 8);
+    put_attributes(&r, resource);
+    return append(&r);
+}
+
+bool LWM2M_persist_observe(int obs, uint16_t tag)
+{
+    record r;
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    if (!o){
+        return false;
+    }
+    obs_tags[obs] = tag;
+    obs_reserved[obs] = o->obs_number + LWM2M_PERSIST_SEQ_STRIDE;
+    put_observation(&r, REC_OBSERVE, obs);
+    return append(&r);
+}
+
+bool LWM2M_persist_cancel(int obs)
+{
+    record r;
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    if (!o){
+        return false;
+    }
+    record_start(&r, REC_CANCEL);
+    put_key(&r, o->resource, o->token, o->token_len);
+    return append(&r);
+}
+
+bool LWM2M_persist_cancel_resource(uint16_t resource)
+{
+    record r;
+    uint8_t all = CANCEL_ALL;
+    record_start(&r, REC_CANCEL);
+    put(&r, &resource, 2);
+    put(&r, &all, 1);
+    return append(&r);
+}
+
+bool LWM2M_persist_sequence(int obs)
+{
+    record r;
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    if (!o || active < 0){
+        return false;
+    }
+    if ((int8_t)(o->obs_number - obs_reserved[obs]) < 0){
+        return true; // within the reservation
+    }
+    obs_reserved[obs] = o->obs_number + LWM2M_PERSIST_SEQ_STRIDE;
+    put_observation(&r, REC_SEQUENCE, obs);
+    return append(&r);
+}
+
+uint16_t LWM2M_persist_tag(int obs)
+{
+    return (obs >= 0 && obs < LWM2M_MAX_OBSERVATIONS) ? obs_tags[obs] : 0;
+}
+
+bool LWM2M_persist_compact(void)
+{
+    int target = (active < 0) ? 0 : 1 - active;
+    uint32_t offset = 0;
+    uint32_t magic = PERSIST_MAGIC;
+    uint32_t next_generation = generation + 1;
+    uint8_t version = LWM2M_PERSIST_VERSION;
+    record r;
+
+    if (!LWM2M_persist_region(target) || !LWM2M_persist_erase(target)){
+        return false;
+    }
+    record_start(&r, REC_HEADER);
+    put(&r, &magic, 4);
+    put(&r, &version, 1);
+    put(&r, &next_generation, 4);
+    bool ok = write_record(target, &offset, &r);
+    for (uint16_t resource = 0; ok && resource < LWM2M_MAX_RESOURCES; resource++){
+        if (written[resource / 8] & (1 << (resource % 8))){
+            put_attributes(&r, resource);
+            ok = write_record(target, &offset, &r);
+        }
+    }
+    for (int obs = 0; ok && obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        if (LWM2M_obs_get(obs)){
+            put_observation(&r, REC_OBSERVE, obs);
+            ok = write_record(target, &offset, &r);
+        }
+    }
+    record_start(&r, REC_COMMIT);
+    if (!ok || !write_record(target, &offset, &r)){
+        return false; // without its commit the target is not restored
+    }
+    if (active >= 0){
+        LWM2M_persist_erase(active);
+    }
+    active = target;
+    generation = next_generation;
+    write_offset = offset;
+    stats.compactions++;
+    return true;
+}
+
+void LWM2M_persist_get_stats(LWM2M_persist_stats *out)
+{
+    *out = stats;
+    out->used = (active < 0) ? 0 : write_offset;
+}
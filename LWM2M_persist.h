@@ -0,0 +1,125 @@
+/*
+LWM2M persistent observation state
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Observations, their tokens and observe sequence numbers, and the attributes
+written to each resource, kept in flash so that a reset does not cost the
+server a new observe and Write-Attributes for every resource.
+
+Storage is two regions of LWM2M_PERSIST_REGION_SIZE bytes, erased to 0xFF
+and read through memory mapping (flash on the target, a mapped file on the
+host, see LWM2M_host.h). One region is active and holds a log:
+
+  header    magic, format version and generation
+  snapshot  the whole state when the region was started
+  commit    the snapshot is complete
+  changes   appended as they happen, until the region is full
+
+Each record is type, length, payload and a CRC-16 over all three, padded to
+LWM2M_PERSIST_ALIGN bytes. Records are only ever programmed into erased
+space. When the active region is full its state is compacted into a new
+snapshot in the other region, with the next generation, and then the old
+region is erased.
+
+Restore takes the valid region of the highest generation, a region without
+its commit record is ignored, and replays it up to the first record that
+is erased or fails its CRC, so a write cut short by a reset loses only that
+change. Attributes are applied before observations and nothing is sent, the
+caller starts the restored observations.
+
+The observe sequence number is not logged on every notification. A number
+LWM2M_PERSIST_SEQ_STRIDE ahead is reserved in the log before it is reached,
+and a restored observation continues from its last reservation, so the
+numbers a server sees keep increasing across a reset.
+
+Payloads are written in the byte order of the target, the log is not
+portable between targets of a different byte order.
+*/
+
+#ifndef LWM2M_PERSIST_H
+#define LWM2M_PERSIST_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// bytes per region, a flash sector on the target
+#ifndef LWM2M_PERSIST_REGION_SIZE
+#define LWM2M_PERSIST_REGION_SIZE 4096
+#endif
+// program granularity of the flash, records start at multiples of it
+#ifndef LWM2M_PERSIST_ALIGN
+#define LWM2M_PERSIST_ALIGN 4
+#endif
+// notifications per sequence number reservation, at most 127
+#ifndef LWM2M_PERSIST_SEQ_STRIDE
+#define LWM2M_PERSIST_SEQ_STRIDE 16
+#endif
+
+// changed when the record format changes, an older log is not restored
+#define LWM2M_PERSIST_VERSION 3
+
+struct LWM2M_persist_stats {
+    uint32_t appends; // change records written
+    uint32_t compactions;
+    uint32_t failures; // changes that could not be written
+    uint32_t used; // bytes in the active region
+};
+
+/*
+after LWM2M_obs_table_init, restore the logged state into the engine.
+Returns the number of observations restored, -1 if there is no valid log,
+the storage is then started empty, or there is no storage.
+*/
+int LWM2M_persist_restore(void);
+
+// the attributes of a resource were written
+bool LWM2M_persist_attributes(uint16_t resource);
+
+// an observation was created, tag is kept with it for the caller
+bool LWM2M_persist_observe(int obs, uint16_t tag);
+
+// an observation is about to be released
+bool LWM2M_persist_cancel(int obs);
+
+// every observation of a resource is about to be cancelled
+bool LWM2M_persist_cancel_resource(uint16_t resource);
+
+/*
+the observe number of obs was advanced for a notification, reserves the
+next numbers in the log when the number reaches the last reservation
+*/
+bool LWM2M_persist_sequence(int obs);
+
+// tag of a restored or logged observation
+uint16_t LWM2M_persist_tag(int obs);
+
+// write the state as a new snapshot into the other region
+bool LWM2M_persist_compact(void);
+
+void LWM2M_persist_get_stats(LWM2M_persist_stats *stats);
+
+/*
+Platform hooks
+*/
+// read access to region 0 or 1, NULL if there is no storage
+const uint8_t *LWM2M_persist_region(int region);
+// program len bytes at offset of an erased part of a region
+bool LWM2M_persist_program(int region, uint32_t offset, const uint8_t *data, uint32_t len);
+// erase a region to 0xFF
+bool LWM2M_persist_erase(int region);
+
+#endif // LWM2M_PERSIST_H
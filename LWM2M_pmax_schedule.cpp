@@ -0,0 +1,72 @@
+/*
+LWM2M pmax scheduling
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_pmax_schedule.h"
+
+uint32_t LWM2M_pmax_delay(const LWM2M_pmax_schedule *schedule, uint32_t now, uint32_t pmax_ms,
+    uint32_t *random_state)
+{
+    uint32_t advance = 0;
+
+    if (pmax_ms == 0){
+        return 0;
+    }
+    switch (schedule->mode){
+    case LWM2M_PMAX_JITTER:{
+        uint32_t budget = (schedule->jitter_ms < pmax_ms) ? schedule->jitter_ms : pmax_ms - 1;
+        if (budget){
+            // xorshift32
+            uint32_t x = *random_state;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            *random_state = x;
+            advance = x % (budget + 1);
+        }
+        break;
+    }
+    case LWM2M_PMAX_ALIGNED:{
+        uint32_t period = schedule->period_ms ? schedule->period_ms : pmax_ms;
+        if (period == 0 || period > pmax_ms){
+            break; // no grid point is sure to fall within pmax
+        }
+        // distance of the deadline past the last grid point
+        int32_t offset = (int32_t)(now + pmax_ms - schedule->epoch_ms - schedule->phase_ms);
+        int32_t past = offset % (int32_t)period;
+        advance = (past < 0) ? past + period : past;
+        break;
+    }
+    default:
+        break;
+    }
+    return pmax_ms - advance;
+}
+
+uint32_t LWM2M_pmax_device_phase(const uint8_t *device_id, int len, uint32_t period_ms)
+{
+    // FNV-1a, then a finalizer so that ids differing in the last byte spread
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++){
+        h = (h ^ device_id[i]) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return period_ms ? h % period_ms : 0;
+}
@@ -0,0 +1,67 @@
+/*
+LWM2M pmax scheduling
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Where the pmax deadline of an observation falls after a notification.
+pmax is a maximum, so every mode only ever moves the deadline earlier:
+
+LWM2M_PMAX_EXACT    pmax after the notification. Devices provisioned or
+                    configured together stay phase locked and a fleet
+                    reports in one burst every pmax.
+LWM2M_PMAX_JITTER   a random amount up to jitter_ms early, the phases of
+                    devices and of resources drift apart.
+LWM2M_PMAX_ALIGNED  the last point of a grid of period_ms (pmax if 0) at
+                    or before pmax, counted from epoch_ms + phase_ms. The
+                    resources of a device meet on the grid and go in one
+                    wakeup. With the same epoch and phase for a whole fleet
+                    that is one burst, with phase_ms from
+                    LWM2M_pmax_device_phase the devices are spread evenly
+                    and deterministically over the period.
+
+The grid is computed from a signed 32 bit distance to the epoch, so the
+epoch is to be within 24 days of the clock, e.g. refreshed on registration.
+*/
+
+#ifndef LWM2M_PMAX_SCHEDULE_H
+#define LWM2M_PMAX_SCHEDULE_H
+
+#include <stdint.h>
+
+#define LWM2M_PMAX_EXACT    0
+#define LWM2M_PMAX_JITTER   1
+#define LWM2M_PMAX_ALIGNED  2
+
+struct LWM2M_pmax_schedule {
+    uint8_t mode;
+    uint32_t jitter_ms; // JITTER, largest advance of a deadline
+    uint32_t period_ms; // ALIGNED, grid spacing, 0 = the pmax of each observation
+    uint32_t epoch_ms; // ALIGNED, clock time of a grid point shared by the fleet
+    uint32_t phase_ms; // ALIGNED, offset of this device from the epoch
+};
+
+/*
+time from now to the pmax deadline, at most pmax_ms and at least 1 ms
+for a pmax_ms of 1 ms or more.
+random_state is a non zero seed, advanced by JITTER.
+*/
+uint32_t LWM2M_pmax_delay(const LWM2M_pmax_schedule *schedule, uint32_t now, uint32_t pmax_ms,
+    uint32_t *random_state);
+
+// phase in [0, period_ms) from a device identity, e.g. a MAC address or endpoint name
+uint32_t LWM2M_pmax_device_phase(const uint8_t *device_id, int len, uint32_t period_ms);
+
+#endif // LWM2M_PMAX_SCHEDULE_H
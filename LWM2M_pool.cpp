@@ -0,0 +1,74 @@
+/*
+LWM2M fixed block pools
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_pool.h"
+#include <stddef.h>
+#include <string.h>
+
+// the link is copied, blocks of odd sizes are not aligned for int16_t
+static int16_t get_link(const LWM2M_pool *pool, int16_t block)
+{
+    int16_t link;
+    memcpy(&link, pool->blocks + (uint32_t)block * pool->block_size, sizeof(link));
+    return link;
+}
+
+static void set_link(LWM2M_pool *pool, int16_t block, int16_t link)
+{
+    memcpy(pool->blocks + (uint32_t)block * pool->block_size, &link, sizeof(link));
+}
+
+void LWM2M_pool_init(LWM2M_pool *pool, void *blocks, uint16_t block_size, uint16_t num_blocks)
+{
+    pool->blocks = (uint8_t *)blocks;
+    pool->block_size = block_size;
+    pool->num_blocks = num_blocks;
+    pool->in_use = 0;
+    pool->high_water = 0;
+    pool->failures = 0;
+    pool->free_block = num_blocks ? 0 : -1;
+    for (int16_t block = 0; block < (int16_t)num_blocks; block++){
+        set_link(pool, block, (block + 1 < (int16_t)num_blocks) ? block + 1 : -1);
+    }
+}
+
+void *LWM2M_pool_alloc(LWM2M_pool *pool)
+{
+    if (pool->free_block < 0){
+        pool->failures++;
+        return NULL;
+    }
+    int16_t block = pool->free_block;
+    pool->free_block = get_link(pool, block);
+    if (++pool->in_use > pool->high_water){
+        pool->high_water = pool->in_use;
+    }
+    return pool->blocks + (uint32_t)block * pool->block_size;
+}
+
+void LWM2M_pool_free(LWM2M_pool *pool, void *block)
+{
+    if (!block){
+        return;
+    }
+    int16_t index = (int16_t)(((uint8_t *)block - pool->blocks) / pool->block_size);
+    set_link(pool, index, pool->free_block);
+    pool->free_block = index;
+    pool->in_use--;
+}
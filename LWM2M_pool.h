@@ -0,0 +1,62 @@
+/*
+LWM2M fixed block pools
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Pools of equal sized blocks in static storage, for the CoAP messages built
+on every request so the request paths make no heap calls and the heap does
+not fragment over a long running device.
+
+Free blocks are linked through their first bytes, alloc and free are a
+constant time pop and push. A pool counts blocks in use, the most ever in
+use (high water mark) and allocations refused because it was empty, so the
+sizes can be set from a soak run.
+
+A pool is not locked, it is used from one thread or under the caller's lock.
+*/
+
+#ifndef LWM2M_POOL_H
+#define LWM2M_POOL_H
+
+#include <stdint.h>
+
+struct LWM2M_pool {
+    uint8_t *blocks;
+    uint16_t block_size, num_blocks;
+    int16_t free_block; // head of the free list, -1 if empty
+    uint16_t in_use;
+    uint16_t high_water; // most blocks ever in use
+    uint32_t failures; // allocations refused
+};
+
+/*
+storage for num_blocks blocks of type, as the blocks of LWM2M_pool_init
+*/
+#define LWM2M_POOL_STORAGE(name, type, num_blocks) \
+    static union { type block; int16_t link; } name[num_blocks]
+
+/*
+make all blocks free, block_size is at least 2 bytes and num_blocks at most 32767
+*/
+void LWM2M_pool_init(LWM2M_pool *pool, void *blocks, uint16_t block_size, uint16_t num_blocks);
+
+// a block, not cleared, or NULL if all are in use
+void *LWM2M_pool_alloc(LWM2M_pool *pool);
+
+// return a block, NULL is ignored
+void LWM2M_pool_free(LWM2M_pool *pool, void *block);
+
+#endif // LWM2M_POOL_H
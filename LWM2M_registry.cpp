@@ -0,0 +1,290 @@
+/*
+LWM2M object registry
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_registry.h"
+#include <stddef.h>
+
+// hash slots, a power of 2 at least twice the entries keeps probe runs short
+#define INDEX_SIZE (4 * LWM2M_REGISTRY_SIZE)
+#define INDEX_MASK (INDEX_SIZE - 1)
+
+#if (INDEX_SIZE & INDEX_MASK) != 0
+#error "LWM2M_REGISTRY_SIZE must be a power of 2"
+#endif
+
+static LWM2M_registry_entry entries[LWM2M_REGISTRY_SIZE];
+static int num_entries = 0;
+
+// entry per hash slot, -1 = empty
+static int16_t index_slots[INDEX_SIZE];
+
+// entry per attribute engine resource
+static int16_t engine_entries[LWM2M_MAX_RESOURCES];
+
+/*
+64 bit finalizer, spreads object and instance IDs that differ in few bits
+*/
+static uint32_t key_hash(LWM2M_key key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+int LWM2M_key_level(LWM2M_key key)
+{
+    if (LWM2M_key_object(key) == LWM2M_ID_NONE){
+        return 0;
+    }
+    if (LWM2M_key_instance(key) == LWM2M_ID_NONE){
+        return LWM2M_LEVEL_OBJECT;
+    }
+    if (LWM2M_key_resource(key) == LWM2M_ID_NONE){
+        return LWM2M_LEVEL_INSTANCE;
+    }
+    return LWM2M_LEVEL_RESOURCE;
+}
+
+bool LWM2M_key_parse(const uint8_t *path, uint16_t path_len, LWM2M_key *key)
+{
+    uint16_t ids[3] = {LWM2M_ID_NONE, LWM2M_ID_NONE, LWM2M_ID_NONE};
+    int level = 0;
+    uint16_t pos = 0;
+
+    if (pos < path_len && path[pos] == '/'){
+        pos++;
+    }
+    while (pos < path_len){
+        if (level == 3){
+            return false; // resource instances are not addressed
+        }
+        uint32_t id = 0;
+        uint16_t start = pos;
+        while (pos < path_len && path[pos] >= '0' && path[pos] <= '9'){
+            id = id * 10 + (path[pos++] - '0');
+            if (id >= LWM2M_ID_NONE){
+                return false;
+            }
+        }
+        if (pos == start || (pos < path_len && path[pos] != '/')){
+            return false;
+        }
+        ids[level++] = (uint16_t)id;
+        if (pos < path_len){
+            pos++; // '/'
+        }
+    }
+    if (level == 0){
+        return false;
+    }
+    *key = LWM2M_make_key(ids[0], ids[1], ids[2]);
+    return true;
+}
+
+int LWM2M_key_format(LWM2M_key key, bool slashes, char *buf)
+{
+    uint16_t ids[3] = {LWM2M_key_object(key), LWM2M_key_instance(key), LWM2M_key_resource(key)};
+    int len = 0;
+
+    for (int level = 0; level < LWM2M_key_level(key); level++){
+        if (level || slashes){
+            buf[len++] = '/';
+        }
+        char digits[5];
+        int n = 0;
+        uint16_t id = ids[level];
+        do{
+            digits[n++] = '0' + (id % 10);
+            id /= 10;
+        } while (id);
+        while (n){
+            buf[len++] = digits[--n];
+        }
+    }
+    if (slashes){
+        buf[len++] = '/';
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+void LWM2M_registry_init(void)
+{
+    num_entries = 0;
+    for (int slot = 0; slot < INDEX_SIZE; slot++){
+        index_slots[slot] = -1;
+    }
+    for (int res = 0; res < LWM2M_MAX_RESOURCES; res++){
+        engine_entries[res] = -1;
+    }
+}
+
+int LWM2M_registry_find(LWM2M_key key)
+{
+    for (uint32_t slot = key_hash(key) & INDEX_MASK; index_slots[slot] >= 0; slot = (slot + 1) & INDEX_MASK){
+        if (entries[index_slots[slot]].key == key){
+            return index_slots[slot];
+        }
+    }
+    return -1;
+}
+
+/*
+add one entry under parent (-1 for an object), -1 if the table is full
+*/
+static int add_entry(LWM2M_key key, int parent)
+{
+    if (num_entries >= LWM2M_REGISTRY_SIZE){
+        return -1;
+    }
+    int entry = num_entries++;
+    LWM2M_registry_entry *e = &entries[entry];
+    e->key = key;
+    e->read = NULL;
+    e->context = NULL;
+    e->first_child = -1;
+    e->next_sibling = -1;
+    e->engine_resource = -1;
+    e->operations = 0;
+
+    // children keep registration order, the list is short and only walked here
+    if (parent >= 0){
+        int16_t *link = &entries[parent].first_child;
+        while (*link >= 0){
+            link = &entries[*link].next_sibling;
+        }
+        *link = entry;
+    }
+
+    uint32_t slot = key_hash(key) & INDEX_MASK;
+    while (index_slots[slot] >= 0){
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    index_slots[slot] = entry;
+    return entry;
+}
+
+int LWM2M_registry_add(uint16_t object, uint16_t instance, uint16_t resource,
+    LWM2M_sensor_read read, void *context, int16_t engine_resource, uint8_t operations)
+{
+    LWM2M_key object_key = LWM2M_make_key(object, LWM2M_ID_NONE, LWM2M_ID_NONE);
+    LWM2M_key instance_key = LWM2M_make_key(object, instance, LWM2M_ID_NONE);
+    LWM2M_key resource_key = LWM2M_make_key(object, instance, resource);
+
+    if (object == LWM2M_ID_NONE || instance == LWM2M_ID_NONE || resource == LWM2M_ID_NONE
+        || LWM2M_registry_find(resource_key) >= 0 || engine_resource >= LWM2M_MAX_RESOURCES){
+        return -1;
+    }
+    int object_entry = LWM2M_registry_find(object_key);
+    if (object_entry < 0 && (object_entry = add_entry(object_key, -1)) < 0){
+        return -1;
+    }
+    int instance_entry = LWM2M_registry_find(instance_key);
+    if (instance_entry < 0 && (instance_entry = add_entry(instance_key, object_entry)) < 0){
+        return -1;
+    }
+    int entry = add_entry(resource_key, instance_entry);
+    if (entry < 0){
+        return -1;
+    }
+    entries[entry].read = read;
+    entries[entry].context = context;
+    entries[entry].engine_resource = engine_resource;
+    entries[entry].operations = operations;
+    if (engine_resource >= 0){
+        engine_entries[engine_resource] = entry;
+    }
+    return entry;
+}
+
+int LWM2M_registry_find_engine(uint16_t engine_resource)
+{
+    return (engine_resource < LWM2M_MAX_RESOURCES) ? engine_entries[engine_resource] : -1;
+}
+
+int LWM2M_registry_count(void)
+{
+    return num_entries;
+}
+
+const LWM2M_registry_entry *LWM2M_registry_get(int entry)
+{
+    return (entry >= 0 && entry < num_entries) ? &entries[entry] : NULL;
+}
+
+sample LWM2M_registry_value(int entry)
+{
+    const LWM2M_registry_entry *e = &entries[entry];
+    if (e->read){
+        return e->read(e->context);
+    }
+    return (e->engine_resource >= 0) ? LWM2M_sensor_value(e->engine_resource) : 0;
+}
+
+/*
+append the readable resources of an instance
+*/
+static int read_instance(int instance_entry, bool with_instance, LWM2M_record *records, int num_records, int max_records)
+{
+    for (int entry = entries[instance_entry].first_child; entry >= 0; entry = entries[entry].next_sibling){
+        if (!(entries[entry].operations & LWM2M_OP_READ)){
+            continue;
+        }
+        if (num_records >= max_records){
+            return -1;
+        }
+        records[num_records].object = LWM2M_RECORD_NO_OBJECT;
+        records[num_records].instance = with_instance ? LWM2M_key_instance(entries[entry].key) : LWM2M_ID_NONE;
+        records[num_records].resource = LWM2M_key_resource(entries[entry].key);
+        records[num_records].value = LWM2M_registry_value(entry);
+        records[num_records].time = 0;
+        num_records++;
+    }
+    return num_records;
+}
+
+int LWM2M_registry_read(int entry, LWM2M_record *records, int max_records)
+{
+    const LWM2M_registry_entry *e = LWM2M_registry_get(entry);
+    if (!e){
+        return -1;
+    }
+    switch (LWM2M_key_level(e->key)){
+    case LWM2M_LEVEL_RESOURCE:
+        if (max_records < 1){
+            return -1;
+        }
+        records[0].object = LWM2M_RECORD_NO_OBJECT;
+        records[0].instance = LWM2M_ID_NONE;
+        records[0].resource = LWM2M_key_resource(e->key);
+        records[0].value = LWM2M_registry_value(entry);
+        records[0].time = 0;
+        return 1;
+    case LWM2M_LEVEL_INSTANCE:
+        return read_instance(entry, false, records, 0, max_records);
+    default:{
+        int num_records = 0;
+        for (int instance = e->first_child; instance >= 0 && num_records >= 0; instance = entries[instance].next_sibling){
+            num_records = read_instance(instance, true, records, num_records, max_records);
+        }
+        return num_records;
+    }
+    }
+}
@@ -0,0 +1,129 @@
+/*
+LWM2M object registry
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Object / instance / resource tree of the client, and the index used to
+dispatch CoAP requests by path.
+
+A path is packed into a 64 bit key, 16 bits per level:
+
+  bits 63-48 object, 47-32 instance, 31-16 resource, 15-0 resource instance
+
+with LWM2M_ID_NONE in the levels below the addressed one, so "/3202/0" and
+"/3202/0/5600" are different keys. Entries live in a fixed table and are
+found through an open addressing hash of the key, a constant number of
+probes however many objects are registered. Every entry links to its first
+child and next sibling, so a GET on an object or instance reads the
+resources below it without searching.
+
+Registration is done at start up, there is no removal.
+*/
+
+#ifndef LWM2M_REGISTRY_H
+#define LWM2M_REGISTRY_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+#include "LWM2M_payload.h"
+#include "LWM2M_sensor.h"
+
+// objects, instances and resources together
+#ifndef LWM2M_REGISTRY_SIZE
+#define LWM2M_REGISTRY_SIZE 128
+#endif
+
+#define LWM2M_ID_NONE 0xFFFF
+
+// longest path text, "/65534/65534/65534/65534"
+#define LWM2M_PATH_SIZE 26
+
+typedef uint64_t LWM2M_key;
+
+// path levels
+#define LWM2M_LEVEL_OBJECT    1
+#define LWM2M_LEVEL_INSTANCE  2
+#define LWM2M_LEVEL_RESOURCE  3
+
+// operations allowed on a resource
+#define LWM2M_OP_READ     0x01
+#define LWM2M_OP_WRITE    0x02
+#define LWM2M_OP_OBSERVE  0x04
+
+inline LWM2M_key LWM2M_make_key(uint16_t object, uint16_t instance, uint16_t resource)
+{
+    return ((uint64_t)object << 48) | ((uint64_t)instance << 32) | ((uint64_t)resource << 16) | LWM2M_ID_NONE;
+}
+
+inline uint16_t LWM2M_key_object(LWM2M_key key) { return (uint16_t)(key >> 48); }
+inline uint16_t LWM2M_key_instance(LWM2M_key key) { return (uint16_t)(key >> 32); }
+inline uint16_t LWM2M_key_resource(LWM2M_key key) { return (uint16_t)(key >> 16); }
+
+// deepest level present in the key, 0 for none
+int LWM2M_key_level(LWM2M_key key);
+
+/*
+parse a CoAP Uri-Path, "3202/0/5600" with or without a leading '/',
+false if it is not 1 to 3 numeric levels
+*/
+bool LWM2M_key_parse(const uint8_t *path, uint16_t path_len, LWM2M_key *key);
+
+/*
+write the path of a key, e.g. "3202/0/5600", with a leading and trailing '/'
+if asked for (SenML base names), returns the length
+*/
+int LWM2M_key_format(LWM2M_key key, bool slashes, char *buf);
+
+struct LWM2M_registry_entry {
+    LWM2M_key key;
+    LWM2M_sensor_read read; // value of a resource, NULL = the engine sensor value
+    void *context;
+    int16_t first_child, next_sibling;
+    int16_t engine_resource; // row in the attribute engine resource table, -1 if none
+    uint8_t operations;
+};
+
+void LWM2M_registry_init(void);
+
+/*
+add a resource, creating its object and instance entries when needed.
+engine_resource is the attribute engine resource it is observed through,
+or -1. Returns the entry, or -1 if the table is full or the resource exists.
+*/
+int LWM2M_registry_add(uint16_t object, uint16_t instance, uint16_t resource,
+    LWM2M_sensor_read read, void *context, int16_t engine_resource, uint8_t operations);
+
+// entry for a key, -1 if not registered
+int LWM2M_registry_find(LWM2M_key key);
+
+// entry of an attribute engine resource, -1 if none
+int LWM2M_registry_find_engine(uint16_t engine_resource);
+
+// entries are numbered 0 to count - 1 in order of registration
+int LWM2M_registry_count(void);
+const LWM2M_registry_entry *LWM2M_registry_get(int entry);
+
+// current value of a resource entry
+sample LWM2M_registry_value(int entry);
+
+/*
+the readable resources at or below an entry, as records for LWM2M_encode
+with the entry path as base name. Records below an object carry their
+instance. Returns the number of records, -1 if more than max_records.
+*/
+int LWM2M_registry_read(int entry, LWM2M_record *records, int max_records);
+
+#endif // LWM2M_REGISTRY_H
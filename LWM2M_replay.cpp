@@ -0,0 +1,381 @@
+/*
+LWM2M trace replay
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_replay.h"
+#include "LWM2M_host.h"
+#include "LWM2M_sensor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the replayed resource
+#define REPLAY_RESOURCE 0
+
+// run being replayed, NULL outside LWM2M_replay_run
+static LWM2M_replay_stats *replay_stats = NULL;
+
+static void add_latency(uint32_t latency_ms)
+{
+    if (replay_stats->num_latencies < LWM2M_REPLAY_MAX_LATENCIES){
+        replay_stats->latency_ms[replay_stats->num_latencies] = latency_ms;
+    }
+    replay_stats->num_latencies++;
+}
+
+// FNV-1a over the notifications of each observation, summed at the end of a run
+// so that the order of observations within a sample doesn't matter
+#define FNV_BASIS 2166136261u
+static uint32_t obs_checksum[LWM2M_MAX_OBSERVATIONS];
+
+// value last notified per observation
+static sample obs_last[LWM2M_MAX_OBSERVATIONS];
+
+// range of the trace points pushed since the last notification, per observation
+static sample window_lo[LWM2M_MAX_OBSERVATIONS], window_hi[LWM2M_MAX_OBSERVATIONS];
+
+static void window_open(int obs)
+{
+    window_lo[obs] = HUGE_VALF;
+    window_hi[obs] = -HUGE_VALF;
+}
+
+/*
+how far the window of obs reached beyond what a notification sent of it,
+the value, the quiet period events and the window min and max
+*/
+static sample window_missed(int obs, sample s, const LWM2M_quiet_queue *events)
+{
+    sample lo = s, hi = s, value;
+    for (uint8_t i = 0; events && i < events->count; i++){
+        value = LWM2M_quiet_event_at(events, i)->value;
+        lo = (value < lo) ? value : lo;
+        hi = (value > hi) ? value : hi;
+    }
+    if (LWM2M_obs_statistic(obs, LWM2M_STAT_MIN, &value)){
+        lo = (value < lo) ? value : lo;
+    }
+    if (LWM2M_obs_statistic(obs, LWM2M_STAT_MAX, &value)){
+        hi = (value > hi) ? value : hi;
+    }
+    sample missed = (window_hi[obs] - hi > lo - window_lo[obs]) ? window_hi[obs] - hi : lo - window_lo[obs];
+    return (missed > 0) ? missed : 0;
+}
+
+static void add_checksum(int obs, const void *data, int len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (int i = 0; i < len; i++){
+        obs_checksum[obs] = (obs_checksum[obs] ^ bytes[i]) * 16777619u;
+    }
+}
+
+/*
+Platform hooks, count instead of sending
+*/
+bool send_notification(int obs, sample s, uint8_t cause, const LWM2M_quiet_queue *events)
+{
+    if (!replay_stats){
+        return true;
+    }
+    replay_stats->notifications++;
+    sample missed = window_missed(obs, s, events);
+    replay_stats->max_missed = (missed > replay_stats->max_missed) ? missed : replay_stats->max_missed;
+    window_open(obs);
+    for (uint8_t bit = 1; bit; bit <<= 1){
+        sample value;
+        replay_stats->statistics += LWM2M_obs_statistic(obs, bit, &value);
+    }
+    obs_last[obs] = s;
+    add_checksum(obs, &s, sizeof(s));
+    add_checksum(obs, &cause, sizeof(cause));
+    if (cause <= LWM2M_CAUSE_PMAX){
+        replay_stats->by_cause[cause]++;
+    }
+    uint32_t now = LWM2M_clock_ms();
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    if (cause == LWM2M_CAUSE_BAND && o && (o->flags & OBS_DWELLING)){
+        add_latency(now - o->dwell_start_ms); // from the first sample out of band
+    }
+    else if (cause == LWM2M_CAUSE_STEP || cause == LWM2M_CAUSE_BAND){
+        add_latency(0);
+    }
+    if (events){
+        for (uint8_t i = 0; i < events->count; i++){
+            add_latency(now - LWM2M_quiet_event_at(events, i)->time_ms);
+            add_checksum(obs, &LWM2M_quiet_event_at(events, i)->value, sizeof(sample));
+        }
+        replay_stats->events += events->count;
+        replay_stats->dropped += events->dropped;
+    }
+    return true;
+}
+
+sample get_sample(uint16_t resource)
+{
+    return LWM2M_sensor_fresh_value(resource, LWM2M_clock_ms());
+}
+
+int LWM2M_trace_load(const char *path, LWM2M_trace_point *points, int max_points)
+{
+    FILE *file = fopen(path, "r");
+    if (!file){
+        return -1;
+    }
+    char line[128];
+    int num_points = 0;
+    while (num_points < max_points && fgets(line, sizeof(line), file)){
+        unsigned long time_ms;
+        float value;
+        if (line[0] == '#'){
+            continue;
+        }
+        if (sscanf(line, "%lu,%f", &time_ms, &value) == 2){
+            points[num_points].time_ms = (uint32_t)time_ms;
+            points[num_points].value = value;
+            num_points++;
+        }
+    }
+    fclose(file);
+    return num_points;
+}
+
+int LWM2M_trace_synth(int shape, sample lo, sample hi, uint32_t period_ms, uint32_t interval_ms,
+    uint32_t seed, LWM2M_trace_point *points, int num_points)
+{
+    uint32_t random = seed ? seed : 1;
+    sample value = (lo + hi) / 2;
+    if (period_ms == 0){
+        period_ms = 1;
+    }
+    for (int i = 0; i < num_points; i++){
+        uint32_t time_ms = (uint32_t)i * interval_ms;
+        float phase = (float)(time_ms % period_ms) / period_ms;
+        switch (shape){
+        case LWM2M_TRACE_SINE:
+            value = lo + (hi - lo) * (0.5f + 0.5f * sinf(6.2831853f * phase));
+            break;
+        case LWM2M_TRACE_RAMP:
+            value = lo + (hi - lo) * phase;
+            break;
+        case LWM2M_TRACE_SQUARE:
+            value = (phase < 0.5f) ? lo : hi;
+            break;
+        default:
+            // xorshift32, steps of up to 1/period of the range per point
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            value += (hi - lo) * ((float)(random & 0xFFFF) / 0x8000 - 1.0f) * interval_ms / period_ms;
+            value = (value < lo) ? lo : (value > hi) ? hi : value;
+            break;
+        }
+        // quantize to 0.1 like the ADC conversion, so repeats don't count as changes
+        points[i].time_ms = time_ms;
+        points[i].value = floorf(value * 10.0f + 0.5f) / 10.0f;
+    }
+    return num_points;
+}
+
+void LWM2M_trace_noise(LWM2M_trace_point *points, int num_points, sample amplitude, uint32_t seed)
+{
+    uint32_t random = seed ? seed : 1;
+    for (int i = 0; i < num_points; i++){
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        sample value = points[i].value + amplitude * ((float)(random & 0xFFFF) / 0x8000 - 1.0f);
+        points[i].value = floorf(value * 10.0f + 0.5f) / 10.0f;
+    }
+}
+
+/*
+reset the engine and start observers observations of the replayed resource,
+returns the start time of the trace and the number of observations
+*/
+static uint32_t replay_start(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, LWM2M_replay_stats *stats, int *observing)
+{
+    memset(stats, 0, sizeof(*stats) - sizeof(stats->latency_ms));
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        obs_checksum[obs] = FNV_BASIS;
+        window_open(obs);
+    }
+
+    // the clock only moves forward across runs, so the sampling wheel stays valid
+    LWM2M_host_clock_simulated(true);
+    uint32_t start = LWM2M_clock_ms() + 1000;
+    LWM2M_host_clock_set(start);
+
+    // push only source, starting at the first value of the trace
+    LWM2M_obs_table_init();
+    LWM2M_sensor_register(REPLAY_RESOURCE, NULL, NULL, 0);
+    LWM2M_sensor_push(REPLAY_RESOURCE, trace[0].value);
+    LWM2M_sensor_poll(start);
+    LWM2M_resource_set_attributes(REPLAY_RESOURCE, attr);
+
+    replay_stats = stats;
+    for (*observing = 0; *observing < observers; (*observing)++){
+        uint8_t token = (uint8_t)*observing;
+        int obs = LWM2M_obs_create(REPLAY_RESOURCE, &token, sizeof(token));
+        if (obs < 0){
+            break; // table full
+        }
+        LWM2M_notification_init(obs);
+    }
+    return start;
+}
+
+/*
+stop the observations and total the checksum
+*/
+static void replay_end(LWM2M_replay_stats *stats)
+{
+    stats->evaluations = LWM2M_obs_evaluations();
+    LWM2M_resource_cancel(REPLAY_RESOURCE);
+    replay_stats = NULL;
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        stats->checksum += obs_checksum[obs];
+    }
+}
+
+void LWM2M_replay_run(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, int num_points, LWM2M_replay_stats *stats)
+{
+    if (num_points == 0){
+        memset(stats, 0, sizeof(*stats) - sizeof(stats->latency_ms));
+        return;
+    }
+    int observing;
+    uint32_t start = replay_start(attr, observers, trace, stats, &observing);
+
+    for (int i = 0; i < num_points; i++){
+        uint32_t now = LWM2M_clock_ms();
+        if (start + trace[i].time_ms > now){
+            LWM2M_host_clock_advance(start + trace[i].time_ms - now, LWM2M_TIMER_TICK_MS);
+        }
+        for (int obs = 0; obs < observing; obs++){
+            window_lo[obs] = (trace[i].value < window_lo[obs]) ? trace[i].value : window_lo[obs];
+            window_hi[obs] = (trace[i].value > window_hi[obs]) ? trace[i].value : window_hi[obs];
+        }
+        LWM2M_sensor_push(REPLAY_RESOURCE, trace[i].value);
+        LWM2M_sensor_poll(LWM2M_clock_ms());
+        stats->samples++;
+    }
+    replay_end(stats);
+}
+
+void LWM2M_replay_run_blocks(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, int num_points, int block_size, bool batch,
+    LWM2M_replay_stats *stats)
+{
+    static sample values[LWM2M_REPLAY_MAX_BLOCK];
+    static uint32_t times[LWM2M_REPLAY_MAX_BLOCK];
+
+    if (num_points == 0){
+        memset(stats, 0, sizeof(*stats) - sizeof(stats->latency_ms));
+        return;
+    }
+    if (block_size < 1 || block_size > LWM2M_REPLAY_MAX_BLOCK){
+        block_size = LWM2M_REPLAY_MAX_BLOCK;
+    }
+    int observing;
+    uint32_t start = replay_start(attr, observers, trace, stats, &observing);
+
+    for (int first = 0; first < num_points; first += block_size){
+        int count = (num_points - first < block_size) ? num_points - first : block_size;
+        uint32_t now = LWM2M_clock_ms();
+        if (start + trace[first].time_ms > now){
+            LWM2M_host_clock_advance(start + trace[first].time_ms - now, LWM2M_TIMER_TICK_MS);
+        }
+        for (int i = 0; i < count; i++){
+            values[i] = trace[first + i].value;
+            times[i] = start + trace[first + i].time_ms;
+        }
+        if (batch){
+            LWM2M_resource_update_batch(REPLAY_RESOURCE, values, count, times);
+        }
+        else{
+            for (int i = 0; i < count; i++){
+                LWM2M_resource_update(REPLAY_RESOURCE, values[i]);
+            }
+        }
+        stats->samples += count;
+    }
+    replay_end(stats);
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+the simulated ADC channel of LWM2M_replay_run_sampled, counting reads
+*/
+static uint32_t replay_reads;
+
+static sample replay_read(void *context)
+{
+    replay_reads++;
+    return LWM2M_host_adc_read(context);
+}
+
+void LWM2M_replay_run_sampled(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, int num_points, uint32_t period_ms, uint32_t max_period_ms,
+    LWM2M_replay_stats *stats)
+{
+    if (num_points == 0){
+        memset(stats, 0, sizeof(*stats) - sizeof(stats->latency_ms));
+        return;
+    }
+    int observing;
+    LWM2M_host_adc_set(0, trace[0].value);
+    uint32_t start = replay_start(attr, observers, trace, stats, &observing);
+    LWM2M_sensor_register(REPLAY_RESOURCE, &replay_read, (void *)0, period_ms);
+    LWM2M_sensor_set_max_period(REPLAY_RESOURCE, max_period_ms);
+    replay_reads = 0;
+
+    for (int i = 0; i < num_points; i++){
+        uint32_t now = LWM2M_clock_ms();
+        if (start + trace[i].time_ms > now){
+            LWM2M_host_clock_advance(start + trace[i].time_ms - now, LWM2M_TIMER_TICK_MS);
+        }
+        LWM2M_host_adc_set(0, trace[i].value);
+        stats->samples++;
+        for (int obs = 0; obs < observing; obs++){
+            sample error = fabsf(trace[i].value - obs_last[obs]);
+            stats->max_error = (error > stats->max_error) ? error : stats->max_error;
+        }
+    }
+    stats->reads = replay_reads;
+    replay_end(stats);
+}
+
+uint32_t LWM2M_replay_percentile(LWM2M_replay_stats *stats, int percent)
+{
+    uint32_t kept = (stats->num_latencies < LWM2M_REPLAY_MAX_LATENCIES) ?
+        stats->num_latencies : LWM2M_REPLAY_MAX_LATENCIES;
+    if (kept == 0){
+        return 0;
+    }
+    qsort(stats->latency_ms, kept, sizeof(stats->latency_ms[0]), &compare_latency);
+    return stats->latency_ms[(kept - 1) * percent / 100];
+}
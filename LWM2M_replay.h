@@ -0,0 +1,127 @@
+/*
+LWM2M trace replay
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Replays a signal trace through the attribute engine on the host, using the
+simulated clock of LWM2M_host.cpp, and counts what the engine sends.
+
+A trace is a list of (time, value) points, recorded from a device as CSV
+lines "time_ms,value" or generated. Every point is pushed to resource 0
+through LWM2M_sensor_push, and the pmin and pmax timers run between points
+at LWM2M_TIMER_TICK_MS resolution, so a trace of hours replays in
+milliseconds.
+
+This file provides the send_notification and get_sample hooks, it replaces
+LWM2M_resource.cpp in a host build.
+*/
+
+#ifndef LWM2M_REPLAY_H
+#define LWM2M_REPLAY_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// trigger latencies kept per run, further ones are counted but not kept
+#ifndef LWM2M_REPLAY_MAX_LATENCIES
+#define LWM2M_REPLAY_MAX_LATENCIES 16384
+#endif
+
+// largest block for LWM2M_replay_run_blocks
+#ifndef LWM2M_REPLAY_MAX_BLOCK
+#define LWM2M_REPLAY_MAX_BLOCK 1024
+#endif
+
+// synthetic trace shapes
+#define LWM2M_TRACE_SINE    0
+#define LWM2M_TRACE_RAMP    1 // sawtooth
+#define LWM2M_TRACE_SQUARE  2
+#define LWM2M_TRACE_WALK    3 // random walk between lo and hi
+
+struct LWM2M_trace_point {
+    uint32_t time_ms; // from the start of the trace
+    sample value;
+};
+
+struct LWM2M_replay_stats {
+    uint32_t samples; // trace points replayed
+    uint32_t reads; // sensor reads, LWM2M_replay_run_sampled
+    sample max_error; // largest difference of a trace point from the value last notified, same
+    uint32_t evaluations; // samples evaluated by the observations, LWM2M_obs_evaluations
+    uint32_t notifications;
+    uint32_t by_cause[LWM2M_CAUSE_PMAX + 1];
+    uint32_t events; // quiet period events sent along with notifications
+    uint32_t dropped; // quiet period events overwritten before sending
+    uint32_t statistics; // reporting window statistics sent along with notifications
+    sample max_missed; // farthest a trace point lay outside the values and the min and max
+                       // sent for its reporting window, LWM2M_replay_run
+    uint32_t checksum; // of the values and causes sent, in order per observation
+    uint32_t num_latencies; // reportable events with a measured latency
+    uint32_t latency_ms[LWM2M_REPLAY_MAX_LATENCIES];
+};
+
+/*
+read a CSV trace, one "time_ms,value" per line, '#' starts a comment.
+Returns the number of points read, or -1 if the file can't be opened.
+*/
+int LWM2M_trace_load(const char *path, LWM2M_trace_point *points, int max_points);
+
+/*
+generate num_points points every interval_ms, swinging between lo and hi
+with period_ms. seed makes LWM2M_TRACE_WALK repeatable.
+*/
+int LWM2M_trace_synth(int shape, sample lo, sample hi, uint32_t period_ms, uint32_t interval_ms,
+    uint32_t seed, LWM2M_trace_point *points, int num_points);
+
+// add uniform noise of up to amplitude either way to the points, quantized again
+void LWM2M_trace_noise(LWM2M_trace_point *points, int num_points, sample amplitude, uint32_t seed);
+
+/*
+replay a trace against observers observations of one resource, all using attr.
+The engine tables are reset first. stats is cleared and filled in.
+
+Trigger latency is the time from a reportable band or step change to the
+notification carrying it: 0 when sent at once, up to pmin when it was queued
+in the quiet period. A band change sent at once after a dwell is timed from
+the first sample out of band. pmax and init notifications have no trigger.
+*/
+void LWM2M_replay_run(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, int num_points, LWM2M_replay_stats *stats);
+
+/*
+replay a trace in blocks of block_size points, as from a DMA buffer. The clock
+moves to the time of the first point of each block, then the block is evaluated
+with LWM2M_resource_update_batch if batch is set, or a sample at a time with
+LWM2M_resource_update. Both give the same stats apart from trigger latency.
+*/
+void LWM2M_replay_run_blocks(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, int num_points, int block_size, bool batch,
+    LWM2M_replay_stats *stats);
+
+/*
+replay a trace through a simulated ADC read by a sensor source instead of
+pushing every point: sampled every period_ms, or planned between period_ms
+and max_period_ms if that is larger (LWM2M_sensor_set_max_period). The
+reads taken are counted in stats->reads.
+*/
+void LWM2M_replay_run_sampled(const LWM2M_attributes *attr, int observers,
+    const LWM2M_trace_point *trace, int num_points, uint32_t period_ms, uint32_t max_period_ms,
+    LWM2M_replay_stats *stats);
+
+// percentile (0-100) of the kept trigger latencies, sorts them in place
+uint32_t LWM2M_replay_percentile(LWM2M_replay_stats *stats, int percent);
+
+#endif // LWM2M_REPLAY_H
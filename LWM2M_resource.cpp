@@ -24,6 +24,12 @@ pmin, pmax, gt, lt, and step
 
 supports setting max-age for cache control
 
+responses larger than a block and values written in blocks use
+block-wise transfer (RFC 7959)
+
+what the client does is logged through a ring written out by a thread of
+its own, and counted in the metrics object, read with GET as any other
+
 Functional implementation and interpretation is described in the comments below
 
 */
@@ -32,530 +38,1216 @@ Functional implementation and interpretation is described in the comments below
 #include "rtos.h"
 #include "nsdl_support.h"
 #include "LWM2M_resource.h"
+#include "LWM2M_resource_attributes.h"
+#include "LWM2M_payload.h"
+#include "LWM2M_write_attributes.h"
+#include "LWM2M_sensor.h"
+#include "LWM2M_notify_queue.h"
+#include "LWM2M_registry.h"
+#include "LWM2M_pool.h"
+#include "LWM2M_confirm.h"
+#include "LWM2M_coalesce.h"
+#include "LWM2M_response_cache.h"
+#include "LWM2M_block.h"
+#include "LWM2M_persist.h"
+#include "LWM2M_log.h"
+#include "LWM2M_histogram.h"
 #include "string.h"
 
-#define LWM2M_RES_ID    "3202/0/5600"
 #define LWM2M_RES_RT    "oma.lwm2m"
+#define LWM2M_RES_OBJECT   3202 // analog input
+#define LWM2M_RES_INSTANCE 0
+#define LWM2M_RES_NUM   5600 // analog input current value
+#define LWM2M_RES_INDEX 0 // row in the attribute engine resource table
+// records of the reporting window statistics, IPSO min and max measured value,
+// the others are resource IDs for private use
+#define LWM2M_RES_MIN       5601
+#define LWM2M_RES_MAX       5602
+#define LWM2M_RES_MEAN      26241
+#define LWM2M_RES_VARIANCE  26242
+#define LWM2M_RES_COUNT     26243
+#define LWM2M_RES_P10       26244
+#define LWM2M_RES_MEDIAN    26245
+#define LWM2M_RES_P90       26246
+// counters and latencies of the client, an object ID for private use
+#define LWM2M_METRICS_OBJECT    26241
+#define LWM2M_METRICS_INSTANCE  0
+// its resources, see LWM2M_read_metric
+#define LWM2M_METRIC_EVALUATIONS     0
+#define LWM2M_METRIC_REPORTS         1 // 1 to 5, notifications by cause, LWM2M_CAUSE_INIT to LWM2M_CAUSE_PMAX
+#define LWM2M_METRIC_SEND_FAILURES   6 // notify_queue full, retried by the engine
+#define LWM2M_METRIC_NSDL_FAILURES   7 // not accepted by the nsdl library, retried
+#define LWM2M_METRIC_QUEUE_DEPTH     8 // entries in notify_queue
+#define LWM2M_METRIC_QUEUE_HIGH      9 // most entries in notify_queue
+#define LWM2M_METRIC_REPORT_P50      10 // ms from the report of a value to its sending
+#define LWM2M_METRIC_REPORT_P99      11
+#define LWM2M_METRIC_REPORT_MAX      12
+#define LWM2M_METRIC_SAMPLE_P50      13 // ms from the oldest sample of a notification to its sending
+#define LWM2M_METRIC_SAMPLE_P99      14
+#define LWM2M_METRIC_SAMPLE_MAX      15
+#define LWM2M_METRICS                16
 #define OBS_TRUE 1
 #define OBS_FALSE 0
 
+// sampling period of the analog sensor while the resource is observed
+#ifndef LWM2M_SAMPLE_PERIOD_MS
+#define LWM2M_SAMPLE_PERIOD_MS 100
+#endif
+// longest planned sampling period, LWM2M_SAMPLE_PERIOD_MS or less samples at the fixed period
+#ifndef LWM2M_SAMPLE_MAX_PERIOD_MS
+#define LWM2M_SAMPLE_MAX_PERIOD_MS 60000
+#endif
+// longest sleep of the notification thread, keeps LWM2M_clock_ms ahead of the us ticker wrap
+#define LWM2M_MAX_SLEEP_MS 60000
+#define LWM2M_WAKEUP_SIGNAL 0x1
+// retry interval for a notification the nsdl library did not accept
+#define LWM2M_SEND_RETRY_MS 100
+// period at which the log thread writes the event log out
+#ifndef LWM2M_LOG_DRAIN_MS
+#define LWM2M_LOG_DRAIN_MS 100
+#endif
+// placement of pmax deadlines, see LWM2M_pmax_schedule.h. The epoch of an aligned
+// grid is the boot time, LWM2M_PMAX_SPREAD offsets it by a phase from the MAC
+// address so that devices booted together don't report together
+#ifndef LWM2M_PMAX_MODE
+#define LWM2M_PMAX_MODE LWM2M_PMAX_EXACT
+#endif
+#ifndef LWM2M_PMAX_JITTER_MS
+#define LWM2M_PMAX_JITTER_MS 5000
+#endif
+#ifndef LWM2M_PMAX_PERIOD_MS
+#define LWM2M_PMAX_PERIOD_MS 0 // grid of each pmax
+#endif
+#ifndef LWM2M_PMAX_SPREAD
+#define LWM2M_PMAX_SPREAD 0
+#endif
+// CoAP response headers and option lists in the pools, one response is built
+// at a time by LWM2M_resource_cb, the spare covers a PUT with a value and a query
+#ifndef LWM2M_RESPONSE_POOL_SIZE
+#define LWM2M_RESPONSE_POOL_SIZE 2
+#endif
+
 extern Serial pc; 
 
 // settings variables to point to when building response packet
-uint8_t LWM2M_max_age = 0; // cache age in seconds, 0=disable caching
-uint8_t LWM2M_content_type = 0; // 0=text/plain content-format
+uint8_t LWM2M_max_age = 0; // cache age in seconds at least, 0=only while the sampling keeps values current
+uint8_t LWM2M_content_type[2]; // content-format option, negotiated from Accept
+static uint8_t LWM2M_max_age_value[4]; // Max-Age option of the response being built
+static uint8_t LWM2M_etag_value[LWM2M_ETAG_LEN]; // ETag option of an uncached response
+static uint8_t LWM2M_block1_value[LWM2M_BLOCK_OPTION_SIZE]; // Block1 option of a PUT response
+static uint8_t LWM2M_block2_value[LWM2M_BLOCK_OPTION_SIZE]; // Block2 option of a GET response
 
 // obs variables
-static uint8_t LWM2M_obs_number = 0;
-static uint8_t *LWM2M_obs_token_ptr = NULL;
-static uint8_t LWM2M_obs_token_len = 0;
 static uint8_t LWM2M_obs_option; 
 // values per: draft-ietf-core-observe-16
 // OMA LWM2M CR ref.
 #define START_OBS 0
 #define STOP_OBS 1
 
-// must be a scalar, ( decimal or integer )
-typedef float sample;
+// attributes being built from the query options
+static LWM2M_attributes pending_attributes;
+
+// triggered notifications, from the attribute engine to the sender
+static LWM2M_notify_queue notify_queue;
+// content-format asked for by each observer, LWM2M_CT_NONE if no Accept option
+static uint16_t notify_format[LWM2M_MAX_OBSERVATIONS];
+// notifications taken from notify_queue and waiting for the coalescing window
+static LWM2M_coalesce notify_batch;
+
+// events, written out to pc by LWM2M_log_thread, put from any thread
+static LWM2M_log event_log;
+// what the engine does not count, updated and read under LWM2M_engine_lock:
+// most entries notify_queue held, notifications the nsdl library refused,
+// and ms from the report of a value and from the oldest sample sent along 
+// with it to the sending
+static uint32_t notify_queue_high;
+static uint32_t nsdl_failures;
+static LWM2M_histogram report_latency, sample_latency;
+
+// notification thread, woken by LWM2M_wakeup
+static Thread *LWM2M_thread = NULL;
+
+// serializes the attribute engine between the notification thread and the CoAP
+// callback, so that there is only ever one producer for notify_queue. The sender
+// side of the queue does not take it.
+static Mutex LWM2M_engine_lock;
+
+// encoded GET responses, see LWM2M_response_max_age_ms
+static LWM2M_response_cache response_cache;
+
+// responses built by LWM2M_resource_cb, no heap is used on the request paths.
+// Tokens are kept in the observation table and responses point to the request's.
+LWM2M_POOL_STORAGE(LWM2M_response_blocks, sn_coap_hdr_s, LWM2M_RESPONSE_POOL_SIZE);
+LWM2M_POOL_STORAGE(LWM2M_options_blocks, sn_coap_options_list_s, LWM2M_RESPONSE_POOL_SIZE);
+static LWM2M_pool LWM2M_response_pool, LWM2M_options_pool;
 
-// notification attributes and default values from LWM2M_resource.h
-static sample LWM2M_gt = D_GT;
-static sample LWM2M_lt = D_LT;
-static sample LWM2M_step = D_STEP;
-static float LWM2M_pmax = D_PMAX;
-static float LWM2M_pmin = D_PMIN;
+//example for potentiometer or analog sensor reading 0-100%
+AnalogIn LWM2M_Sensor(A0); 
+char LWM2M_update_string[LWM2M_BLOCK1_PAYLOAD_SIZE + 1];
+// resources read by one GET on an object or instance
+#ifndef LWM2M_READ_RECORDS
+#define LWM2M_READ_RECORDS 8
+#endif
+// notifications due within this window are sent as one composite senml pack,
+// for servers reading Observe-Composite style notifications. 0 = send each alone
+#ifndef LWM2M_COALESCE_WINDOW_MS
+#define LWM2M_COALESCE_WINDOW_MS 0
+#endif
+// longest a GET response is served from the cache while sampling keeps its values current
+#ifndef LWM2M_CACHE_MAX_AGE_MS
+#define LWM2M_CACHE_MAX_AGE_MS 60000
+#endif
+#if LWM2M_COALESCE_RECORDS < LWM2M_NOTIFY_GROUP_SIZE
+#error "LWM2M_COALESCE_RECORDS must hold a notification with a full quiet period queue and every statistic"
+#endif
+// encoded response and notification payloads, sized for a senml+json pack of 
+// a batch of notifications, or of a GET on an object
+#define LWM2M_PAYLOAD_RECORDS ((LWM2M_READ_RECORDS > LWM2M_COALESCE_RECORDS) ? \
+    LWM2M_READ_RECORDS : LWM2M_COALESCE_RECORDS)
+#define LWM2M_PAYLOAD_SIZE (64 + 48 * LWM2M_PAYLOAD_RECORDS)
+#if LWM2M_PAYLOAD_SIZE < LWM2M_BLOCK_SIZE
+#error "LWM2M_payload must hold a block of LWM2M_BLOCK_SIZE"
+#endif
+// the metrics object is read by one GET
+#if LWM2M_PAYLOAD_RECORDS < LWM2M_METRICS
+#error "LWM2M_READ_RECORDS must hold every resource of the metrics object"
+#endif
+uint8_t LWM2M_payload[LWM2M_PAYLOAD_SIZE];
+static LWM2M_record LWM2M_records[LWM2M_PAYLOAD_RECORDS];
+// a Block2 transfer not continued within this time is read again from the sensors
+#ifndef LWM2M_BLOCK2_TIMEOUT_MS
+#define LWM2M_BLOCK2_TIMEOUT_MS 30000
+#endif
+
+// the values of a GET response sent in blocks, each block is encoded from this
+// copy so that all are of the same representation. One transfer at a time.
+struct LWM2M_block2_transfer {
+    int entry; // -1 = none
+    uint16_t content_format;
+    uint32_t started_ms, max_age_ms;
+    uint32_t serial; // counts the copies taken, for the ETag
+    uint8_t etag[LWM2M_ETAG_LEN];
+    char base_name[LWM2M_PATH_SIZE];
+    LWM2M_record records[LWM2M_PAYLOAD_RECORDS];
+    LWM2M_encoder encoder;
+};
+static LWM2M_block2_transfer block2_transfer = {-1};
+static LWM2M_block1_transfer block1_transfer;
 
-// flag to indicate at least one new attribute is being updated
-static bool attribute_update = false;
+/*
+Functions
+*/
 
-void LWM2M_notification_init();
-void on_update(sample);
+/*
+Platform hooks for the attribute engine in LWM2M_resource_attributes.cpp
+*/
 
-// flag set in ISR to enable notifications to be triggered in ISR 
-// and sent at thread priority
-static bool notification_trigger = false;
+/*
+trigger the build and sending of coap observe response
+queues current value, any events queued in the pmin quiet period and the statistics
+of the reporting window as one group, false if the queue is full, the engine then retries
+*/
+bool send_notification(int obs, sample s, uint8_t cause, const LWM2M_quiet_queue *events) 
+{
+    LWM2M_notify_entry group[LWM2M_NOTIFY_GROUP_SIZE];
+    uint32_t count = LWM2M_notify_group(group, obs, s, cause, events);
+    if (!LWM2M_notify_queue_push(&notify_queue, group, count))
+        return false;
+    uint32_t depth = LWM2M_notify_queue_count(&notify_queue);
+    notify_queue_high = (depth > notify_queue_high) ? depth : notify_queue_high;
+    LWM2M_wakeup();
+    return true; // async
+}
 
-// currentValue variables updated upon callback from sensor driver
-static sample current_sample = 0, last_sample = 0, notify_sample = 0;
+/*
+return last sensor update
+*/
+sample get_sample(uint16_t resource)
+{
+    // sampling is planned from the attributes, a report reads the sensor if the value is old
+    return LWM2M_sensor_fresh_value(resource, LWM2M_clock_ms());
+}
 
-// switch to turn notification on and off
-static bool LWM2M_observing = false;
+/*
+millisecond clock from the 32 bit microsecond ticker, extended past the 
+ticker wrap by accumulating differences. Called from more than one thread, 
+and at least every LWM2M_MAX_SLEEP_MS by the notification thread.
+*/
+uint32_t LWM2M_clock_ms(void)
+{
+    static uint32_t last_us = 0, remainder_us = 0, ms = 0;
+    __disable_irq();
+    uint32_t now_us = us_ticker_read();
+    remainder_us += now_us - last_us;
+    last_us = now_us;
+    ms += remainder_us / 1000;
+    remainder_us %= 1000;
+    uint32_t now_ms = ms;
+    __enable_irq();
+    return now_ms;
+}
 
-//example for potentiometer or analog sensor reading 0-100%
-AnalogIn LWM2M_Sensor(A0); 
-char LWM2M_value_string[5];
-char LWM2M_update_string[5];
+/*
+storage for LWM2M_persist. mbed 2 has no flash driver for this board, so
+there is none and nothing is kept over a reset; a target with one returns 
+its two sectors here and programs and erases them below.
+*/
+const uint8_t *LWM2M_persist_region(int region)
+{
+    return NULL;
+}
+
+bool LWM2M_persist_program(int region, uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    return false;
+}
 
-// query string for setting notification attributes (LWM2M write attributes interface)
-static char *LWM2M_query_string_ptr = NULL;
-char *query_option;
-char query_options[5][20];//static for now 
-uint8_t num_options = 0;
+bool LWM2M_persist_erase(int region)
+{
+    return false;
+}
 
-// instrumentation about which condition triggered a notification
-static bool pmax_exceeded = false;
-static bool pmin_trigger = false;
+/*
+wake the notification thread, from ISR or thread context
+*/
+void LWM2M_wakeup(void)
+{
+    if (LWM2M_thread)
+        LWM2M_thread->signal_set(LWM2M_WAKEUP_SIGNAL);
+}
+
+// sensor read function, scaled to 0-100%
+static sample LWM2M_read_sensor(void *context)
+{
+    return LWM2M_Sensor.read() * (float) 100;
+}
+
+// GET read function, the sensor value while it is within LWM2M_max_age, context is the engine resource
+static sample LWM2M_read_cached(void *context)
+{
+    return LWM2M_sensor_cached_value((uint16_t)(intptr_t)context, LWM2M_clock_ms(), LWM2M_max_age * 1000UL);
+}
 
 /*
-Functions
+GET read function of the metrics object, context is the LWM2M_METRIC_*.
+Runs under LWM2M_engine_lock as every read. Counts are exact up to 2^24 as a sample.
 */
+static sample LWM2M_read_metric(void *context)
+{
+    int metric = (int)(intptr_t)context;
+    LWM2M_obs_counters counters;
+    LWM2M_obs_get_counters(LWM2M_OBS_ALL, &counters);
+    switch (metric){
+    case LWM2M_METRIC_EVALUATIONS: return counters.evaluations;
+    case LWM2M_METRIC_SEND_FAILURES: return counters.send_failures;
+    case LWM2M_METRIC_NSDL_FAILURES: return nsdl_failures;
+    case LWM2M_METRIC_QUEUE_DEPTH: return LWM2M_notify_queue_count(&notify_queue);
+    case LWM2M_METRIC_QUEUE_HIGH: return notify_queue_high;
+    case LWM2M_METRIC_REPORT_P50: return LWM2M_histogram_percentile(&report_latency, 50);
+    case LWM2M_METRIC_REPORT_P99: return LWM2M_histogram_percentile(&report_latency, 99);
+    case LWM2M_METRIC_REPORT_MAX: return report_latency.max;
+    case LWM2M_METRIC_SAMPLE_P50: return LWM2M_histogram_percentile(&sample_latency, 50);
+    case LWM2M_METRIC_SAMPLE_P99: return LWM2M_histogram_percentile(&sample_latency, 99);
+    case LWM2M_METRIC_SAMPLE_MAX: return sample_latency.max;
+    default: return counters.reports[metric - LWM2M_METRIC_REPORTS];
+    }
+}
+
 /*
-Turn on and off notification based on the latest attributes.
-Update attributes should stop and start to update values
+put an event in the log, from any thread, LWM2M_log_thread writes it out.
+value is logged if flags has LWM2M_LOG_VALUE.
 */
-//notifications on
-void LWM2M_start_notification()
+static void LWM2M_log_event(uint8_t event, int obs, int32_t arg, uint8_t flags, float value)
 {
-    LWM2M_observing = true;
-    LWM2M_notification_init();
+    LWM2M_log_record record;
+    memset(&record, 0, sizeof(record));
+    record.time_ms = LWM2M_clock_ms();
+    record.event = event;
+    record.obs = obs;
+    record.arg = arg;
+    record.flags = flags;
+    record.value = value;
+    LWM2M_log_put(&event_log, &record);
 }
-//notifications off
-void LWM2M_stop_notification()
+
+// a notification sent or refused, with what triggered it
+static void LWM2M_log_notification(uint8_t event, int obs, uint8_t cause, uint8_t flags, 
+    int payload_len, uint16_t content_format)
 {
-    LWM2M_observing = false;
+    LWM2M_log_record record;
+    memset(&record, 0, sizeof(record));
+    record.time_ms = LWM2M_clock_ms();
+    record.event = event;
+    record.cause = cause;
+    record.flags = flags;
+    record.obs = obs;
+    record.content_format = content_format;
+    record.arg = payload_len;
+    LWM2M_log_put(&event_log, &record);
 }
 
 /*
-Thread to sample the input and use the update callback on_update when sensor values change.
-on_update will run the limits test and set the notification event trigger accordingly.
-Also checks for the event trigger and sends a notification packet in this thread.
-This allows the notification trigger to be set in a hardware timer ISR without blocking
-the ISR with a network operation.
+writes the log out to pc, at a priority below the notification thread and
+the CoAP callback, which don't wait for the UART
 */
-static void LWM2M_notification_thread(void const *args)
+static void LWM2M_log_thread(void const *args)
 {
+    LWM2M_log_record record;
+    char line[LWM2M_LOG_LINE_SIZE];
     while (true){
-        wait(.1);
-        current_sample = LWM2M_Sensor.read() * (float) 100;
-        
-        // if this csample is different from last sample, then call the resource on_update
-        if((current_sample != last_sample) && LWM2M_observing){
-            //pc.printf("LWM2M resource update: %3.1f => %3.1f\r\n", last_sample, current_sample);
-            last_sample = current_sample;
-            on_update(current_sample); // callback to process notification attributes
-        }
-        
-        // if triggered and in observing mode, build and send the notification packet
-        if (notification_trigger && LWM2M_observing){
-            
-            if (pmax_exceeded){ pc.printf("pmax exceeded\r\n"); pmax_exceeded = false; }
-            if (pmin_trigger){pc.printf("pmin trigger\r\n"); pmin_trigger = false; }
-            
-            sprintf(LWM2M_value_string, "%3.1f", notify_sample); 
-            pc.printf("Sending: %s\r\n", LWM2M_value_string);        
-            LWM2M_obs_number++;
-            if(sn_nsdl_send_observation_notification
-                (LWM2M_obs_token_ptr, LWM2M_obs_token_len, 
-                (uint8_t*)LWM2M_value_string, strlen(LWM2M_value_string), 
-                &LWM2M_obs_number, sizeof(LWM2M_obs_number), 
-                COAP_MSG_TYPE_NON_CONFIRMABLE, 0) == 0){
-                    
-                pc.printf("LWM2M notification failed\r\n");
-            }
-            else{
-                pc.printf("LWM2M notification\r\n");
-                notification_trigger = false;
-            }
+        while (LWM2M_log_take(&event_log, &record)){
+            LWM2M_log_format(&record, line, sizeof(line));
+            pc.printf("%s\r\n", line);
         }
+        uint32_t dropped = LWM2M_log_dropped(&event_log);
+        if (dropped)
+            pc.printf("%lu log records dropped\r\n", (unsigned long)dropped);
+        Thread::wait(LWM2M_LOG_DRAIN_MS);
     }
 }
 
+// ms since a record of a notification being sent was taken
+static uint32_t LWM2M_record_age_ms(const LWM2M_record *record)
+{
+    return (record->time < 0) ? (uint32_t)(-record->time * 1000 + 0.5f) : 0;
+}
+
 /*
-examine one query option to see if the tag matches one of the observe attributes
-if so, set the corresponding attribute pmin, pmax, lt, gt, step and flag pending update
+time until the next sampling or pmin/pmax timer, bounded by LWM2M_MAX_SLEEP_MS.
+Reads the timer wheels and the confirm state, call with LWM2M_engine_lock held.
 */
-void set_notification_attribute(char* option)
+static uint32_t LWM2M_sleep_ms(uint32_t now)
 {
-    char* attribute = strtok(option, "="); // first token
-    char* value = strtok(NULL, "="); // next token
-    
-    pc.printf("Setting: %s = %s\r\n", attribute, value);
+    uint32_t next, sleep = LWM2M_MAX_SLEEP_MS;
+    if (LWM2M_obs_next_tick(&next) && (int32_t)(next - now) < (int32_t)sleep)
+        sleep = ((int32_t)(next - now) > 0) ? next - now : 0;
+    if (LWM2M_sensor_next_tick(&next) && (int32_t)(next - now) < (int32_t)sleep)
+        sleep = ((int32_t)(next - now) > 0) ? next - now : 0;
+    if (LWM2M_confirm_next_deadline(&next) && (int32_t)(next - now) < (int32_t)sleep)
+        sleep = ((int32_t)(next - now) > 0) ? next - now : 0;
+    if (LWM2M_coalesce_next(&notify_batch, &next) && (int32_t)(next - now) < (int32_t)sleep)
+        sleep = ((int32_t)(next - now) > 0) ? next - now : 0;
+    if (LWM2M_notify_queue_count(&notify_queue) && sleep > LWM2M_SEND_RETRY_MS)
+        sleep = LWM2M_SEND_RETRY_MS; // a send failed or was rate limited, retry
+    return sleep;
+}
 
-    if (strcmp(attribute, "pmin") == 0){
-        sscanf(value, "%f", &LWM2M_pmin);
-        attribute_update = true;
-        return;
-    }
-    else if(strcmp(attribute, "pmax") == 0){
-        sscanf(value, "%f", &LWM2M_pmax);
-        attribute_update = true;
-        return;
+/*
+set the path of the records of a notification to obs from the registry, 
+false if the observation was cancelled or its resource is not registered
+*/
+static bool LWM2M_notification_path(int obs, LWM2M_record *records, uint32_t count)
+{
+    LWM2M_engine_lock.lock();
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    int entry = o ? LWM2M_registry_find_engine(o->resource) : -1;
+    LWM2M_engine_lock.unlock();
+    const LWM2M_registry_entry *e = LWM2M_registry_get(entry);
+    if (!e)
+        return false;
+    for (uint32_t i = 0; i < count; i++){
+        records[i].object = LWM2M_key_object(e->key);
+        records[i].instance = LWM2M_key_instance(e->key);
+        records[i].resource = LWM2M_key_resource(e->key);
     }
-    else if(strcmp(attribute, "gt") == 0){
-        sscanf(value, "%f", &LWM2M_gt);
-        attribute_update = true;
-        return;
+    return true;
+}
+
+/*
+resource ID of the record of a statistic
+*/
+static uint16_t LWM2M_statistic_resource(uint8_t statistic)
+{
+    switch (statistic){
+    case LWM2M_STAT_MIN: return LWM2M_RES_MIN;
+    case LWM2M_STAT_MAX: return LWM2M_RES_MAX;
+    case LWM2M_STAT_MEAN: return LWM2M_RES_MEAN;
+    case LWM2M_STAT_VARIANCE: return LWM2M_RES_VARIANCE;
+    case LWM2M_STAT_COUNT: return LWM2M_RES_COUNT;
+    case LWM2M_STAT_P10: return LWM2M_RES_P10;
+    case LWM2M_STAT_MEDIAN: return LWM2M_RES_MEDIAN;
+    default: return LWM2M_RES_P90;
     }
-    else if(strcmp(attribute, "lt") == 0){
-        sscanf(value, "%f", &LWM2M_lt);
-        attribute_update = true;
-        return;
-    }    
-    else if(strcmp(attribute, "st") == 0){
-        sscanf(value, "%f", &LWM2M_step);
-        attribute_update = true;
-        return;
+}
+
+/*
+encode count records of a notification to obs into LWM2M_payload: one record per 
+queued event, one per statistic of the reporting window under its own resource 
+ID (LWM2M_RES_MIN ...) and the current value last, times relative to the notification in 
+seconds (negative, in the past). A single notification is named below its instance 
+path, and without an Accept option a single value goes as text/plain and a pack as 
+senml+json. A composite names each record by its full path, in senml+cbor if the 
+observer asked for it, else senml+json.
+*/
+static int LWM2M_encode_notification(int obs, const LWM2M_record *records, uint32_t count, bool composite, 
+    uint16_t *content_format)
+{
+    char base_name[LWM2M_PATH_SIZE] = "/";
+
+    memcpy(LWM2M_records, records, count * sizeof(LWM2M_record));
+    if (composite){
+        *content_format = (notify_format[obs] == LWM2M_CT_SENML_CBOR) ? LWM2M_CT_SENML_CBOR : LWM2M_CT_SENML_JSON;
     }
-    else if(strcmp(attribute, "cancel") == 0){
-        LWM2M_stop_notification();
-        attribute_update = true;
-        return;
+    else{
+        // base name is the instance path
+        LWM2M_key_format(LWM2M_make_key(records[0].object, records[0].instance, LWM2M_ID_NONE), true, base_name);
+        for (uint32_t i = 0; i < count; i++){
+            LWM2M_records[i].object = LWM2M_RECORD_NO_OBJECT;
+            LWM2M_records[i].instance = LWM2M_RECORD_NO_INSTANCE;
+        }
+        *content_format = notify_format[obs];
+        if (*content_format == LWM2M_CT_NONE)
+            *content_format = (count > 1) ? LWM2M_CT_SENML_JSON : LWM2M_CT_TEXT_PLAIN;
     }
+    return LWM2M_encode(*content_format, base_name, LWM2M_records, count, 
+        LWM2M_payload, sizeof(LWM2M_payload));
 }
 
-
-/* 
-Callback for LWM2M (CoAP REST) operations allowed on the resosurce
-GET and PUT methods allowed 
+/*
+encode and send a notification of count records under the token of obs.
+Returns 1 when sent, with the message ID in msg_id, 0 if the nsdl library
+did not accept it, -1 if it can't be sent (cancelled or not encodable).
 */
-static uint8_t LWM2M_resource_cb(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_s *address, sn_proto_info_s * proto)
+static int LWM2M_transmit(int obs, const LWM2M_record *records, uint32_t count, uint8_t cause, 
+    bool confirmable, bool composite, uint16_t *msg_id)
 {
-    sn_coap_hdr_s *coap_res_ptr = 0;
+    // snapshot the observer, it may be cancelled by the CoAP callback
+    LWM2M_engine_lock.lock();
+    LWM2M_observation *o = LWM2M_obs_get(obs);
+    uint8_t token[LWM2M_MAX_TOKEN_LEN], token_len = 0, obs_number = 0;
+    if (o){
+        token_len = o->token_len;
+        memcpy(token, o->token, token_len);
+        obs_number = ++o->obs_number;
+        LWM2M_persist_sequence(obs);
+    }
+    LWM2M_engine_lock.unlock();
+    if (!o)
+        return -1; // cancelled while pending
+
+    uint16_t content_format;
+    int payload_len = LWM2M_encode_notification(obs, records, count, composite, &content_format);
+    if (payload_len < 0){
+        LWM2M_log_event(LWM2M_LOG_ENCODE_FAILED, obs, 0, 0, 0);
+        return -1;
+    }
+    uint8_t flags = (confirmable ? LWM2M_LOG_CON : 0) | (composite ? LWM2M_LOG_COMPOSITE : 0);
+    // the notification API takes an 8 bit content type, observers 
+    // asking for TLV are refused at registration
+    *msg_id = sn_nsdl_send_observation_notification
+        (token, token_len, 
+        LWM2M_payload, payload_len, 
+        &obs_number, sizeof(obs_number), 
+        confirmable ? COAP_MSG_TYPE_CONFIRMABLE : COAP_MSG_TYPE_NON_CONFIRMABLE, (uint8_t)content_format);
+    if (*msg_id == 0){
+        LWM2M_log_notification(LWM2M_LOG_NOTIFY_FAILED, obs, cause, flags, payload_len, content_format);
+        return 0;
+    }
+    LWM2M_log_notification(LWM2M_LOG_NOTIFY, obs, cause, flags, payload_len, content_format);
+    return 1;
+}
 
-    if(COAP_MSG_CODE_REQUEST_GET == received_coap_ptr->msg_code){
-        coap_res_ptr = sn_coap_build_response(received_coap_ptr, COAP_MSG_CODE_RESPONSE_CONTENT);
-   
-        current_sample = LWM2M_Sensor.read() * (float) 100;
-        sprintf(LWM2M_value_string,"%3.1f", current_sample);
-        pc.printf("LWM2M resource callback\r\n");
-        pc.printf("LWM2M resource state %s\r\n", LWM2M_value_string);
-   
-        coap_res_ptr->payload_len = strlen(LWM2M_value_string);
-        coap_res_ptr->payload_ptr = (uint8_t*)LWM2M_value_string;
-        
-        coap_res_ptr->content_type_ptr = &LWM2M_content_type;
-        coap_res_ptr->content_type_len = sizeof(LWM2M_content_type);
-        
-        coap_res_ptr->options_list_ptr = (sn_coap_options_list_s*)nsdl_alloc(sizeof(sn_coap_options_list_s));
-        if(!coap_res_ptr->options_list_ptr){
-            pc.printf("cant alloc option list\r\n");
-            coap_res_ptr->options_list_ptr = NULL; //FIXME report error and recover
+/*
+send the collected notifications, a single one as it is, several as one composite
+under the token of the first confirmable one, or of the first. Notifications of 
+observations cancelled while held are dropped first, and again if the carrier is
+cancelled while sending, the rest go under another token. Returns as 
+LWM2M_transmit, the batch is kept for a retry if nsdl did not accept it.
+*/
+static int LWM2M_send_batch(uint32_t now)
+{
+    int sent = -1, carrier = 0;
+    uint16_t msg_id;
+    const LWM2M_record *records = LWM2M_coalesce_records(&notify_batch, now);
+    while (true){
+        LWM2M_engine_lock.lock();
+        for (int i = notify_batch.num_items - 1; i >= 0; i--){
+            if (!LWM2M_obs_get(notify_batch.items[i].obs))
+                LWM2M_coalesce_remove(&notify_batch, i);
         }
-        else{
-            memset(coap_res_ptr->options_list_ptr, 0, sizeof(sn_coap_options_list_s));
-            coap_res_ptr->options_list_ptr->max_age_ptr = &LWM2M_max_age;
-            coap_res_ptr->options_list_ptr->max_age_len = sizeof(LWM2M_max_age);
+        LWM2M_engine_lock.unlock();
+        if (notify_batch.num_items == 0)
+            return -1;
+        carrier = 0;
+        for (int i = notify_batch.num_items - 1; i >= 0; i--){
+            if (notify_batch.items[i].confirmable)
+                carrier = i;
         }
-        
-        if(received_coap_ptr->token_ptr){
-            pc.printf("Token included\r\n");
-            // replace any existing token
-            if(LWM2M_obs_token_ptr){   
-                free(LWM2M_obs_token_ptr);
-                LWM2M_obs_token_ptr = 0;
-            }
-            //with new token
-            LWM2M_obs_token_ptr = (uint8_t*)malloc(received_coap_ptr->token_len);
-            if(LWM2M_obs_token_ptr){
-                memcpy(LWM2M_obs_token_ptr, received_coap_ptr->token_ptr, received_coap_ptr->token_len);
-                LWM2M_obs_token_len = received_coap_ptr->token_len;
-            }
+        const LWM2M_coalesce_item *item = &notify_batch.items[carrier];
+        sent = LWM2M_transmit(item->obs, records, notify_batch.num_records, item->cause, 
+            item->confirmable, notify_batch.num_items > 1, &msg_id);
+        if (sent >= 0)
+            break;
+        LWM2M_engine_lock.lock();
+        bool cancelled = !LWM2M_obs_get(item->obs);
+        LWM2M_engine_lock.unlock();
+        if (!cancelled)
+            break; // not encodable, dropped
+    }
+    if (sent == 0){
+        LWM2M_engine_lock.lock();
+        nsdl_failures++;
+        LWM2M_engine_lock.unlock();
+        return 0;
+    }
+    if (sent > 0){
+        bool carrier_confirmable = notify_batch.items[carrier].confirmable;
+        LWM2M_engine_lock.lock();
+        for (int i = 0; i < notify_batch.num_items; i++){
+            const LWM2M_coalesce_item *sent_item = &notify_batch.items[i];
+            LWM2M_confirm_sent(sent_item->obs, i == carrier && carrier_confirmable, msg_id, now);
+            // the reported value is the last record of a notification, the oldest sample the first
+            LWM2M_histogram_add(&report_latency, 
+                LWM2M_record_age_ms(&records[sent_item->first_record + sent_item->num_records - 1]));
+            LWM2M_histogram_add(&sample_latency, LWM2M_record_age_ms(&records[sent_item->first_record]));
         }
+        LWM2M_engine_lock.unlock();
+    }
+    LWM2M_coalesce_clear(&notify_batch);
+    return sent;
+}
 
-        if(received_coap_ptr->options_list_ptr->observe) {
-            // get observe start/stop value from received GET
-            LWM2M_obs_option = * received_coap_ptr->options_list_ptr->observe_ptr;   
-            // start or stop based on option value 
-            // ref. draft-ietf-core-observe-16          
-            if (START_OBS == LWM2M_obs_option){
-                coap_res_ptr->options_list_ptr->observe_ptr = &LWM2M_obs_number;
-                coap_res_ptr->options_list_ptr->observe_len = sizeof(LWM2M_obs_number);
-                LWM2M_start_notification(); 
+/*
+take every complete notification group from the queue as LWM2M_confirm decides
+and send them, coalesced within LWM2M_COALESCE_WINDOW_MS. Stops at the first one 
+that is rate limited or that the nsdl library does not accept, which stays queued 
+for a retry. The queue then fills and holds the engine back. Then sends the 
+retransmissions that are due, and passes the congestion state on to the engine 
+as a pmin floor.
+*/
+static void LWM2M_send_notifications(void)
+{
+    uint32_t available;
+    uint32_t now = LWM2M_clock_ms();
+
+    while ((available = LWM2M_notify_queue_count(&notify_queue)) > 0){
+        if (LWM2M_coalesce_due(&notify_batch, now) && LWM2M_send_batch(now) == 0)
+            break;
+
+        // one group ends with the reported value
+        uint32_t count = 1;
+        while (count < available && !(LWM2M_notify_queue_peek(&notify_queue, count - 1)->flags & LWM2M_NOTIFY_LAST))
+            count++;
+        const LWM2M_notify_entry *last = LWM2M_notify_queue_peek(&notify_queue, count - 1);
+        int obs = last->obs;
+
+        LWM2M_engine_lock.lock();
+        int how = LWM2M_obs_get(obs) ? LWM2M_confirm_decide(obs, last->value, last->cause, now) : LWM2M_SEND_HOLD;
+        LWM2M_engine_lock.unlock();
+        if (how == LWM2M_SEND_WAIT)
+            break;
+
+        LWM2M_record group[LWM2M_NOTIFY_GROUP_SIZE];
+        for (uint32_t i = 0; i < count; i++){
+            const LWM2M_notify_entry *entry = LWM2M_notify_queue_peek(&notify_queue, i);
+            group[i].value = entry->value;
+            group[i].time = -(float)(last->time_ms - entry->time_ms) / 1000;
+        }
+        // dropped if cancelled while pending or taken over by the CON in flight
+        if (how != LWM2M_SEND_HOLD && LWM2M_notification_path(obs, group, count)){
+            for (uint32_t i = 0; i < count; i++){
+                const LWM2M_notify_entry *entry = LWM2M_notify_queue_peek(&notify_queue, i);
+                if (entry->flags & LWM2M_NOTIFY_STATISTIC)
+                    group[i].resource = LWM2M_statistic_resource(entry->statistic);
             }
-            else if (STOP_OBS == LWM2M_obs_option){
-                LWM2M_stop_notification();
+            bool confirmable = how == LWM2M_SEND_CON;
+            if (!LWM2M_coalesce_add(&notify_batch, obs, last->cause, confirmable, group, count, now)){
+                // full, send what is collected first
+                if (LWM2M_send_batch(now) == 0)
+                    break;
+                LWM2M_coalesce_add(&notify_batch, obs, last->cause, confirmable, group, count, now);
             }
         }
- 
-        sn_nsdl_send_coap_message(address, coap_res_ptr);
-        nsdl_free(coap_res_ptr->options_list_ptr);
-        coap_res_ptr->options_list_ptr = NULL;
-        coap_res_ptr->content_type_ptr = NULL;// parser_release below tries to free this memory
+        LWM2M_notify_queue_pop(&notify_queue, count);
     }
-    
-    /* 
-    PUT needs to be enabled for the write attributes operation which is empty payload + query options
-    */
-    else if(COAP_MSG_CODE_REQUEST_PUT == received_coap_ptr->msg_code){
-        //pc.printf("PUT: %d bytes\r\n", received_coap_ptr->payload_len);
-        if((received_coap_ptr->payload_len > 0) && (received_coap_ptr->payload_len <= 5)){
-            memcpy(LWM2M_update_string, (char *)received_coap_ptr->payload_ptr, received_coap_ptr->payload_len);
-            LWM2M_update_string[received_coap_ptr->payload_len] = '\0';
-            pc.printf("PUT: %s\r\n", LWM2M_update_string);
-
-            sscanf( LWM2M_update_string, "%f3.1", &current_sample); //update for read-back test, observe will clobber
-
-            coap_res_ptr = sn_coap_build_response(received_coap_ptr, COAP_MSG_CODE_RESPONSE_CHANGED);
-            sn_nsdl_send_coap_message(address, coap_res_ptr);
+    if (LWM2M_coalesce_due(&notify_batch, now))
+        LWM2M_send_batch(now);
+
+    // retransmissions and superseding notifications, the latest value only
+    LWM2M_confirm_send send;
+    LWM2M_engine_lock.lock();
+    int obs = LWM2M_confirm_due(0, now, &send);
+    LWM2M_engine_lock.unlock();
+    while (obs >= 0){
+        uint16_t msg_id = 0;
+        int sent = -1;
+        LWM2M_record record;
+        record.value = send.value;
+        record.time = 0;
+        if (send.give_up)
+            LWM2M_log_event(LWM2M_LOG_NOT_ANSWERING, obs, 0, 0, 0);
+        else if (LWM2M_notification_path(obs, &record, 1))
+            sent = LWM2M_transmit(obs, &record, 1, send.cause, send.confirmable, false, &msg_id);
+        LWM2M_engine_lock.lock();
+        if (send.give_up){
+            LWM2M_persist_cancel(obs);
+            LWM2M_obs_release(obs);
         }
-        // see if there are query options and scan for write attributes, allow payload and query options
-        // PUT without query ffrom web client reads some query string, wireshark it...
-        if(received_coap_ptr->options_list_ptr->uri_query_ptr != NULL){
-            LWM2M_query_string_ptr = (char*)nsdl_alloc(received_coap_ptr->options_list_ptr->uri_query_len+1);
-            if (LWM2M_query_string_ptr){
-                memcpy(LWM2M_query_string_ptr, 
-                    received_coap_ptr->options_list_ptr->uri_query_ptr, 
-                    received_coap_ptr->options_list_ptr->uri_query_len);
-                memset(LWM2M_query_string_ptr + received_coap_ptr->options_list_ptr->uri_query_len,'\0',1);//string terminator
-                // diagnostic
-                // pc.printf("query string received: %s\r\n", LWM2M_query_string_ptr);
-                attribute_update = false;
-                // extract query options from string
-                query_option = strtok(LWM2M_query_string_ptr, "&");// split the string
-                num_options = 0;
-                while (query_option != NULL){
-                    strcpy(query_options[num_options++], query_option);
-                    // pc.printf("query part: %s\r\n", query_option);
-                    query_option = strtok(NULL, "&");// next query option
-                }
-                // pc.printf("setting attributes\r\n");
-                for (int option = 0; option < num_options; option++)
-                    set_notification_attribute(query_options[option]);
-
-                nsdl_free(LWM2M_query_string_ptr);
-                // if anything was updated, re-initialize the stored notification attributes
-                if (attribute_update){
-                    // initializes and sends an update if observing is on, don't change observing state
-                    // allows cancel to turn off observing and updte state without sending a notification
-                    LWM2M_notification_init(); 
-                    coap_res_ptr = sn_coap_build_response(received_coap_ptr, COAP_MSG_CODE_RESPONSE_CHANGED); // 2.04
-                }
-                else
-                    // if query options are sent but no notification attribute names were found, it's an error
-                    coap_res_ptr = sn_coap_build_response(received_coap_ptr, COAP_MSG_CODE_RESPONSE_BAD_REQUEST);// 4.00
-                    
-                sn_nsdl_send_coap_message(address, coap_res_ptr);
-
-            }
-            else
-                pc.printf("cant alloc query string\r\n"); 
+        else if (sent < 0)
+            LWM2M_confirm_close(obs);
+        else{
+            nsdl_failures += sent == 0;
+            LWM2M_confirm_sent(obs, send.confirmable, msg_id, now); // a refused one counts as lost
         }
+        obs = LWM2M_confirm_due(obs + 1, now, &send);
+        LWM2M_engine_lock.unlock();
     }
 
-    sn_coap_parser_release_allocated_coap_msg_mem(coap_res_ptr);
-
-    return 0;
+    // spread the observers over the send interval while the link is congested
+    LWM2M_engine_lock.lock();
+    int observers = 0;
+    for (int row = 0; row < LWM2M_MAX_OBSERVATIONS; row++)
+        observers += LWM2M_obs_get(row) != NULL;
+    LWM2M_obs_set_pmin_floor(LWM2M_confirm_pmin_floor_ms(observers));
+    LWM2M_engine_lock.unlock();
 }
 
-int create_LWM2M_resource(sn_nsdl_resource_info_s *resource_ptr)
+/*
+ACK or RST to a notification, to be called from the nsdl rx callback for 
+messages of those types. A RST, or no ACK to a confirmable notification after 
+its retransmissions, cancels the observation (RFC 7641 3.6 and 4.5).
+*/
+void LWM2M_notification_response(sn_coap_hdr_s *coap_packet_ptr)
 {
-    static Thread exec_thread(LWM2M_notification_thread);
-
-    nsdl_create_dynamic_resource(resource_ptr, 
-        sizeof(LWM2M_RES_ID)-1, (uint8_t*)LWM2M_RES_ID, 
-        sizeof(LWM2M_RES_RT)-1, (uint8_t*)LWM2M_RES_RT, 
-        OBS_TRUE, &LWM2M_resource_cb, 
-        (SN_GRS_GET_ALLOWED | SN_GRS_PUT_ALLOWED));
-    return 0;
+    if (coap_packet_ptr->msg_type != COAP_MSG_TYPE_ACKNOWLEDGEMENT && coap_packet_ptr->msg_type != COAP_MSG_TYPE_RESET)
+        return;
+    bool reset = coap_packet_ptr->msg_type == COAP_MSG_TYPE_RESET;
+    LWM2M_engine_lock.lock();
+    int obs = LWM2M_confirm_response(coap_packet_ptr->msg_id, reset);
+    if (obs >= 0 && reset){
+        LWM2M_log_event(LWM2M_LOG_RESET, obs, 0, 0, 0);
+        LWM2M_persist_cancel(obs);
+        LWM2M_obs_release(obs);
+    }
+    LWM2M_engine_lock.unlock();
+    if (obs >= 0 && !reset)
+        LWM2M_wakeup(); // a superseding notification may be due
 }
 
-
-/* LWM2M Observe attributes for float and int data, for string and bool only implement pmin and pmax
-This implements the LWM2M 1.0 Notification attributes based on the following interpretation:
-
-1. lt and gt define three signal bands or states, for example low alarm, normal, and high alarm
-it is desired to transmit a notification whenever the measured variable is in a different band from 
-the last reported band, that is from nornal to high alarm, and from high alarm to normal, and all 
-other possible state transitions, e.g. high to low, etc. subject to pmin (see below)
-
-2. step defines a minimum change needed in the measured variable relative to the last reported value
-to trigger a new report of the value. For example, if the last reported value was 51.0, and the step 
-variable was set at 1.0, the signal would need to be greater than or equal to 52.0, or less than or 
-equal to 50.0 to trigger a new report (notification). Each time the measured variable is reported, the
-upper and lower values required to trigger a new report are updated relative to the reported value.
-
-3. pmin defines the minumum desired reporting interval. pmin is assumed to define a mandatory
-quiet period between notifications. a notification here is assumed to contain at least a single value. 
-Therefore if a combination of potentially reportable events are triggered by lt, gt, and step during the 
-quiet period, the value at the end of the quiet period MUST be reported (sent in a notification). 
-Additional values captured during the quiet period MAY be sent along with the current value in a
-notification object.
-
-4. pmax defines the largest time interval allowed without a notification. Each time a notification is sent, 
-a timer is reset, set to expire at pmax seconds after the notification was sent. If the pmax timer expires,
-a notification is sent.
-
-Implementation Notes: Each time a notification is sent, pmin and pmax timers are are restarted. 
-
-The algorithm for lt and gt is generalized to accept from one to n limit values, each defining a boundary 
-between n+1 signal bands (states). A transition from any state to any other state will create a reportable 
-event.
-
-The simple implementation below does not capture information about state changes that occur during the quiet
-period, only that some state transition has occurred, with a reporting of the current value at the end of the
-quiet period. Implementations MAY capture state transitions which occur during the quiet period and report them
-at the end of the quiet period along with the current value in a notification object (senml+json or 
-lwm2m format tlv) 
+/*
+Thread to sample the input and use the update callback on_update when sensor values change.
+on_update will run the limits test and queue triggered notifications.
+Also advances the pmin and pmax timer wheel for all observations and sends the queued 
+notification packets in this thread, so no network operation is done in an ISR.
+The thread sleeps until the next sampling or attribute timer, or until woken by a 
+sensor push or a new notification, so it is idle while nothing is observed.
 */
+static void LWM2M_notification_thread(void const *args)
+{
+    while (true){
+        // the CoAP callback arms and cancels timers under the lock, the wait is outside it
+        LWM2M_engine_lock.lock();
+        uint32_t sleep = LWM2M_sleep_ms(LWM2M_clock_ms());
+        LWM2M_engine_lock.unlock();
+        Thread::signal_wait(LWM2M_WAKEUP_SIGNAL, sleep);
+        uint32_t now = LWM2M_clock_ms();
+
+        // sample due sensors and deliver pushed values, on_update is called when a value changes
+        LWM2M_engine_lock.lock();
+        LWM2M_sensor_poll(now);
+        LWM2M_obs_tick(now);
+        LWM2M_engine_lock.unlock();
+
+        // drain everything triggered since the last wakeup
+        LWM2M_send_notifications();
+    }
+}
 
-// data type float - int could be used but just convert/cast
-typedef float sample; 
-
-//algorithm can accept any number of limit values and report when signal changes between limit bands
-#define MAX_LIMITS 2
-static int num_limits = 2;
-static sample limits[MAX_LIMITS];
-static int last_band;
-
-// step limit values updated on reporting
-static sample high_step, low_step;
-
-// flag for enabling triggering of immediate notification on reportable event
-bool pmin_exceeded = false;
-
-// flag for scheduling reporting at the expiration of pmin quiet period
-bool report_scheduled = false;
-
-// hardware timers for pmin and pmax 
-Ticker pmin_timer, pmax_timer; 
-
-/* 
-Determine which band [0..num_limits] the provided sample is in
-Works with any number of bands 2 to MAX_LIMITS+1 using an array of limit settings
+/*
+build a response to a request in a pooled header, as sn_coap_build_response 
+does but without copying the token: a piggybacked ACK for a confirmable 
+request, else a non-confirmable response which gets its message ID when sent.
+NULL if the pool is empty.
 */
-int band(sample s)
+static sn_coap_hdr_s *LWM2M_build_response(sn_coap_hdr_s *received_coap_ptr, uint8_t code)
 {
-    if (s > limits[num_limits-1]){
-        return num_limits;
+    sn_coap_hdr_s *coap_res_ptr = (sn_coap_hdr_s *)LWM2M_pool_alloc(&LWM2M_response_pool);
+    if (!coap_res_ptr){
+        LWM2M_log_event(LWM2M_LOG_POOL_EMPTY, -1, LWM2M_LOG_POOL_RESPONSE, 0, 0);
+        return NULL;
     }
-    else{
-        for ( int limit = 0; limit < num_limits; limit++ ){
-            if (s <= limits[limit]){
-                return limit;
-            }
-        }
+    memset(coap_res_ptr, 0, sizeof(sn_coap_hdr_s));
+    coap_res_ptr->msg_code = (sn_coap_msg_code_e)code;
+    if (received_coap_ptr->msg_type == COAP_MSG_TYPE_CONFIRMABLE){
+        coap_res_ptr->msg_type = COAP_MSG_TYPE_ACKNOWLEDGEMENT;
+        coap_res_ptr->msg_id = received_coap_ptr->msg_id;
     }
-    return -1;
+    else
+        coap_res_ptr->msg_type = COAP_MSG_TYPE_NON_CONFIRMABLE;
+    // the request outlives the response, which is sent before the callback returns
+    coap_res_ptr->token_ptr = received_coap_ptr->token_ptr;
+    coap_res_ptr->token_len = received_coap_ptr->token_len;
+    return coap_res_ptr;
 }
 
 /*
-trigger the build and sending of coap observe response
-sends current value
+option list for a response from the pool, cleared, NULL if the pool is empty
 */
-bool send_notification(sample s) 
+static sn_coap_options_list_s *LWM2M_response_options(sn_coap_hdr_s *coap_res_ptr)
 {
-    notify_sample = s; // mailbox
-    notification_trigger = true;// trigger notification 
-    return true; // async
+    coap_res_ptr->options_list_ptr = (sn_coap_options_list_s *)LWM2M_pool_alloc(&LWM2M_options_pool);
+    if (!coap_res_ptr->options_list_ptr){
+        LWM2M_log_event(LWM2M_LOG_POOL_EMPTY, -1, LWM2M_LOG_POOL_OPTIONS, 0, 0);
+        return NULL;
+    }
+    memset(coap_res_ptr->options_list_ptr, 0, sizeof(sn_coap_options_list_s));
+    return coap_res_ptr->options_list_ptr;
 }
 
-time_t get_current_time()
+/*
+send a response and return it to the pools, nsdl encodes it into its own buffer
+*/
+static void LWM2M_send_response(sn_nsdl_addr_s *address, sn_coap_hdr_s *coap_res_ptr)
 {
-    return time(NULL);
+    if (!coap_res_ptr)
+        return;
+    sn_nsdl_send_coap_message(address, coap_res_ptr);
+    LWM2M_pool_free(&LWM2M_options_pool, coap_res_ptr->options_list_ptr);
+    LWM2M_pool_free(&LWM2M_response_pool, coap_res_ptr);
 }
 
 /*
-demand sensor read or return last callback update
+how long the readable resources at or below an entry keep their latest
+values, the least of LWM2M_sensor_valid_ms. 0 for a resource with its own
+read function, its value is not known to stay the same.
 */
-sample get_sample()
+static uint32_t LWM2M_entry_valid_ms(int entry, uint32_t now)
 {
-    // notification thread is reading sensor in a polling loop and calling on_update 
-    // when the sample value changes 
-    // current_sample is most recent ADC read result within 100 mSec
-    return current_sample;
+    const LWM2M_registry_entry *e = LWM2M_registry_get(entry);
+    if (LWM2M_key_level(e->key) == LWM2M_LEVEL_RESOURCE){
+        if (!(e->operations & LWM2M_OP_READ))
+            return UINT32_MAX;
+        return (e->engine_resource >= 0) ? LWM2M_sensor_valid_ms(e->engine_resource, now) : 0;
+    }
+    uint32_t valid_ms = UINT32_MAX;
+    for (int child = e->first_child; child >= 0; child = LWM2M_registry_get(child)->next_sibling){
+        uint32_t child_ms = LWM2M_entry_valid_ms(child, now);
+        valid_ms = (child_ms < valid_ms) ? child_ms : valid_ms;
+    }
+    return valid_ms;
 }
 
-int report_sample(sample s);//prototype for forward reference
-
 /*
-handler for the pmin timer, called when pmin expires
-if no reportable events have occurred, set the pmin expired flag
-to inform the report scheduler to report immediately
-If a reportable event has occured, report a new sample
+time a GET response stays fresh: until the next sampling read of a value
+in it, a change of value also ends it (LWM2M_sensor_changes), up to 
+LWM2M_CACHE_MAX_AGE_MS. LWM2M_max_age is the least the server accepts.
 */
-void on_pmin()
+static uint32_t LWM2M_response_max_age_ms(int entry, uint32_t now)
 {
-    if (report_scheduled){
-        report_scheduled = false;
-        pmin_trigger = true; // diagnostic for state machine visibility
-        report_sample(get_sample());
-    }
-    else{
-        pmin_exceeded = true; // state machine
-        pmin_timer.detach();
-    }
-    return;
+    uint32_t max_age_ms = LWM2M_entry_valid_ms(entry, now);
+    if (max_age_ms > LWM2M_CACHE_MAX_AGE_MS)
+        max_age_ms = LWM2M_CACHE_MAX_AGE_MS;
+    if (max_age_ms < LWM2M_max_age * 1000UL)
+        max_age_ms = LWM2M_max_age * 1000UL;
+    return max_age_ms;
 }
 
 /*
-handler for pmax timer, report a new sample
+reply with a status code and no payload
 */
-void on_pmax()
+static void LWM2M_send_status(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_s *address, uint8_t code)
 {
-    report_sample(get_sample());
-    pmax_exceeded = true; // diagnostic state machine, cleared at reporting
-    return;
+    LWM2M_send_response(address, LWM2M_build_response(received_coap_ptr, code));
 }
 
 /*
-for reporting a sample that satisfies the reporting criteria and resetting the state machine
+reply to a block of a PUT with a status code and the Block1 option
 */
-int report_sample(sample s)
-{
-    if(send_notification(s)){  // sends current_sample if observing is on
-        last_band = band(s); // limits state machine
-        high_step = s + LWM2M_step; // reset floating band upper limit defined by step
-        low_step = s - LWM2M_step; // reset floating band lower limit defined by step
-        pmin_timer.detach();
-        pmin_exceeded = false; // state machine to inhibit reporting at intervals < pmin
-        pmin_timer.attach(&on_pmin, LWM2M_pmin);
-        pmax_timer.detach();
-        pmax_timer.attach(&on_pmax, LWM2M_pmax);
-        return 1;
+static void LWM2M_send_block1_status(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_s *address, uint8_t code, 
+    const LWM2M_block *block1)
+{
+    sn_coap_hdr_s *coap_res_ptr = LWM2M_build_response(received_coap_ptr, code);
+    if (coap_res_ptr && LWM2M_response_options(coap_res_ptr)){
+        coap_res_ptr->options_list_ptr->block1_ptr = LWM2M_block1_value;
+        coap_res_ptr->options_list_ptr->block1_len = LWM2M_block_option(block1, LWM2M_block1_value);
     }
-    else return 0;
+    LWM2M_send_response(address, coap_res_ptr);
 }
 
 /*
-schedule_report
-this will send the report immediately if pmin is exceeded or else schedule it for later, 
-when the pmin timer expires.
-Note that if a reportable event occurs during the pmin "quiet period" and then the sample 
-returns to a non-reportable state, the sample will still be reported. This can be used to 
-identify signal excursions within the quiet period that aren't reported otherwise.
-Implementations MAY queue reportable events to be scheduled as a bulk object notification
+encode the size bytes from offset of a GET response into LWM2M_payload, sets more if
+bytes follow. A response larger than one block keeps its values in block2_transfer, 
+and its later blocks are encoded from there, resuming where the last block ended.
+Returns the length or -1. Called with the engine lock held.
 */
-void schedule_report(sample s)
+static int LWM2M_encode_response(int entry, uint16_t content_format, const char *base_name, 
+    uint32_t offset, int size, uint32_t now, bool *more)
 {
-    if (pmin_exceeded){ 
-        // immediate report if pmin is already passed
-        report_sample(s);
+    LWM2M_block2_transfer *transfer = &block2_transfer;
+    if (offset > 0 && transfer->entry == entry && transfer->content_format == content_format 
+        && now - transfer->started_ms < LWM2M_BLOCK2_TIMEOUT_MS){
+        return LWM2M_encode_block(&transfer->encoder, offset, LWM2M_payload, size, more);
     }
-    else{
-        // otherwise, schedule a report for when pmin expires
-        // sample and timestamp would be added to the queue here to be batch reported at pmin
-        // also would need to reset band and floating limits
-        report_scheduled = true;
+
+    int num_records = LWM2M_registry_read(entry, LWM2M_records, LWM2M_PAYLOAD_RECORDS);
+    if (num_records <= 0)
+        return -1;
+    LWM2M_encoder encoder;
+    LWM2M_encoder_init(&encoder, content_format, base_name, LWM2M_records, num_records);
+    int len = LWM2M_encode_block(&encoder, offset, LWM2M_payload, size, more);
+    if (len >= 0 && (*more || offset > 0)){
+        // a new ETag for every copy, the blocks of one copy share it
+        transfer->entry = entry;
+        transfer->content_format = content_format;
+        transfer->started_ms = now;
+        transfer->max_age_ms = LWM2M_response_max_age_ms(entry, now);
+        transfer->serial++;
+        LWM2M_etag(content_format, (const uint8_t *)&transfer->serial, sizeof(transfer->serial), transfer->etag);
+        strcpy(transfer->base_name, base_name);
+        memcpy(transfer->records, LWM2M_records, num_records * sizeof(LWM2M_record));
+        transfer->encoder = encoder;
+        transfer->encoder.base_name = transfer->base_name;
+        transfer->encoder.records = transfer->records;
     }
-    return;
+    return len;
 }
 
-/*
-callback for sensor driver to update the value, e.g. if the sampled value changes
-can be called for every sample acquisition
-this will evaluate the sample against the reporting criteria and schedule a report 
-if a reportable event occurs
+/* 
+Callback for LWM2M (CoAP REST) operations on every registered object, instance 
+and resource, dispatched by the request path through the registry.
+GET on all levels, GET with observe and PUT on observable resources.
 */
-void on_update(sample s)// callback from sensor driver, e.g. on changing value 
+static uint8_t LWM2M_resource_cb(sn_coap_hdr_s *received_coap_ptr, sn_nsdl_addr_s *address, sn_proto_info_s * proto)
 {
-    if (band(s) != last_band || s >= high_step || s <= low_step){ // test limits
-        schedule_report(s);
+    sn_coap_hdr_s *coap_res_ptr = 0;
+    LWM2M_key key;
+    int entry = -1;
+
+    if (LWM2M_key_parse(received_coap_ptr->uri_path_ptr, received_coap_ptr->uri_path_len, &key))
+        entry = LWM2M_registry_find(key);
+    if (entry < 0){
+        LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_NOT_FOUND); // 4.04
+        return 0;
+    }
+    const LWM2M_registry_entry *e = LWM2M_registry_get(entry);
+    bool is_resource = LWM2M_key_level(key) == LWM2M_LEVEL_RESOURCE;
+    int16_t res_index = e->engine_resource; // attribute engine row, -1 if not observable
+
+    if(COAP_MSG_CODE_REQUEST_GET == received_coap_ptr->msg_code){
+        // content-format from the Accept option, text/plain by default for a resource,
+        // senml+json for an object or instance
+        uint16_t default_format = is_resource ? LWM2M_CT_TEXT_PLAIN : LWM2M_CT_SENML_JSON;
+        uint16_t content_format = default_format;
+        bool observe = received_coap_ptr->options_list_ptr && received_coap_ptr->options_list_ptr->observe
+            && is_resource && res_index >= 0 && (e->operations & LWM2M_OP_OBSERVE);
+        if (received_coap_ptr->options_list_ptr){
+            content_format = LWM2M_negotiate_content_format(
+                received_coap_ptr->options_list_ptr->accept_ptr, 
+                received_coap_ptr->options_list_ptr->accept_len, default_format);
+        }
+        // TLV can't be signalled in notifications, see LWM2M_notification_thread,
+        // text/plain only holds a single resource
+        if (content_format == LWM2M_CT_NONE || (observe && content_format == LWM2M_CT_TLV 
+            && START_OBS == *received_coap_ptr->options_list_ptr->observe_ptr)
+            || (!is_resource && content_format == LWM2M_CT_TEXT_PLAIN)){
+            LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_NOT_ACCEPTABLE); // 4.06
+            return 0;
+        }
+
+        // block requested by a Block2 option, else the first block of the largest size.
+        // A larger block than LWM2M_BLOCK_SIZE is sent as smaller blocks from the same offset.
+        LWM2M_block block2 = {0, false, LWM2M_BLOCK_SZX};
+        bool block2_requested = received_coap_ptr->options_list_ptr && received_coap_ptr->options_list_ptr->block2_ptr;
+        if (block2_requested){
+            if (!LWM2M_block_parse(received_coap_ptr->options_list_ptr->block2_ptr, 
+                received_coap_ptr->options_list_ptr->block2_len, &block2)){
+                LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_BAD_OPTION); // 4.02
+                return 0;
+            }
+            if (block2.szx > LWM2M_BLOCK_SZX){
+                block2.num <<= block2.szx - LWM2M_BLOCK_SZX;
+                block2.szx = LWM2M_BLOCK_SZX;
+            }
+        }
+        uint32_t offset = LWM2M_block_offset(&block2);
+
+        // the resource, or the resources below the object or instance
+        char base_name[LWM2M_PATH_SIZE];
+        LWM2M_key_format(is_resource ? LWM2M_make_key(LWM2M_key_object(key), LWM2M_key_instance(key), LWM2M_ID_NONE) : key, 
+            true, base_name);
+        // a response still fresh in the cache is sent again without reading or encoding,
+        // cached responses fit in a block of LWM2M_CACHE_PAYLOAD_SIZE
+        LWM2M_engine_lock.lock();
+        uint32_t now = LWM2M_clock_ms();
+        uint32_t generation = LWM2M_sensor_changes();
+        const LWM2M_cached_response *cached = NULL;
+        if (offset == 0 && LWM2M_block_size(&block2) >= LWM2M_CACHE_PAYLOAD_SIZE)
+            cached = LWM2M_response_cache_find(&response_cache, entry, content_format, generation, now);
+        bool hit = cached != NULL;
+        const uint8_t *payload = hit ? cached->payload : LWM2M_payload;
+        int payload_len = hit ? cached->payload_len : -1;
+        uint32_t max_age_ms = 0;
+        if (!hit){
+            payload_len = LWM2M_encode_response(entry, content_format, base_name, offset, 
+                LWM2M_block_size(&block2), now, &block2.more);
+            if (payload_len >= 0 && offset == 0 && !block2.more){
+                max_age_ms = LWM2M_response_max_age_ms(entry, now);
+                cached = LWM2M_response_cache_store(&response_cache, entry, content_format, generation, now, 
+                    max_age_ms, LWM2M_payload, payload_len);
+            }
+        }
+        // a part of a representation, of the values in block2_transfer
+        bool blockwise = offset > 0 || block2.more;
+        LWM2M_engine_lock.unlock();
+        if (payload_len < 0){
+            LWM2M_log_event(LWM2M_LOG_ENCODE_FAILED, -1, entry, 0, 0);
+            LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_INTERNAL_SERVER_ERROR); // 5.00
+            return 0;
+        }
+        if (blockwise && payload_len == 0){
+            LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_BAD_OPTION); // 4.02, past the end
+            return 0;
+        }
+        if (is_resource && !hit && !blockwise)
+            LWM2M_log_event(LWM2M_LOG_GET, -1, entry, LWM2M_LOG_VALUE, LWM2M_records[0].value);
+        else
+            LWM2M_log_event(LWM2M_LOG_GET, -1, entry, hit ? LWM2M_LOG_CACHED : 0, 0);
+
+        const uint8_t *etag = LWM2M_etag_value;
+        uint32_t max_age = max_age_ms / 1000;
+        if (cached){
+            etag = cached->etag;
+            max_age = LWM2M_response_cache_age(cached, now);
+        }
+        else if (blockwise){
+            etag = block2_transfer.etag;
+            uint32_t elapsed = now - block2_transfer.started_ms;
+            max_age = (elapsed < block2_transfer.max_age_ms) ? (block2_transfer.max_age_ms - elapsed) / 1000 : 0;
+        }
+        else
+            LWM2M_etag(content_format, payload, payload_len, LWM2M_etag_value);
+
+        // the client holds this representation already (RFC 7252 5.10.6.2)
+        bool valid = !observe && !blockwise && received_coap_ptr->options_list_ptr 
+            && received_coap_ptr->options_list_ptr->etag_len == LWM2M_ETAG_LEN
+            && memcmp(received_coap_ptr->options_list_ptr->etag_ptr, etag, LWM2M_ETAG_LEN) == 0;
+
+        coap_res_ptr = LWM2M_build_response(received_coap_ptr, 
+            valid ? COAP_MSG_CODE_RESPONSE_VALID : COAP_MSG_CODE_RESPONSE_CONTENT);
+        if (!coap_res_ptr)
+            return 0; // no reply, the server retries a confirmable request
+
+        if (!valid){
+            coap_res_ptr->payload_len = payload_len;
+            coap_res_ptr->payload_ptr = (uint8_t *)payload;
+        
+            coap_res_ptr->content_type_ptr = LWM2M_content_type;
+            coap_res_ptr->content_type_len = LWM2M_content_format_option(content_format, LWM2M_content_type);
+        }
+        
+        if (LWM2M_response_options(coap_res_ptr)){
+            coap_res_ptr->options_list_ptr->max_age_ptr = LWM2M_max_age_value;
+            coap_res_ptr->options_list_ptr->max_age_len = LWM2M_max_age_option(max_age, LWM2M_max_age_value);
+            coap_res_ptr->options_list_ptr->etag_ptr = (uint8_t *)etag;
+            coap_res_ptr->options_list_ptr->etag_len = LWM2M_ETAG_LEN;
+            if (!valid && (blockwise || block2_requested)){
+                coap_res_ptr->options_list_ptr->block2_ptr = LWM2M_block2_value;
+                coap_res_ptr->options_list_ptr->block2_len = LWM2M_block_option(&block2, LWM2M_block2_value);
+            }
+        }
+
+        if(observe) {
+            // get observe start/stop value from received GET
+            LWM2M_obs_option = * received_coap_ptr->options_list_ptr->observe_ptr;   
+            // start or stop based on option value, observers are told apart by token
+            // ref. draft-ietf-core-observe-16          
+            LWM2M_engine_lock.lock();
+            if (START_OBS == LWM2M_obs_option){
+                // a row only once the response has options to carry Observe, without 
+                // them the server sees a plain GET and the row would be left unused
+                int obs = coap_res_ptr->options_list_ptr ? LWM2M_obs_create(res_index, 
+                    received_coap_ptr->token_ptr, received_coap_ptr->token_len) : -1;
+                if (obs < 0){
+                    if (coap_res_ptr->options_list_ptr)
+                        LWM2M_log_event(LWM2M_LOG_TABLE_FULL, -1, entry, 0, 0);
+                }
+                else{
+                    notify_format[obs] = received_coap_ptr->options_list_ptr->accept_ptr ? 
+                        content_format : LWM2M_CT_NONE;
+                    LWM2M_persist_observe(obs, notify_format[obs]);
+                    coap_res_ptr->options_list_ptr->observe_ptr = &LWM2M_obs_get(obs)->obs_number;
+                    coap_res_ptr->options_list_ptr->observe_len = sizeof(LWM2M_obs_get(obs)->obs_number);
+                    LWM2M_confirm_open(obs, LWM2M_CON_POLICY_DEFAULT, LWM2M_CON_EVERY_DEFAULT);
+                    LWM2M_notification_init(obs);
+                    LWM2M_sensor_resume(res_index);
+                }
+            }
+            else if (STOP_OBS == LWM2M_obs_option){
+                int obs = LWM2M_obs_find(res_index, received_coap_ptr->token_ptr, received_coap_ptr->token_len);
+                if (obs >= 0){
+                    LWM2M_confirm_close(obs);
+                    LWM2M_persist_cancel(obs);
+                }
+                LWM2M_obs_release(obs);
+            }
+            LWM2M_engine_lock.unlock();
+        }
+ 
+        LWM2M_send_response(address, coap_res_ptr);
     }
-    return;
+    
+    /* 
+    PUT needs to be enabled for the write attributes operation which is empty payload + query options
+    */
+    else if(COAP_MSG_CODE_REQUEST_PUT == received_coap_ptr->msg_code){
+        // values and attributes are written to observable resources only
+        if (!is_resource || res_index < 0){
+            LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_METHOD_NOT_ALLOWED); // 4.05
+            return 0;
+        }
+        //pc.printf("PUT: %d bytes\r\n", received_coap_ptr->payload_len);
+        const uint8_t *value_ptr = received_coap_ptr->payload_ptr;
+        uint16_t value_len = received_coap_ptr->payload_len;
+        // a value sent in Block1 blocks is answered 2.31 per block and written after the last
+        LWM2M_block block1;
+        bool block1_requested = received_coap_ptr->options_list_ptr && received_coap_ptr->options_list_ptr->block1_ptr;
+        if (block1_requested){
+            if (!LWM2M_block_parse(received_coap_ptr->options_list_ptr->block1_ptr, 
+                received_coap_ptr->options_list_ptr->block1_len, &block1)){
+                LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_BAD_OPTION); // 4.02
+                return 0;
+            }
+            LWM2M_engine_lock.lock();
+            uint32_t now = LWM2M_clock_ms();
+            LWM2M_engine_lock.unlock();
+            int result = LWM2M_block1_receive(&block1_transfer, entry, &block1, value_ptr, value_len, now);
+            // the next blocks no larger than LWM2M_BLOCK_SIZE (RFC 7959 2.5)
+            if (block1.szx > LWM2M_BLOCK_SZX)
+                block1.szx = LWM2M_BLOCK_SZX;
+            if (result == LWM2M_BLOCK1_CONTINUE){
+                LWM2M_send_block1_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_CONTINUE, &block1); // 2.31
+                return 0;
+            }
+            if (result != LWM2M_BLOCK1_DONE){
+                LWM2M_send_status(received_coap_ptr, address, (result == LWM2M_BLOCK1_TOO_LARGE) ? 
+                    COAP_MSG_CODE_RESPONSE_REQUEST_ENTITY_TOO_LARGE : // 4.13
+                    COAP_MSG_CODE_RESPONSE_REQUEST_ENTITY_INCOMPLETE); // 4.08
+                return 0;
+            }
+            value_ptr = block1_transfer.payload;
+            value_len = block1_transfer.received;
+        }
+        if (value_len >= sizeof(LWM2M_update_string)){
+            LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_REQUEST_ENTITY_TOO_LARGE); // 4.13
+            return 0;
+        }
+        if(value_len > 0){
+            memcpy(LWM2M_update_string, (const char *)value_ptr, value_len);
+            LWM2M_update_string[value_len] = '\0';
+
+            float value;
+            if (sscanf( LWM2M_update_string, "%f3.1", &value) == 1){
+                LWM2M_log_event(LWM2M_LOG_PUT, -1, value_len, LWM2M_LOG_VALUE, value);
+                LWM2M_sensor_push(res_index, value); //update for read-back test, observe will clobber
+                LWM2M_response_cache_clear(&response_cache); // the push is not polled yet
+            }
+            else
+                LWM2M_log_event(LWM2M_LOG_PUT, -1, value_len, 0, 0);
+
+            if (block1_requested)
+                LWM2M_send_block1_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_CHANGED, &block1);
+            else
+                LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_CHANGED);
+        }
+        // see if there are query options and scan for write attributes, allow payload and query options
+        // PUT without query ffrom web client reads some query string, wireshark it...
+        if(received_coap_ptr->options_list_ptr && received_coap_ptr->options_list_ptr->uri_query_ptr != NULL){
+            // parse the query in place, nothing is applied unless the whole query is valid
+            bool cancel;
+            int result = LWM2M_parse_write_attributes(
+                received_coap_ptr->options_list_ptr->uri_query_ptr, 
+                received_coap_ptr->options_list_ptr->uri_query_len, 
+                LWM2M_resource_get_attributes(res_index), &pending_attributes, &cancel);
+            if (result == LWM2M_ATTR_OK){
+                // initializes and sends an update to each observer, don't change observing state
+                // allows cancel to turn off observing and updte state without sending a notification
+                LWM2M_engine_lock.lock();
+                if (cancel){
+                    LWM2M_persist_cancel_resource(res_index);
+                    LWM2M_resource_cancel(res_index);
+                }
+                LWM2M_resource_set_attributes(res_index, &pending_attributes);
+                LWM2M_persist_attributes(res_index);
+                LWM2M_sensor_resume(res_index);
+                LWM2M_engine_lock.unlock();
+                LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_CHANGED); // 2.04
+            }
+            else{
+                // no notification attribute names were found, or the values are invalid
+                LWM2M_log_event(LWM2M_LOG_ATTRIBUTES_ERROR, -1, result, 0, 0);
+                LWM2M_send_status(received_coap_ptr, address, COAP_MSG_CODE_RESPONSE_BAD_REQUEST);// 4.00
+            }
+        }
+    }
+
+    return 0;
 }
 
 /*
-initialize the limits for LWM2M mode and set the state by reporting the first sample
-set LWM2M_observing true or false depending on desired behavior
-if LWM2M_observing is false, the sample won't be transmitted
+build the object tree and register every path of it with nsdl, all paths share
+LWM2M_resource_cb. Further objects are added here with LWM2M_registry_add.
 */
-void LWM2M_notification_init()
+int create_LWM2M_resource(sn_nsdl_resource_info_s *resource_ptr)
 {
-    pc.printf("init\r\n");
-    limits[0] = LWM2M_lt;
-    limits[1] = LWM2M_gt;
-    report_sample(get_sample());
-    return;
+    LWM2M_obs_table_init();
+    char mac[6];
+    mbed_mac_address(mac);
+    LWM2M_pmax_schedule schedule = {LWM2M_PMAX_MODE, LWM2M_PMAX_JITTER_MS, LWM2M_PMAX_PERIOD_MS, 0, 0};
+    if (LWM2M_PMAX_SPREAD)
+        schedule.phase_ms = LWM2M_pmax_device_phase((uint8_t *)mac, sizeof(mac), 
+            LWM2M_PMAX_PERIOD_MS ? LWM2M_PMAX_PERIOD_MS : (uint32_t)(D_PMAX * 1000));
+    LWM2M_obs_set_pmax_schedule(&schedule, 
+        LWM2M_pmax_device_phase((uint8_t *)mac, sizeof(mac), 0xFFFFFFFF) ^ us_ticker_read());
+    LWM2M_notify_queue_init(&notify_queue);
+    LWM2M_confirm_init(LWM2M_clock_ms());
+    LWM2M_coalesce_init(&notify_batch, LWM2M_COALESCE_WINDOW_MS);
+    LWM2M_log_init(&event_log);
+    LWM2M_histogram_reset(&report_latency);
+    LWM2M_histogram_reset(&sample_latency);
+    notify_queue_high = nsdl_failures = 0;
+    LWM2M_registry_init();
+    LWM2M_response_cache_init(&response_cache);
+    LWM2M_block1_init(&block1_transfer);
+    LWM2M_pool_init(&LWM2M_response_pool, LWM2M_response_blocks, sizeof(LWM2M_response_blocks[0]), LWM2M_RESPONSE_POOL_SIZE);
+    LWM2M_pool_init(&LWM2M_options_pool, LWM2M_options_blocks, sizeof(LWM2M_options_blocks[0]), LWM2M_RESPONSE_POOL_SIZE);
+    LWM2M_sensor_register(LWM2M_RES_INDEX, &LWM2M_read_sensor, NULL, LWM2M_SAMPLE_PERIOD_MS);
+    LWM2M_sensor_set_max_period(LWM2M_RES_INDEX, LWM2M_SAMPLE_MAX_PERIOD_MS);
+    LWM2M_registry_add(LWM2M_RES_OBJECT, LWM2M_RES_INSTANCE, LWM2M_RES_NUM, &LWM2M_read_cached, (void *)(intptr_t)LWM2M_RES_INDEX, 
+        LWM2M_RES_INDEX, LWM2M_OP_READ | LWM2M_OP_WRITE | LWM2M_OP_OBSERVE);
+    for (int metric = 0; metric < LWM2M_METRICS; metric++)
+        LWM2M_registry_add(LWM2M_METRICS_OBJECT, LWM2M_METRICS_INSTANCE, metric, &LWM2M_read_metric, 
+            (void *)(intptr_t)metric, -1, LWM2M_OP_READ);
+    // observations and attributes from before a reset, notified without a new observe
+    if (LWM2M_persist_restore() > 0){
+        for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+            LWM2M_observation *o = LWM2M_obs_get(obs);
+            if (!o)
+                continue;
+            notify_format[obs] = LWM2M_persist_tag(obs);
+            LWM2M_confirm_open(obs, LWM2M_CON_POLICY_DEFAULT, LWM2M_CON_EVERY_DEFAULT);
+            LWM2M_notification_init(obs);
+            LWM2M_sensor_resume(o->resource);
+        }
+    }
+    static Thread exec_thread(LWM2M_notification_thread);
+    LWM2M_thread = &exec_thread;
+    static Thread log_thread(LWM2M_log_thread, NULL, osPriorityLow);
+
+    for (int entry = 0; entry < LWM2M_registry_count(); entry++){
+        const LWM2M_registry_entry *e = LWM2M_registry_get(entry);
+        bool observable = (e->operations & LWM2M_OP_OBSERVE) != 0;
+        char path[LWM2M_PATH_SIZE]; // copied by nsdl
+        int path_len = LWM2M_key_format(e->key, false, path);
+        nsdl_create_dynamic_resource(resource_ptr, 
+            path_len, (uint8_t*)path, 
+            sizeof(LWM2M_RES_RT)-1, (uint8_t*)LWM2M_RES_RT, 
+            observable ? OBS_TRUE : OBS_FALSE, &LWM2M_resource_cb, 
+            (e->engine_resource >= 0) ? (SN_GRS_GET_ALLOWED | SN_GRS_PUT_ALLOWED) : SN_GRS_GET_ALLOWED);
+    }
+    return 0;
 }
 
-
+/* 
+The LWM2M Observe attribute state machine and its interpretation of the 
+LWM2M 1.0 Notification attributes are in LWM2M_resource_attributes.cpp
+*/
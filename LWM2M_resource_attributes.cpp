@@ -22,7 +22,8 @@ pmin, pmax, gt, lt, and step
 Functional implementation and interpretation is described in the comments below
  
 Library specific code for handling sensor I/O, CoAP resources, notifications 
-and receiving Write Attributes is removed for clarity
+and receiving Write Attributes is in LWM2M_resource.cpp, this file only holds
+the observation table and the state machine
 
 */
 
@@ -62,171 +63,476 @@ time a notification is sent, a timer is reset, set to expire at pmax seconds
 after the notification was sent. If the pmax timer expires, a notification is sent.
  
 Note: each time a notification is sent, pmin and pmax timers are are restarted.
+
+5. epmin and epmax (LWM2M 1.1) bound the time between two evaluations of an 
+observation, apart from the reporting: a sample that arrives less than epmin 
+after the last evaluation is not evaluated then, the value current at the end 
+of epmin is evaluated instead, and an observation that has gone epmax without 
+an evaluation reads the sensor (get_sample) and evaluates it. With neither set 
+every sample is evaluated as it arrives.
+
+6. statistics, an attribute of this implementation, keeps the minimum, maximum, 
+mean, variance, count and percentiles of the samples since the last 
+notification, to be reported along with the value (see LWM2M_aggregate.h). 
+Excursions between two notifications then reach the server even with a long 
+pmax and no band or step set for them.
+
+7. hysteresis and dwell, attributes of this implementation, keep a signal 
+that hovers at a limit from reporting a band change on every sample: the band 
+of the last report is only left when a sample is more than the hysteresis 
+width past its limit, and, with dwell set, only when the samples stayed out 
+of it for the dwell time. A sample back in the band before that ends the 
+dwell and nothing is reported. Dwell holds back the band change only, a 
+step reached meanwhile is reported.
  
 Implementation Notes:
 
 The algorithm for lt and gt is generalized to accept from one to n limit values, 
 each defining a boundary between n+1 signal bands (states). A transition from any 
-state to any other state will create a reportable event.
-
-The simple implementation below does not capture information about state changes 
-that occur during the quiet period, only that some state transition has occurred, 
-with a reporting of the current value at the end of the quiet period. 
-Implementations MAY capture state transitions which occur during the quiet period 
-and report them at the end of the quiet period along with the current value in a 
-notification object (senml+json or lwm2m format tlv)
- 
-I.e., implementations MAY queue reportable events to be scheduled as a sequence 
-object in the next notification.
+state to any other state will create a reportable event. Write Attributes sets 
+lt and gt; up to MAX_LIMITS limits, e.g. alarm zones of a tank level, can be set 
+by the application with LWM2M_attributes_set_limits.
+
+Reportable events that occur during the quiet period are captured in a bounded 
+per observation queue (time, value and band transition) and reported at the end 
+of the quiet period along with the current value in one notification object 
+(senml+json or lwm2m format tlv). Each captured event re-anchors the band and 
+step limits, so a signal that stays in a new band is queued once, not on every
+sample. If the queue overflows the oldest events are dropped and counted.
 */
 
 
-// data type float - int could be used but just convert/cast
-typedef float sample; 
+#include "LWM2M_resource_attributes.h"
+#include "LWM2M_timer_wheel.h"
+#include <string.h>
+#include <math.h>
+#include <new>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-//algorithm can accept any number of limit values and report when signal changes
-//between limit bands
-#define MAX_LIMITS 2
-static int num_limits = 2;
-static sample limits[MAX_LIMITS];
-static int last_band;
+struct LWM2M_resource_state {
+    LWM2M_attributes attributes; // notification attributes for new observations
+    int16_t first_obs; // list of observations of this resource
+};
+
+// one timer wheel drives pmin, pmax, epmin, epmax and dwell for all observations
+// timer 4*obs is the pmin timer, 4*obs+1 the pmax timer, 4*obs+2 the
+// evaluation timer, for the end of epmin or epmax, and 4*obs+3 the end of a dwell
+#define OBS_TIMERS 4
+#define PMIN_TIMER(obs) (OBS_TIMERS * (obs))
+#define PMAX_TIMER(obs) (OBS_TIMERS * (obs) + 1)
+#define EVAL_TIMER(obs) (OBS_TIMERS * (obs) + 2)
+#define DWELL_TIMER(obs) (OBS_TIMERS * (obs) + 3)
+
+#if LWM2M_MAX_OBSERVATIONS > 32767
+#error "observation rows are linked by int16_t, LWM2M_MAX_OBSERVATIONS is at most 32767"
+#endif
+
+/*
+ the state of one engine, no heap after init
+ */
+struct LWM2M_engine {
+    // observation rows and per resource attributes
+    LWM2M_observation obs_table[LWM2M_MAX_OBSERVATIONS];
 
-// step limit values updated on reporting
-static sample high_step, low_step;
+    // quiet period events, kept apart from obs_table to keep the rows compact
+    LWM2M_quiet_queue quiet_queues[LWM2M_MAX_OBSERVATIONS];
 
-// flag for enabling triggering of immediate notification on reportable event
-bool pmin_exceeded = false;
+    // band limits per observation, sorted and padded to MAX_LIMITS with infinity
+    // so that band() always compares a fixed number of limits
+    sample obs_limits[LWM2M_MAX_OBSERVATIONS][MAX_LIMITS];
+    // hysteresis width per limit, the padding 0
+    sample obs_hysteresis[LWM2M_MAX_OBSERVATIONS][MAX_LIMITS];
 
-// flag for scheduling reporting at the expiration of pmin quiet period
-bool report_scheduled = false;
+    // statistics of the reporting window, for observations with statistics set
+    LWM2M_aggregate obs_aggregates[LWM2M_MAX_OBSERVATIONS];
+#if LWM2M_SKETCH_SIZE
+    LWM2M_sketch obs_sketches[LWM2M_MAX_OBSERVATIONS];
+#endif
 
-// hardware timers for pmin and pmax 
-Ticker pmin_timer, pmax_timer; 
+    LWM2M_resource_state resource_table[LWM2M_MAX_RESOURCES];
 
-// notification attributes and default values from LWM2M_resource.h
-static sample LWM2M_gt = D_GT;
-static sample LWM2M_lt = D_LT;
-static sample LWM2M_step = D_STEP;
-static float LWM2M_pmax = D_PMAX;
-static float LWM2M_pmin = D_PMIN;
+    // list of free rows in obs_table, none until LWM2M_obs_table_init
+    int16_t free_obs = -1;
 
-void LWM2M_notification_init();
-void on_update(sample);
+    LWM2M_timer obs_timers[OBS_TIMERS * LWM2M_MAX_OBSERVATIONS];
+    LWM2M_timer_wheel obs_wheel;
 
-// instrumentation about which condition triggered a notification
-static bool pmax_exceeded = false;
-static bool pmin_trigger = false;
+    // lower bound of every pmin, raised by the sender while the link is congested
+    uint32_t pmin_floor_ms;
+
+    // placement of pmax deadlines, and the state of its jitter
+    LWM2M_pmax_schedule pmax_schedule;
+    uint32_t pmax_random = 1;
+
+    // reports and send failures per observation, its evaluations are in its row
+    LWM2M_obs_counters obs_counters[LWM2M_MAX_OBSERVATIONS];
+    // the sums over all observations, see LWM2M_obs_get_counters
+    LWM2M_obs_counters counters;
+};
+
+// the engine of the calling thread. Thread local where engines are run by
+// several threads, as in the gateway, a plain pointer on the target
+#ifndef LWM2M_ENGINE_LOCAL
+#if defined(__linux__)
+#define LWM2M_ENGINE_LOCAL __thread
+#else
+#define LWM2M_ENGINE_LOCAL
+#endif
+#endif
+static LWM2M_engine default_engine;
+static LWM2M_ENGINE_LOCAL LWM2M_engine *engine = &default_engine;
+
+static void on_obs_timer(int32_t timer, void *context);
+static void window_reset(int obs);
+static void dwell_end(int obs);
+static void evaluate_value(int obs, sample s);
 
 /*
  Functions
  */
 
 /*
- Turn on and off notification based on the latest attributes.
- Update attributes should stop and start to update values
+ Reset the tables, every resource gets the default attributes from 
+ LWM2M_resource.h and no observations
  */
-//notifications on
-void LWM2M_start_notification()
+void LWM2M_obs_table_init(void)
 {
-    LWM2M_observing = true;
-    LWM2M_notification_init();
+    memset(engine->obs_table, 0, sizeof(engine->obs_table));
+    for (int obs = 0; obs < LWM2M_MAX_OBSERVATIONS; obs++){
+        engine->obs_table[obs].next = (obs + 1 < LWM2M_MAX_OBSERVATIONS) ? obs + 1 : -1;
+    }
+    engine->free_obs = 0;
+    memset(&engine->counters, 0, sizeof(engine->counters));
+    engine->pmin_floor_ms = 0;
+    memset(&engine->pmax_schedule, 0, sizeof(engine->pmax_schedule)); // LWM2M_PMAX_EXACT
+    LWM2M_timer_wheel_init(&engine->obs_wheel, engine->obs_timers, OBS_TIMERS * LWM2M_MAX_OBSERVATIONS, 
+        LWM2M_TIMER_TICK_MS, LWM2M_clock_ms(), &on_obs_timer, NULL);
+    for (int res = 0; res < LWM2M_MAX_RESOURCES; res++){
+        engine->resource_table[res].attributes.gt = D_GT;
+        engine->resource_table[res].attributes.lt = D_LT;
+        engine->resource_table[res].attributes.step = D_STEP;
+        engine->resource_table[res].attributes.pmin = D_PMIN;
+        engine->resource_table[res].attributes.pmax = D_PMAX;
+        engine->resource_table[res].attributes.epmin = D_EPMIN;
+        engine->resource_table[res].attributes.epmax = D_EPMAX;
+        engine->resource_table[res].attributes.statistics = D_STATISTICS;
+        engine->resource_table[res].attributes.hysteresis = D_HYST;
+        engine->resource_table[res].attributes.dwell = D_DWELL;
+        engine->resource_table[res].attributes.num_limits = 0;
+        engine->resource_table[res].first_obs = -1;
+    }
 }
-//notifications off
-void LWM2M_stop_notification()
+
+/*
+ find the observation of a resource by observer token, -1 if not found
+ */
+int LWM2M_obs_find(uint16_t resource, const uint8_t *token, uint8_t token_len)
 {
-    LWM2M_observing = false;
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return -1;
+    }
+    for (int obs = engine->resource_table[resource].first_obs; obs >= 0; obs = engine->obs_table[obs].next){
+        if (engine->obs_table[obs].token_len == token_len 
+            && (token_len == 0 || memcmp(engine->obs_table[obs].token, token, token_len) == 0)){
+            return obs;
+        }
+    }
+    return -1;
 }
 
 /*
- examine one query option to see if the tag matches one of the observe 
- attributes if so, set the corresponding attribute pmin, pmax, lt, gt, 
- step and flag pending update
+ add an observation of a resource, or return the existing one for the same token.
+ The attributes are copied from the resource. Returns -1 if the table is full.
  */
-void set_notification_attribute(char* option)
-{
-    char* attribute = strtok(option, "="); // first token
-    char* value = strtok(NULL, "="); // next token
-    
-    pc.printf("Setting: %s = %s\r\n", attribute, value);
-    
-    if (strcmp(attribute, "pmin") == 0){
-        sscanf(value, "%f", &LWM2M_pmin);
-        attribute_update = true;
-        return;
+int LWM2M_obs_create(uint16_t resource, const uint8_t *token, uint8_t token_len)
+{
+    if (resource >= LWM2M_MAX_RESOURCES || token_len > LWM2M_MAX_TOKEN_LEN){
+        return -1;
     }
-    else if(strcmp(attribute, "pmax") == 0){
-        sscanf(value, "%f", &LWM2M_pmax);
-        attribute_update = true;
-        return;
+    int obs = LWM2M_obs_find(resource, token, token_len);
+    if (obs >= 0){
+        return obs;
     }
-    else if(strcmp(attribute, "gt") == 0){
-        sscanf(value, "%f", &LWM2M_gt);
-        attribute_update = true;
-        return;
+    if (engine->free_obs < 0){
+        return -1; // table full
+    }
+    obs = engine->free_obs;
+    LWM2M_observation *o = &engine->obs_table[obs];
+    engine->free_obs = o->next;
+
+    memset(o, 0, sizeof(*o));
+    memset(&engine->quiet_queues[obs], 0, sizeof(engine->quiet_queues[obs]));
+    memset(&engine->obs_counters[obs], 0, sizeof(engine->obs_counters[obs]));
+    window_reset(obs);
+    o->flags = OBS_IN_USE;
+    o->resource = resource;
+    o->token_len = token_len;
+    if (token_len){
+        memcpy(o->token, token, token_len);
     }
-    else if(strcmp(attribute, "lt") == 0){
-        sscanf(value, "%f", &LWM2M_lt);
-        attribute_update = true;
+    o->next = engine->resource_table[resource].first_obs;
+    engine->resource_table[resource].first_obs = obs;
+    LWM2M_obs_set_attributes(obs, &engine->resource_table[resource].attributes);
+    return obs;
+}
+
+/*
+ remove an observation and return the row to the free list
+ */
+void LWM2M_obs_release(int obs)
+{
+    if (obs < 0 || obs >= LWM2M_MAX_OBSERVATIONS || !(engine->obs_table[obs].flags & OBS_IN_USE)){
         return;
     }
-    else if(strcmp(attribute, "st") == 0){
-        sscanf(value, "%f", &LWM2M_step);
-        attribute_update = true;
+    int16_t *link = &engine->resource_table[engine->obs_table[obs].resource].first_obs;
+    while (*link != obs){
+        link = &engine->obs_table[*link].next;
+    }
+    *link = engine->obs_table[obs].next;
+    LWM2M_timer_cancel(&engine->obs_wheel, PMIN_TIMER(obs));
+    LWM2M_timer_cancel(&engine->obs_wheel, PMAX_TIMER(obs));
+    LWM2M_timer_cancel(&engine->obs_wheel, EVAL_TIMER(obs));
+    LWM2M_timer_cancel(&engine->obs_wheel, DWELL_TIMER(obs));
+    engine->obs_table[obs].flags = 0;
+    engine->obs_table[obs].next = engine->free_obs;
+    engine->free_obs = obs;
+}
+
+LWM2M_observation *LWM2M_obs_get(int obs)
+{
+    if (obs < 0 || obs >= LWM2M_MAX_OBSERVATIONS || !(engine->obs_table[obs].flags & OBS_IN_USE)){
+        return NULL;
+    }
+    return &engine->obs_table[obs];
+}
+
+const LWM2M_attributes *LWM2M_resource_get_attributes(uint16_t resource)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return NULL;
+    }
+    return &engine->resource_table[resource].attributes;
+}
+
+/*
+ store new attributes for a resource and apply them to all of its observations,
+ re-initializing each one. Observations are not started or stopped.
+ */
+void LWM2M_resource_set_attributes(uint16_t resource, const LWM2M_attributes *attr)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
         return;
     }
-    else if(strcmp(attribute, "cancel") == 0){
-        LWM2M_stop_notification();
-        attribute_update = true;
+    engine->resource_table[resource].attributes = *attr;
+    for (int obs = engine->resource_table[resource].first_obs; obs >= 0; obs = engine->obs_table[obs].next){
+        LWM2M_obs_set_attributes(obs, attr);
+        LWM2M_notification_init(obs);
+    }
+}
+
+/*
+ cancel all observations of a resource
+ */
+void LWM2M_resource_cancel(uint16_t resource)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
         return;
     }
+    while (engine->resource_table[resource].first_obs >= 0){
+        LWM2M_obs_release(engine->resource_table[resource].first_obs);
+    }
 }
 
-/* 
- Determine which band [0..num_limits] the provided sample is in.
- Works with any number of bands 2 to MAX_LIMITS+1 using an array 
- of limit settings
-*/
-int band(sample s)
+bool LWM2M_attributes_set_limits(LWM2M_attributes *attr, const sample *limits, int num_limits)
+{
+    return LWM2M_attributes_set_limits_hysteresis(attr, limits, NULL, num_limits);
+}
+
+/*
+ sort the limits into attr with their widths, insertion sort as there are only a few
+ */
+bool LWM2M_attributes_set_limits_hysteresis(LWM2M_attributes *attr, const sample *limits, 
+    const sample *widths, int num_limits)
 {
-    if (s > limits[num_limits-1]){
-        return num_limits;
+    if (num_limits < 0 || num_limits > MAX_LIMITS){
+        return false;
+    }
+    for (int i = 0; i < num_limits; i++){
+        int j = i;
+        while (j > 0 && attr->limits[j - 1] > limits[i]){
+            attr->limits[j] = attr->limits[j - 1];
+            attr->limit_hysteresis[j] = attr->limit_hysteresis[j - 1];
+            j--;
+        }
+        attr->limits[j] = limits[i];
+        attr->limit_hysteresis[j] = widths ? widths[i] : 0;
+    }
+    attr->num_limits = (uint8_t)num_limits;
+    return true;
+}
+
+/*
+ seconds to ms, within 0 to LWM2M_MAX_PERIOD_S: a float out of the range of
+ the integer it is converted to is undefined
+ */
+static uint32_t period_ms(float seconds)
+{
+    if (!(seconds > 0)){
+        return 0;
+    }
+    return (uint32_t)(((seconds < LWM2M_MAX_PERIOD_S) ? seconds : LWM2M_MAX_PERIOD_S) * 1000.0f);
+}
+
+/*
+ copy attributes into one observation, takes effect at the next report
+ */
+void LWM2M_obs_set_attributes(int obs, const LWM2M_attributes *attr)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    sample *limits = engine->obs_limits[obs];
+    sample *hysteresis = engine->obs_hysteresis[obs];
+    if (attr->num_limits == 0){
+        o->num_limits = 2;
+        limits[0] = attr->lt;
+        limits[1] = attr->gt;
+        hysteresis[0] = hysteresis[1] = attr->hysteresis;
     }
     else{
-        for ( int limit = 0; limit < num_limits; limit++ ){
-            if (s <= limits[limit]){
-                return limit;
-            }
+        o->num_limits = attr->num_limits;
+        memcpy(limits, attr->limits, attr->num_limits * sizeof(sample));
+        for (int limit = 0; limit < attr->num_limits; limit++){
+            hysteresis[limit] = (attr->limit_hysteresis[limit] > 0) ? attr->limit_hysteresis[limit] : attr->hysteresis;
         }
     }
-    return -1;
+    for (int limit = o->num_limits; limit < MAX_LIMITS; limit++){
+        limits[limit] = HUGE_VALF; // never below a sample
+        hysteresis[limit] = 0;
+    }
+    o->step = attr->step;
+    o->pmin_ms = period_ms(attr->pmin);
+    o->pmax_ms = period_ms(attr->pmax);
+    o->epmin_ms = period_ms(attr->epmin);
+    o->epmax_ms = period_ms(attr->epmax);
+    o->dwell_ms = period_ms(attr->dwell);
+#if LWM2M_SKETCH_SIZE
+    uint8_t statistics = attr->statistics;
+#else
+    uint8_t statistics = attr->statistics & ~LWM2M_STAT_PERCENTILES;
+#endif
+    if (statistics != o->statistics){
+        o->statistics = statistics;
+        window_reset(obs); // nothing kept of what was not asked for
+    }
 }
 
 /*
- trigger the build and sending of coap observe response sends
- current value
+ the reporting window statistics, samples are added to it as they arrive
+ */
+static void window_reset(int obs)
+{
+    LWM2M_aggregate_reset(&engine->obs_aggregates[obs]);
+#if LWM2M_SKETCH_SIZE
+    LWM2M_sketch_reset(&engine->obs_sketches[obs]);
+#endif
+}
+
+static void window_add(int obs, sample s)
+{
+    LWM2M_aggregate_add(&engine->obs_aggregates[obs], s);
+#if LWM2M_SKETCH_SIZE
+    if (engine->obs_table[obs].statistics & LWM2M_STAT_PERCENTILES){
+        LWM2M_sketch_add(&engine->obs_sketches[obs], s);
+    }
+#endif
+}
+
+static void window_add_block(int obs, const sample *samples, int count)
+{
+    LWM2M_aggregate_add_block(&engine->obs_aggregates[obs], samples, count);
+#if LWM2M_SKETCH_SIZE
+    if (engine->obs_table[obs].statistics & LWM2M_STAT_PERCENTILES){
+        for (int i = 0; i < count; i++){
+            LWM2M_sketch_add(&engine->obs_sketches[obs], samples[i]);
+        }
+    }
+#endif
+}
+
+bool LWM2M_obs_statistic(int obs, uint8_t statistic, sample *value)
+{
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    if (!o || !(o->statistics & statistic)){
+        return false;
+    }
+#if LWM2M_SKETCH_SIZE
+    const LWM2M_sketch *sketch = &engine->obs_sketches[obs];
+#else
+    const LWM2M_sketch *sketch = NULL;
+#endif
+    return LWM2M_statistic(&engine->obs_aggregates[obs], sketch, statistic, value);
+}
+
+/* 
+ Determine which band [0..num_limits] the provided sample is in.
+ Works with any number of bands 2 to MAX_LIMITS+1 using an array 
+ of limit settings. The band is the number of limits below the sample, 
+ for sorted limits the same as the first limit >= the sample. Counting 
+ over the padded array has no data dependent branch and vectorizes to 
+ compares and adds.
 */
-bool send_notification(sample s) 
+int band(int obs, sample s)
 {
-    notify_sample = s; // mailbox
-    notification_trigger = true;// trigger notification 
-    return true; // async
+    const sample *limits = engine->obs_limits[obs];
+    int result = 0;
+    for (int limit = 0; limit < MAX_LIMITS; limit++){
+        result += (s > limits[limit]);
+    }
+    return result;
 }
 
-time_t get_current_time()
+/*
+ classify a block of samples, e.g. a burst from a DMA buffer
+ */
+void band_batch(int obs, const sample *samples, int8_t *bands, int count)
 {
-    return time(NULL);
+    const sample *limits = engine->obs_limits[obs];
+    for (int i = 0; i < count; i++){
+        int result = 0;
+        for (int limit = 0; limit < MAX_LIMITS; limit++){
+            result += (samples[i] > limits[limit]);
+        }
+        bands[i] = (int8_t)result;
+    }
 }
 
 /*
-demand sensor read or return last callback update
-*/
-sample get_sample()
+ the edges of the band of the last report, each moved out by the hysteresis 
+ of its limit: a sample s leaves the band if s <= lower or s > upper
+ */
+static void band_edges(int obs, sample *lower, sample *upper)
 {
-    // current_sample is most recent ADC read result within 100 mSec
-    return current_sample;
+    const LWM2M_observation *o = &engine->obs_table[obs];
+    const sample *limits = engine->obs_limits[obs];
+    const sample *hysteresis = engine->obs_hysteresis[obs];
+    *lower = (o->last_band > 0) ? limits[o->last_band - 1] - hysteresis[o->last_band - 1] : -HUGE_VALF;
+    *upper = (o->last_band < MAX_LIMITS) ? limits[o->last_band] + hysteresis[o->last_band] : HUGE_VALF;
 }
 
-int report_sample(sample s);//prototype for forward reference
+/*
+ true if s is out of the band of the last report, band(obs, s) != last_band 
+ when there is no hysteresis. NaN is in band 0.
+ */
+static bool band_left(int obs, sample s)
+{
+    sample lower, upper;
+    if (s != s){
+        return engine->obs_table[obs].last_band != 0;
+    }
+    band_edges(obs, &lower, &upper);
+    return s <= lower || s > upper;
+}
 
 /*
 handler for the pmin timer, called when pmin expires 
@@ -234,16 +540,15 @@ if no reportable events have occurred, set the pmin expired flag
 to inform the report scheduler to report immediately
 If a reportable event has occured, report a new sample
 */
-void on_pmin()
+void on_pmin(int obs)
 {
-    if (report_scheduled){
-        report_scheduled = false;
-        pmin_trigger = true; // diagnostic for state machine visibility
-        report_sample(get_sample());
+    LWM2M_observation *o = &engine->obs_table[obs];
+    if (o->flags & OBS_REPORT_SCHEDULED){
+        o->flags &= ~OBS_REPORT_SCHEDULED;
+        report_sample(obs, get_sample(o->resource), LWM2M_CAUSE_PMIN);
     }
     else{
-        pmin_exceeded = true; // state machine
-        pmin_timer.detach();
+        o->flags |= OBS_PMIN_EXCEEDED; // state machine
     }
     return;
 }
@@ -251,31 +556,91 @@ void on_pmin()
 /*
 handler for pmax timer, report a new sample
 */
-void on_pmax()
+void on_pmax(int obs)
 {
-    report_sample(get_sample());
-    pmax_exceeded = true; // diagnostic state machine, cleared at reporting
+    LWM2M_observation *o = &engine->obs_table[obs];
+    report_sample(obs, get_sample(o->resource), LWM2M_CAUSE_PMAX);
     return;
 }
 
 /*
  for reporting a sample that satisfies the reporting criteria and 
- resetting the state machine
+ resetting the state machine, events queued in the quiet period are 
+ sent along with the sample
 */
-int report_sample(sample s)
-{
-    if(send_notification(s)){  // sends current_sample if observing is on
-        last_band = band(s); // limits state machine
-        high_step = s + LWM2M_step; // reset floating band upper limit defined by step
-        low_step = s - LWM2M_step; // reset floating band lower limit defined by step
-        pmin_timer.detach();
-        pmin_exceeded = false; // state machine to inhibit reporting at intervals < pmin
-        pmin_timer.attach(&on_pmin, LWM2M_pmin);
-        pmax_timer.detach();
-        pmax_timer.attach(&on_pmax, LWM2M_pmax);
+int report_sample(int obs, sample s, uint8_t cause)
+{
+    LWM2M_quiet_queue *queue = &engine->quiet_queues[obs];
+    if (engine->obs_table[obs].statistics && engine->obs_aggregates[obs].count == 0){
+        window_add(obs, s); // no sample since the last notification
+    }
+    if(send_notification(obs, s, cause, queue->count ? queue : NULL)){  // sends current_sample if observing is on
+        LWM2M_observation *o = &engine->obs_table[obs];
+        engine->obs_counters[obs].reports[cause]++;
+        engine->counters.reports[cause]++;
+        if (o->statistics){
+            window_reset(obs);
+        }
+        dwell_end(obs);
+        queue->head = queue->count = 0;
+        queue->dropped = 0;
+        o->last_band = band(obs, s); // limits state machine
+        o->high_step = s + o->step; // reset floating band upper limit defined by step
+        o->low_step = s - o->step; // reset floating band lower limit defined by step
+        o->flags &= ~(OBS_PMIN_EXCEEDED | OBS_REPORT_SCHEDULED); // inhibit reporting at intervals < pmin
+        uint32_t pmin_ms = (o->pmin_ms > engine->pmin_floor_ms) ? o->pmin_ms : engine->pmin_floor_ms;
+        uint32_t now = LWM2M_clock_ms();
+        LWM2M_timer_arm(&engine->obs_wheel, PMIN_TIMER(obs), pmin_ms, now);
+        if (o->pmax_ms){
+            // an early pmax deadline never undercuts pmin
+            uint32_t pmax_ms = LWM2M_pmax_delay(&engine->pmax_schedule, now, o->pmax_ms, &engine->pmax_random);
+            LWM2M_timer_arm(&engine->obs_wheel, PMAX_TIMER(obs), (pmax_ms > pmin_ms) ? pmax_ms : pmin_ms, now);
+        }
+        else{
+            LWM2M_timer_cancel(&engine->obs_wheel, PMAX_TIMER(obs)); // no maximum period
+        }
         return 1;
     }
-    else return 0;
+    else{
+        // not accepted, e.g. the sender queue is full: treat the retry interval as
+        // a quiet period, on_pmin then reports the sample current at that time
+        LWM2M_observation *o = &engine->obs_table[obs];
+        engine->obs_counters[obs].send_failures++;
+        engine->counters.send_failures++;
+        o->flags = (o->flags & ~OBS_PMIN_EXCEEDED) | OBS_REPORT_SCHEDULED;
+        LWM2M_timer_arm(&engine->obs_wheel, PMIN_TIMER(obs), LWM2M_REPORT_RETRY_MS, LWM2M_clock_ms());
+        return 0;
+    }
+}
+
+/*
+ add a reportable event to the quiet period queue, overwriting the oldest when full,
+ and re-anchor the band and step limits at the queued sample
+*/
+static void queue_event(int obs, sample s, uint32_t time_ms)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    LWM2M_quiet_queue *queue = &engine->quiet_queues[obs];
+    LWM2M_quiet_event *event;
+    int8_t to_band = band(obs, s);
+
+    if (queue->count < LWM2M_QUIET_QUEUE_DEPTH){
+        event = &queue->events[(queue->head + queue->count++) % LWM2M_QUIET_QUEUE_DEPTH];
+    }
+    else{
+        event = &queue->events[queue->head];
+        queue->head = (queue->head + 1) % LWM2M_QUIET_QUEUE_DEPTH;
+        queue->dropped++;
+    }
+    event->time_ms = time_ms;
+    event->value = s;
+    event->from_band = o->last_band;
+    event->to_band = to_band;
+
+    o->last_band = to_band;
+    o->high_step = s + o->step;
+    o->low_step = s - o->step;
+    dwell_end(obs);
 }
 
 /*
@@ -284,52 +649,487 @@ int report_sample(sample s)
  later, when the pmin timer expires.
 
  Note that if a reportable event occurs during the pmin "quiet period" and then
- the sample returns to a non-reportable state, the sample will still be reported. T
- his can be used to identify signal excursions within the quiet period that aren't 
- reported otherwise. Implementations MAY queue reportable events to be scheduled 
- as a bulk object notification
+ the sample returns to a non-reportable state, the sample will still be reported, 
+ together with the queued excursions that occurred within the quiet period
 */
-void schedule_report(sample s)
+static void schedule_report_at(int obs, sample s, uint8_t cause, uint32_t time_ms)
 {
-    if (pmin_exceeded){ 
+    LWM2M_observation *o = &engine->obs_table[obs];
+    if (o->flags & OBS_PMIN_EXCEEDED){ 
         // immediate report if pmin is already passed
-        report_sample(s);
+        report_sample(obs, s, cause);
     }
     else{
-        // otherwise, schedule a report for when pmin expires
-        // sample and timestamp would be added to the queue here to be batch reported at pmin
-        // also would need to reset band and floating limits
-        report_scheduled = true;
+        // otherwise, schedule a report for when pmin expires and queue the
+        // sample and timestamp to be batch reported at pmin
+        queue_event(obs, s, time_ms);
+        o->flags |= OBS_REPORT_SCHEDULED;
     }
     return;
 }
 
+void schedule_report(int obs, sample s, uint8_t cause)
+{
+    schedule_report_at(obs, s, cause, LWM2M_clock_ms());
+}
+
+/*
+ an evaluation was made at now, the next one is due by epmax
+ */
+static void evaluated(int obs, uint32_t now)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    o->eval_ms = now;
+    o->flags &= ~OBS_EVAL_PENDING;
+    if (o->epmax_ms){
+        LWM2M_timer_arm(&engine->obs_wheel, EVAL_TIMER(obs), o->epmax_ms, now);
+    }
+    else{
+        LWM2M_timer_cancel(&engine->obs_wheel, EVAL_TIMER(obs));
+    }
+}
+
+/*
+ whether a sample at time_ms is evaluated, for an observation with epmin or 
+ epmax. Within epmin of the last evaluation it is not, the evaluation timer 
+ then evaluates the value current at the end of epmin.
+ */
+static bool evaluation_due(int obs, uint32_t time_ms)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    int32_t since = (int32_t)(time_ms - o->eval_ms);
+    if (since < (int32_t)o->epmin_ms){
+        if (!(o->flags & OBS_EVAL_PENDING)){
+            o->flags |= OBS_EVAL_PENDING;
+            LWM2M_timer_arm(&engine->obs_wheel, EVAL_TIMER(obs), o->epmin_ms - since, time_ms);
+        }
+        return false;
+    }
+    evaluated(obs, time_ms);
+    return true;
+}
+
+/*
+handler for the evaluation timer, at the end of epmin after a sample was held 
+back, or epmax after the last evaluation: evaluate the current value
+*/
+static void on_eval(int obs)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    uint32_t now = LWM2M_clock_ms();
+    o->flags &= ~OBS_EVAL_PENDING;
+    if ((int32_t)(now - o->eval_ms) < (int32_t)o->epmin_ms){
+        evaluation_due(obs, now); // the tick came early, wait out the rest
+        return;
+    }
+    evaluate_value(obs, get_sample(o->resource));
+}
+
+/*
+ whether a sample out of band at time_ms completes the dwell, the first one 
+ starts it and the dwell timer, which evaluates the value current at its end
+ */
+static bool dwelled(int obs, uint32_t time_ms)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    if (!(o->flags & OBS_DWELLING)){
+        o->flags |= OBS_DWELLING;
+        o->dwell_start_ms = time_ms;
+        LWM2M_timer_arm(&engine->obs_wheel, DWELL_TIMER(obs), o->dwell_ms, time_ms);
+        return false;
+    }
+    return (int32_t)(time_ms - o->dwell_start_ms) >= (int32_t)o->dwell_ms;
+}
+
+// back in band or reported, the dwell is over
+static void dwell_end(int obs)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    if (o->flags & OBS_DWELLING){
+        o->flags &= ~OBS_DWELLING;
+        LWM2M_timer_cancel(&engine->obs_wheel, DWELL_TIMER(obs));
+    }
+}
+
+/*
+handler for the dwell timer: evaluate the current value, reported if it is 
+still out of band
+*/
+static void on_dwell(int obs)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    if (!(o->flags & OBS_DWELLING)){
+        return;
+    }
+    uint32_t now = LWM2M_clock_ms();
+    int32_t since = (int32_t)(now - o->dwell_start_ms);
+    if (since < (int32_t)o->dwell_ms){
+        // the tick came early, wait out the rest
+        LWM2M_timer_arm(&engine->obs_wheel, DWELL_TIMER(obs), o->dwell_ms - since, now);
+        return;
+    }
+    evaluate_value(obs, get_sample(o->resource));
+}
+
+/*
+ evaluate a sample taken at time_ms against the band and step limits and 
+ schedule a report if it is reportable, returns 1 if it is. While out of band
+ for less than dwell the band change is not reportable, a step still is.
+ */
+static int evaluate(int obs, sample s, uint32_t time_ms)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    o->evaluations++;
+    engine->counters.evaluations++;
+    if (band_left(obs, s)){ // test limits
+        if (!o->dwell_ms || dwelled(obs, time_ms)){
+            schedule_report_at(obs, s, LWM2M_CAUSE_BAND, time_ms);
+            return 1;
+        }
+    }
+    else{
+        dwell_end(obs);
+    }
+    if (s >= o->high_step || s <= o->low_step){
+        schedule_report_at(obs, s, LWM2M_CAUSE_STEP, time_ms);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+evaluate a value against the reporting criteria and schedule a report if a 
+reportable event occurs, without adding it to the statistics window: the
+evaluation and dwell timers evaluate the current value again, which was 
+added when it was read
+*/
+static void evaluate_value(int obs, sample s)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    if (o->epmin_ms | o->epmax_ms | o->dwell_ms){
+        uint32_t now = LWM2M_clock_ms();
+        if ((o->epmin_ms | o->epmax_ms) && !evaluation_due(obs, now)){
+            return; // held back by epmin
+        }
+        evaluate(obs, s, now);
+        return;
+    }
+    // as evaluate, the clock is only read for a report
+    o->evaluations++;
+    engine->counters.evaluations++;
+    if (band_left(obs, s)){ // test limits
+        schedule_report(obs, s, LWM2M_CAUSE_BAND);
+    }
+    else if (s >= o->high_step || s <= o->low_step){
+        schedule_report(obs, s, LWM2M_CAUSE_STEP);
+    }
+}
+
 /*
 callback for sensor driver to update the value, e.g. if the sampled value changes
 can be called for every sample acquisition
 this will evaluate the sample against the reporting criteria and schedule a report 
 if a reportable event occurs
 */
-void on_update(sample s)// callback from sensor driver, e.g. on changing value 
+void on_update(int obs, sample s)// callback from sensor driver, e.g. on changing value 
 {
-    if (band(s) != last_band || s >= high_step || s <= low_step){ // test limits
-        schedule_report(s);
+    if (engine->obs_table[obs].statistics){
+        window_add(obs, s);
     }
-    return;
+    evaluate_value(obs, s);
+}
+
+/*
+ index of the first sample in [0, count) that on_update would find reportable, 
+ count if none. A sample is reportable if it leaves the last reported band 
+ (lower < s <= upper) or reaches a step limit. NaN is in band 0, so it is 
+ reportable unless that was the last band.
+*/
+static int first_reportable(const sample *samples, int count, sample lower, sample upper, 
+    sample high_step, sample low_step, bool nan_reportable)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    __m256 lower8 = _mm256_set1_ps(lower), upper8 = _mm256_set1_ps(upper);
+    __m256 high8 = _mm256_set1_ps(high_step), low8 = _mm256_set1_ps(low_step);
+    __m256 nan8 = _mm256_castsi256_ps(_mm256_set1_epi32(nan_reportable ? -1 : 0));
+    for (; i + 8 <= count; i += 8){
+        __m256 s8 = _mm256_loadu_ps(&samples[i]);
+        __m256 hit = _mm256_or_ps(
+            _mm256_or_ps(_mm256_cmp_ps(s8, lower8, _CMP_LE_OQ), _mm256_cmp_ps(s8, upper8, _CMP_GT_OQ)),
+            _mm256_or_ps(_mm256_cmp_ps(s8, high8, _CMP_GE_OQ), _mm256_cmp_ps(s8, low8, _CMP_LE_OQ)));
+        hit = _mm256_or_ps(hit, _mm256_and_ps(_mm256_cmp_ps(s8, s8, _CMP_UNORD_Q), nan8));
+        int mask = _mm256_movemask_ps(hit);
+        if (mask){
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    __m128 lower4 = _mm_set1_ps(lower), upper4 = _mm_set1_ps(upper);
+    __m128 high4 = _mm_set1_ps(high_step), low4 = _mm_set1_ps(low_step);
+    __m128 nan4 = _mm_castsi128_ps(_mm_set1_epi32(nan_reportable ? -1 : 0));
+    for (; i + 4 <= count; i += 4){
+        __m128 s4 = _mm_loadu_ps(&samples[i]);
+        __m128 hit = _mm_or_ps(
+            _mm_or_ps(_mm_cmple_ps(s4, lower4), _mm_cmpgt_ps(s4, upper4)),
+            _mm_or_ps(_mm_cmpge_ps(s4, high4), _mm_cmple_ps(s4, low4)));
+        hit = _mm_or_ps(hit, _mm_and_ps(_mm_cmpunord_ps(s4, s4), nan4));
+        int mask = _mm_movemask_ps(hit);
+        if (mask){
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i < count; i++){
+        sample s = samples[i];
+        if (s <= lower || s > upper || s >= high_step || s <= low_step || (s != s && nan_reportable)){
+            return i;
+        }
+    }
+    return count;
+}
+
+/*
+ on_update for a block of samples, e.g. a DMA buffer from a kHz rate sensor.
+ Gives the same reports as calling on_update for each sample: the block is 
+ scanned for the first reportable sample against the current band and step 
+ limits, that sample is scheduled, which re-anchors the limits, and the scan
+ continues after it. timestamps (LWM2M_clock_ms() time) are used for events 
+ queued in the quiet period, NULL uses the current time. The pmin and pmax 
+ timers are not advanced within the block. Returns the number of reportable 
+ samples.
+*/
+int on_update_batch(int obs, const sample *samples, int count, const uint32_t *timestamps)
+{
+    LWM2M_observation *o = &engine->obs_table[obs];
+    int reportable = 0;
+
+    if (o->epmin_ms | o->epmax_ms | o->dwell_ms){
+        // evaluation periods or dwell, each sample is held back or evaluated as by on_update
+        for (int i = 0; i < count; i++){
+            uint32_t time_ms = timestamps ? timestamps[i] : LWM2M_clock_ms();
+            if (o->statistics){
+                window_add(obs, samples[i]);
+            }
+            if ((o->epmin_ms | o->epmax_ms) && !evaluation_due(obs, time_ms)){
+                continue;
+            }
+            reportable += evaluate(obs, samples[i], time_ms);
+        }
+        return reportable;
+    }
+    o->evaluations += count;
+    engine->counters.evaluations += count;
+    for (int i = 0; i < count; ){
+        sample lower, upper;
+        band_edges(obs, &lower, &upper);
+        int start = i;
+        i += first_reportable(&samples[i], count - i, lower, upper, 
+            o->high_step, o->low_step, o->last_band != 0);
+        if (o->statistics){
+            // up to the report, the samples after it go in the next window
+            window_add_block(obs, &samples[start], i - start + (i < count));
+        }
+        if (i == count){
+            break;
+        }
+        uint8_t cause = band_left(obs, samples[i]) ? LWM2M_CAUSE_BAND : LWM2M_CAUSE_STEP;
+        schedule_report_at(obs, samples[i], cause, timestamps ? timestamps[i] : LWM2M_clock_ms());
+        reportable++;
+        i++;
+    }
+    return reportable;
+}
+
+/*
+ evaluate one sample of a resource against each of its observations
+ */
+void LWM2M_resource_update(uint16_t resource, sample s)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return;
+    }
+    for (int obs = engine->resource_table[resource].first_obs; obs >= 0; obs = engine->obs_table[obs].next){
+        on_update(obs, s);
+    }
+}
+
+/*
+ evaluate a block of samples of a resource against each of its observations
+ */
+void LWM2M_resource_update_batch(uint16_t resource, const sample *samples, int count, 
+    const uint32_t *timestamps)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return;
+    }
+    for (int obs = engine->resource_table[resource].first_obs; obs >= 0; obs = engine->obs_table[obs].next){
+        on_update_batch(obs, samples, count, timestamps);
+    }
+}
+
+bool LWM2M_resource_observed(uint16_t resource)
+{
+    return resource < LWM2M_MAX_RESOURCES && engine->resource_table[resource].first_obs >= 0;
+}
+
+/*
+ the distance to the nearest edge of the last reported band (lower < s <= upper)
+ and to the step limits, over all observations of the resource
+ */
+bool LWM2M_resource_margin(uint16_t resource, sample s, uint32_t now, sample *margin, uint32_t *report_in_ms)
+{
+    if (!LWM2M_resource_observed(resource)){
+        return false;
+    }
+    *margin = HUGE_VALF;
+    *report_in_ms = UINT32_MAX;
+    for (int obs = engine->resource_table[resource].first_obs; obs >= 0; obs = engine->obs_table[obs].next){
+        const LWM2M_observation *o = &engine->obs_table[obs];
+        sample lower, upper;
+        band_edges(obs, &lower, &upper);
+        sample edges[4] = {upper - s, s - lower, o->high_step - s, s - o->low_step};
+        for (int edge = 0; edge < 4; edge++){
+            // NaN compares false, a NaN sample needs sampling as much as a reportable one
+            if (!(edges[edge] >= *margin)){
+                *margin = (edges[edge] > 0) ? edges[edge] : 0;
+            }
+        }
+        int32_t timers[4] = {PMAX_TIMER(obs), (o->flags & OBS_REPORT_SCHEDULED) ? PMIN_TIMER(obs) : -1,
+            o->epmax_ms ? EVAL_TIMER(obs) : -1, (o->flags & OBS_DWELLING) ? DWELL_TIMER(obs) : -1};
+        for (int timer = 0; timer < 4; timer++){
+            uint32_t expires_ms;
+            if (timers[timer] >= 0 && LWM2M_timer_expiry(&engine->obs_wheel, timers[timer], &expires_ms)){
+                uint32_t in_ms = ((int32_t)(expires_ms - now) > 0) ? expires_ms - now : 0;
+                *report_in_ms = (in_ms < *report_in_ms) ? in_ms : *report_in_ms;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ nearest end of epmin over the observations of the resource
+ */
+uint32_t LWM2M_resource_hold_ms(uint16_t resource, uint32_t now)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return 0;
+    }
+    uint32_t hold_ms = UINT32_MAX;
+    for (int obs = engine->resource_table[resource].first_obs; obs >= 0; obs = engine->obs_table[obs].next){
+        const LWM2M_observation *o = &engine->obs_table[obs];
+        int32_t left = (int32_t)o->epmin_ms - (int32_t)(now - o->eval_ms);
+        if (left <= 0){
+            return 0;
+        }
+        hold_ms = ((uint32_t)left < hold_ms) ? (uint32_t)left : hold_ms;
+    }
+    return (hold_ms == UINT32_MAX) ? 0 : hold_ms;
+}
+
+/*
+ timer wheel expiry, dispatch to the pmin, pmax or evaluation handler of the observation
+ */
+static void on_obs_timer(int32_t timer, void * /*context*/)
+{
+    switch (timer % OBS_TIMERS){
+    case 0:
+        on_pmin(timer / OBS_TIMERS);
+        break;
+    case 1:
+        on_pmax(timer / OBS_TIMERS);
+        break;
+    case 2:
+        on_eval(timer / OBS_TIMERS);
+        break;
+    default:
+        on_dwell(timer / OBS_TIMERS);
+        break;
+    }
+}
+
+/*
+ single tick source for all observations, replaces a pair of hardware timers
+ per resource. Runs in thread context, so handlers may send directly.
+ */
+void LWM2M_obs_tick(uint32_t now)
+{
+    LWM2M_timer_wheel_advance(&engine->obs_wheel, now);
+}
+
+uint32_t LWM2M_obs_evaluations(void)
+{
+    return engine->counters.evaluations;
+}
+
+bool LWM2M_obs_get_counters(int obs, LWM2M_obs_counters *counters)
+{
+    if (obs == LWM2M_OBS_ALL){
+        *counters = engine->counters;
+        return true;
+    }
+    const LWM2M_observation *o = LWM2M_obs_get(obs);
+    if (!o){
+        return false;
+    }
+    *counters = engine->obs_counters[obs];
+    counters->evaluations = o->evaluations;
+    return true;
+}
+
+bool LWM2M_obs_next_tick(uint32_t *next_ms)
+{
+    return LWM2M_timer_wheel_next(&engine->obs_wheel, next_ms);
+}
+
+/*
+ applies to the pmax deadlines armed from the next report of each observation
+ */
+void LWM2M_obs_set_pmax_schedule(const LWM2M_pmax_schedule *schedule, uint32_t seed)
+{
+    engine->pmax_schedule = *schedule;
+    engine->pmax_random = seed ? seed : 1;
+}
+
+/*
+ takes effect as each observation starts its next quiet period
+ */
+void LWM2M_obs_set_pmin_floor(uint32_t floor_ms)
+{
+    engine->pmin_floor_ms = floor_ms;
 }
 
 /*
 initialize the limits for LWM2M mode and set the state by reporting the first sample
-set LWM2M_observing true or false depending on desired behavior
-if LWM2M_observing is false, the sample won't be transmitted
 */
-void LWM2M_notification_init()
+void LWM2M_notification_init(int obs)
 {
-    pc.printf("init\r\n");
-    limits[0] = LWM2M_lt;
-    limits[1] = LWM2M_gt;
-    report_sample(get_sample());
+    // the first value counts as evaluated, epmin and epmax run from it
+    evaluated(obs, LWM2M_clock_ms());
+    report_sample(obs, get_sample(engine->obs_table[obs].resource), LWM2M_CAUSE_INIT);
     return;
 }
 
+LWM2M_engine *LWM2M_engine_create(void)
+{
+    return new (std::nothrow) LWM2M_engine;
+}
+
+void LWM2M_engine_destroy(LWM2M_engine *e)
+{
+    if (e == engine){
+        engine = &default_engine;
+    }
+    delete e;
+}
 
+void LWM2M_engine_select(LWM2M_engine *e)
+{
+    engine = e ? e : &default_engine;
+}
+
+LWM2M_engine *LWM2M_engine_selected(void)
+{
+    return engine;
+}
@@ -0,0 +1,334 @@
+/*
+LWM2M notification attribute engine
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Observation table for the LWM2M Write Attributes state machine.
+
+Every (resource, observer) pair is one row in a fixed size, contiguous table.
+band, on_update, schedule_report and report_sample work on a row index, so
+any number of resources, each with several observers holding their own
+attributes, can be evaluated without heap allocation after start up.
+
+The tables and the timer wheel make up an engine. A device has the one
+engine there is from the start. A gateway runs one engine per shard (see
+LWM2M_gateway.h): each thread selects the engine it works on, and all of
+the functions below act on the engine selected by the calling thread.
+
+The engine does no I/O. The platform supplies the hooks at the bottom of
+this file (sensor value, clock and notification transport).
+*/
+
+#ifndef LWM2M_RESOURCE_ATTRIBUTES_H
+#define LWM2M_RESOURCE_ATTRIBUTES_H
+
+#include <stdint.h>
+#include "LWM2M_pmax_schedule.h"
+#include "LWM2M_aggregate.h"
+
+// table sizes, override at compile time for the target
+#ifndef LWM2M_MAX_OBSERVATIONS
+#define LWM2M_MAX_OBSERVATIONS 64
+#endif
+#ifndef LWM2M_MAX_RESOURCES
+#define LWM2M_MAX_RESOURCES 16
+#endif
+// pmin and pmax resolution
+#ifndef LWM2M_TIMER_TICK_MS
+#define LWM2M_TIMER_TICK_MS 10
+#endif
+// retry interval for a notification that could not be handed to the sender
+#ifndef LWM2M_REPORT_RETRY_MS
+#define LWM2M_REPORT_RETRY_MS 1000
+#endif
+
+// reportable events kept per observation during the pmin quiet period
+#ifndef LWM2M_QUIET_QUEUE_DEPTH
+#define LWM2M_QUIET_QUEUE_DEPTH 4
+#endif
+
+// CoAP tokens are at most 8 bytes, so they are stored inline in the row
+#define LWM2M_MAX_TOKEN_LEN 8
+
+//algorithm can accept any number of limit values and report when signal changes
+//between limit bands. lt and gt are 2 limits, an application can set up to
+//MAX_LIMITS, keep it a multiple of 4 so the band lookup vectorizes
+#ifndef MAX_LIMITS
+#define MAX_LIMITS 8
+#endif
+
+// default notification attributes, normally provided by LWM2M_resource.h
+#ifndef D_GT
+#define D_GT 75.0f
+#endif
+#ifndef D_LT
+#define D_LT 25.0f
+#endif
+#ifndef D_STEP
+#define D_STEP 10.0f
+#endif
+#ifndef D_PMIN
+#define D_PMIN 10.0f
+#endif
+#ifndef D_PMAX
+#define D_PMAX 60.0f
+#endif
+#ifndef D_EPMIN
+#define D_EPMIN 0.0f
+#endif
+#ifndef D_EPMAX
+#define D_EPMAX 0.0f
+#endif
+#ifndef D_STATISTICS
+#define D_STATISTICS 0
+#endif
+#ifndef D_HYST
+#define D_HYST 0.0f
+#endif
+#ifndef D_DWELL
+#define D_DWELL 0.0f
+#endif
+
+// data type float - int could be used but just convert/cast
+typedef float sample;
+
+// longest pmin, pmax, epmin, epmax and dwell in seconds, so that in ms they
+// fit the signed 32 bit differences the clock is compared with
+#define LWM2M_MAX_PERIOD_S (INT32_MAX / 1000)
+
+// notification attributes as written by the LWM2M Write Attributes operation
+struct LWM2M_attributes {
+    sample gt;
+    sample lt;
+    sample step;
+    float pmin; // seconds
+    float pmax; // seconds, 0 = no maximum period
+    float epmin; // evaluation periods (LWM2M 1.1), seconds, 0 = not set
+    float epmax;
+    // LWM2M_STAT_* of the samples since the last notification, reported 
+    // along with the value, 0 = none
+    uint8_t statistics;
+    // how far a sample has to go past a limit to leave the band of the last 
+    // report, 0 = any distance
+    sample hysteresis;
+    // seconds a sample has to stay out of the band of the last report before 
+    // the band change is reported, 0 = at once
+    float dwell;
+    // band limits set by the application, 0 = the limits are lt and gt.
+    // Writing lt or gt with Write Attributes returns to lt and gt.
+    uint8_t num_limits;
+    sample limits[MAX_LIMITS];
+    sample limit_hysteresis[MAX_LIMITS]; // per limit, 0 = hysteresis
+};
+
+// set the band limits of attr, in any order, false if there are more than MAX_LIMITS
+bool LWM2M_attributes_set_limits(LWM2M_attributes *attr, const sample *limits, int num_limits);
+
+// the same with a hysteresis width per limit, widths may be NULL
+bool LWM2M_attributes_set_limits_hysteresis(LWM2M_attributes *attr, const sample *limits, 
+    const sample *widths, int num_limits);
+
+// observation row flags
+#define OBS_IN_USE            0x01
+#define OBS_PMIN_EXCEEDED     0x02 // enables immediate notification on reportable event
+#define OBS_REPORT_SCHEDULED  0x04 // report at the expiration of pmin quiet period
+#define OBS_EVAL_PENDING      0x08 // a sample arrived within epmin, evaluate at its end
+#define OBS_DWELLING          0x10 // out of the band of the last report since dwell_start_ms
+
+// condition that triggered a notification
+#define LWM2M_CAUSE_INIT      0 // observation started or attributes written
+#define LWM2M_CAUSE_STEP      1 // step change, reported at once
+#define LWM2M_CAUSE_BAND      2 // band change, reported at once
+#define LWM2M_CAUSE_PMIN      3 // report scheduled in the quiet period, sent when pmin expired
+#define LWM2M_CAUSE_PMAX      4 // pmax expired
+#define LWM2M_CAUSES          5 // number of the above
+
+/*
+One observation, ordered so that the fields read by on_update come first
+*/
+struct LWM2M_observation {
+    sample high_step, low_step; // step limit values updated on reporting
+    sample step;
+    uint32_t epmin_ms, epmax_ms; // evaluation periods, 0 = not set
+    uint32_t eval_ms; // LWM2M_clock_ms() of the last evaluation
+    uint32_t dwell_ms; // time out of band before a band change is reported, 0 = at once
+    uint32_t dwell_start_ms;
+    uint32_t evaluations; // samples evaluated, see LWM2M_obs_get_counters
+    uint32_t pmin_ms, pmax_ms;
+    int16_t next; // next observation of the same resource, or next free row
+    uint16_t resource;
+    int8_t num_limits;
+    int8_t last_band;
+    uint8_t flags;
+    uint8_t statistics; // LWM2M_STAT_* kept for the reporting window
+    uint8_t obs_number; // CoAP observe sequence number
+    uint8_t token_len;
+    uint8_t token[LWM2M_MAX_TOKEN_LEN];
+};
+
+/*
+A reportable event captured during the pmin quiet period
+*/
+struct LWM2M_quiet_event {
+    uint32_t time_ms; // LWM2M_clock_ms() when the event was evaluated
+    sample value;
+    int8_t from_band, to_band; // equal if the event was a step change
+};
+
+/*
+Ring buffer of quiet period events, flushed with the notification at the end
+of the quiet period. When full the oldest event is overwritten and counted in 
+dropped, so memory per observation is bounded by sizeof(LWM2M_quiet_queue),
+12 * LWM2M_QUIET_QUEUE_DEPTH + 4 bytes.
+*/
+struct LWM2M_quiet_queue {
+    LWM2M_quiet_event events[LWM2M_QUIET_QUEUE_DEPTH];
+    uint8_t head; // oldest event
+    uint8_t count;
+    uint16_t dropped;
+};
+
+// i-th oldest queued event
+inline const LWM2M_quiet_event *LWM2M_quiet_event_at(const LWM2M_quiet_queue *queue, uint8_t i)
+{
+    return &queue->events[(queue->head + i) % LWM2M_QUIET_QUEUE_DEPTH];
+}
+
+/*
+What an observation did since it was created, or all of an engine did since
+LWM2M_obs_table_init, each counter incremented where it happens
+*/
+struct LWM2M_obs_counters {
+    uint32_t evaluations; // samples evaluated against the notification criteria
+    uint32_t reports[LWM2M_CAUSES]; // notifications send_notification accepted, by cause
+    uint32_t send_failures; // notifications send_notification did not accept, retried later
+};
+
+/*
+Table management
+*/
+void LWM2M_obs_table_init(void);
+int LWM2M_obs_create(uint16_t resource, const uint8_t *token, uint8_t token_len);
+int LWM2M_obs_find(uint16_t resource, const uint8_t *token, uint8_t token_len);
+void LWM2M_obs_release(int obs);
+LWM2M_observation *LWM2M_obs_get(int obs);
+
+/*
+Attributes, per resource (used for new observations) and per observation
+*/
+const LWM2M_attributes *LWM2M_resource_get_attributes(uint16_t resource);
+void LWM2M_resource_set_attributes(uint16_t resource, const LWM2M_attributes *attr);
+void LWM2M_resource_cancel(uint16_t resource);
+void LWM2M_obs_set_attributes(int obs, const LWM2M_attributes *attr);
+
+/*
+State machine
+*/
+void LWM2M_notification_init(int obs);
+int band(int obs, sample s);
+void band_batch(int obs, const sample *samples, int8_t *bands, int count);
+void on_update(int obs, sample s);
+int on_update_batch(int obs, const sample *samples, int count, const uint32_t *timestamps);
+void schedule_report(int obs, sample s, uint8_t cause);
+int report_sample(int obs, sample s, uint8_t cause);
+void on_pmin(int obs);
+void on_pmax(int obs);
+
+// evaluate a new sample for every observation of a resource
+void LWM2M_resource_update(uint16_t resource, sample s);
+void LWM2M_resource_update_batch(uint16_t resource, const sample *samples, int count, 
+    const uint32_t *timestamps);
+
+/*
+a statistic (LWM2M_STAT_*) of the samples obs evaluated or held back since 
+its last notification, for send_notification to report along with the 
+value. The window restarts when send_notification accepts a notification, 
+a window without samples holds the reported value. false if the statistic 
+is not kept for obs.
+*/
+bool LWM2M_obs_statistic(int obs, uint8_t statistic, sample *value);
+
+// true if the resource has at least one observation
+bool LWM2M_resource_observed(uint16_t resource);
+
+/*
+time from now until an observation of the resource evaluates a new sample,
+0 if one would evaluate it now. A sensor read before then is not evaluated
+by any of them (epmin).
+*/
+uint32_t LWM2M_resource_hold_ms(uint16_t resource, uint32_t now);
+
+/*
+what the sampling of a resource has to catch, for planning when to read it.
+margin is how far s is from a band or step change that any observation of
+the resource would report, 0 if s already is one, HUGE_VALF if no change is
+reportable. report_in_ms is the time from now until the next timer report
+(pmax, pmin with a report scheduled, epmax, or the end of a dwell) calls get_sample, UINT32_MAX
+if none.
+false if the resource is not observed.
+*/
+bool LWM2M_resource_margin(uint16_t resource, sample s, uint32_t now, sample *margin, uint32_t *report_in_ms);
+
+// run expired pmin, pmax, evaluation and dwell timers up to now (LWM2M_clock_ms() time)
+void LWM2M_obs_tick(uint32_t now);
+
+// samples evaluated against the notification criteria since LWM2M_obs_table_init,
+// counted once per observation
+uint32_t LWM2M_obs_evaluations(void);
+
+/*
+counters of obs, or of the engine for LWM2M_OBS_ALL, those of released 
+observations included. false if obs is not in use.
+*/
+#define LWM2M_OBS_ALL -1
+bool LWM2M_obs_get_counters(int obs, LWM2M_obs_counters *counters);
+
+// when LWM2M_obs_tick next has work, false if no observation is active
+bool LWM2M_obs_next_tick(uint32_t *next_ms);
+
+// minimum pmin of all observations, for congestion control, 0 = none
+void LWM2M_obs_set_pmin_floor(uint32_t floor_ms);
+
+// placement of pmax deadlines, LWM2M_PMAX_EXACT after LWM2M_obs_table_init.
+// seed starts the jitter of LWM2M_PMAX_JITTER, differently on each device
+void LWM2M_obs_set_pmax_schedule(const LWM2M_pmax_schedule *schedule, uint32_t seed);
+
+/*
+Engines, every function above acts on the engine selected by the calling
+thread, the default engine unless another one was selected
+*/
+struct LWM2M_engine;
+
+// allocate another engine at start up, NULL if out of memory. Select it and
+// call LWM2M_obs_table_init before use.
+LWM2M_engine *LWM2M_engine_create(void);
+void LWM2M_engine_destroy(LWM2M_engine *engine);
+
+// NULL selects the default engine
+void LWM2M_engine_select(LWM2M_engine *engine);
+LWM2M_engine *LWM2M_engine_selected(void);
+
+/*
+Platform hooks
+*/
+// events is NULL or holds the quiet period events to send along with s,
+// it is only valid for the duration of the call. Returning false leaves the
+// observation state unchanged and retries after LWM2M_REPORT_RETRY_MS.
+bool send_notification(int obs, sample s, uint8_t cause, const LWM2M_quiet_queue *events);
+sample get_sample(uint16_t resource);
+uint32_t LWM2M_clock_ms(void);
+
+#endif // LWM2M_RESOURCE_ATTRIBUTES_H
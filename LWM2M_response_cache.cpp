@@ -0,0 +1,120 @@
+/*
+LWM2M response cache
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_response_cache.h"
+#include <string.h>
+
+static bool fresh(const LWM2M_cached_response *response, uint32_t generation, uint32_t now)
+{
+    return response->entry >= 0 && response->generation == generation
+        && now - response->stored_ms < response->max_age_ms;
+}
+
+void LWM2M_response_cache_init(LWM2M_response_cache *cache)
+{
+    LWM2M_response_cache_clear(cache);
+    cache->hits = cache->misses = 0;
+}
+
+const LWM2M_cached_response *LWM2M_response_cache_find(LWM2M_response_cache *cache, int entry,
+    uint16_t content_format, uint32_t generation, uint32_t now)
+{
+    for (int i = 0; i < LWM2M_RESPONSE_CACHE_SIZE; i++){
+        const LWM2M_cached_response *response = &cache->responses[i];
+        if (response->entry == entry && response->content_format == content_format
+            && fresh(response, generation, now)){
+            cache->hits++;
+            return response;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+const LWM2M_cached_response *LWM2M_response_cache_store(LWM2M_response_cache *cache, int entry,
+    uint16_t content_format, uint32_t generation, uint32_t now, uint32_t max_age_ms,
+    const uint8_t *payload, uint16_t payload_len)
+{
+    if (payload_len > LWM2M_CACHE_PAYLOAD_SIZE || max_age_ms == 0){
+        return NULL;
+    }
+    // the same key, else a response that is no longer fresh, else the oldest
+    LWM2M_cached_response *slot = NULL;
+    for (int i = 0; i < LWM2M_RESPONSE_CACHE_SIZE; i++){
+        LWM2M_cached_response *response = &cache->responses[i];
+        if (response->entry == entry && response->content_format == content_format){
+            slot = response;
+            break;
+        }
+        if (!slot || (fresh(slot, generation, now)
+            && (!fresh(response, generation, now) || (int32_t)(response->stored_ms - slot->stored_ms) < 0))){
+            slot = response;
+        }
+    }
+    slot->entry = (int16_t)entry;
+    slot->content_format = content_format;
+    slot->generation = generation;
+    slot->stored_ms = now;
+    slot->max_age_ms = max_age_ms;
+    slot->payload_len = payload_len;
+    memcpy(slot->payload, payload, payload_len);
+    LWM2M_etag(content_format, payload, payload_len, slot->etag);
+    return slot;
+}
+
+void LWM2M_response_cache_clear(LWM2M_response_cache *cache)
+{
+    for (int i = 0; i < LWM2M_RESPONSE_CACHE_SIZE; i++){
+        cache->responses[i].entry = -1;
+    }
+}
+
+/*
+FNV-1a, a different format of the same values is a different representation
+*/
+void LWM2M_etag(uint16_t content_format, const uint8_t *payload, uint16_t payload_len, uint8_t *etag)
+{
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (content_format >> 8)) * 16777619u;
+    hash = (hash ^ (content_format & 0xFF)) * 16777619u;
+    for (uint16_t i = 0; i < payload_len; i++){
+        hash = (hash ^ payload[i]) * 16777619u;
+    }
+    for (int i = 0; i < LWM2M_ETAG_LEN; i++){
+        etag[i] = (uint8_t)(hash >> (8 * (LWM2M_ETAG_LEN - 1 - i)));
+    }
+}
+
+uint32_t LWM2M_response_cache_age(const LWM2M_cached_response *response, uint32_t now)
+{
+    uint32_t elapsed = now - response->stored_ms;
+    return (elapsed < response->max_age_ms) ? (response->max_age_ms - elapsed) / 1000 : 0;
+}
+
+uint8_t LWM2M_max_age_option(uint32_t seconds, uint8_t *buf)
+{
+    uint8_t len = 1;
+    while (len < 4 && (seconds >> (8 * len))){
+        len++;
+    }
+    for (uint8_t i = 0; i < len; i++){
+        buf[i] = (uint8_t)(seconds >> (8 * (len - 1 - i)));
+    }
+    return len;
+}
@@ -0,0 +1,92 @@
+/*
+LWM2M response cache
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Encoded GET responses kept per registry entry and content-format, so that
+repeated reads, e.g. a management dashboard polling, are answered without
+reading the sensors or running the encoder again.
+
+A response is fresh for the max_age_ms it was stored with, and only while
+the generation it was stored with is current: the caller passes a counter
+that moves whenever a value it may contain changes (LWM2M_sensor_changes),
+so a cached payload never holds a value older than the latest one sampled.
+
+Every response carries a 4 byte ETag, a hash of its content-format and
+payload. A GET with a matching ETag option is answered 2.03 Valid without
+a payload (RFC 7252 5.10.6.2).
+
+The cache has no locking, it is used from the CoAP callback only.
+*/
+
+#ifndef LWM2M_RESPONSE_CACHE_H
+#define LWM2M_RESPONSE_CACHE_H
+
+#include <stdint.h>
+
+// responses kept, replaced oldest first
+#ifndef LWM2M_RESPONSE_CACHE_SIZE
+#define LWM2M_RESPONSE_CACHE_SIZE 4
+#endif
+// largest payload kept, larger responses get an ETag but are not cached
+#ifndef LWM2M_CACHE_PAYLOAD_SIZE
+#define LWM2M_CACHE_PAYLOAD_SIZE 128
+#endif
+
+#define LWM2M_ETAG_LEN 4
+
+struct LWM2M_cached_response {
+    int16_t entry; // registry entry, -1 = unused
+    uint16_t content_format;
+    uint32_t generation;
+    uint32_t stored_ms, max_age_ms;
+    uint8_t etag[LWM2M_ETAG_LEN];
+    uint16_t payload_len;
+    uint8_t payload[LWM2M_CACHE_PAYLOAD_SIZE];
+};
+
+struct LWM2M_response_cache {
+    LWM2M_cached_response responses[LWM2M_RESPONSE_CACHE_SIZE];
+    uint32_t hits, misses;
+};
+
+void LWM2M_response_cache_init(LWM2M_response_cache *cache);
+
+// fresh response for an entry and content-format, NULL if none
+const LWM2M_cached_response *LWM2M_response_cache_find(LWM2M_response_cache *cache, int entry,
+    uint16_t content_format, uint32_t generation, uint32_t now);
+
+/*
+keep a response encoded at now, fresh for max_age_ms. NULL if the payload
+is larger than LWM2M_CACHE_PAYLOAD_SIZE or max_age_ms is 0.
+*/
+const LWM2M_cached_response *LWM2M_response_cache_store(LWM2M_response_cache *cache, int entry,
+    uint16_t content_format, uint32_t generation, uint32_t now, uint32_t max_age_ms,
+    const uint8_t *payload, uint16_t payload_len);
+
+// drop every response, e.g. after a write
+void LWM2M_response_cache_clear(LWM2M_response_cache *cache);
+
+// ETag option value of a payload
+void LWM2M_etag(uint16_t content_format, const uint8_t *payload, uint16_t payload_len, uint8_t *etag);
+
+// seconds a cached response stays fresh from now, for the Max-Age option
+uint32_t LWM2M_response_cache_age(const LWM2M_cached_response *response, uint32_t now);
+
+// Max-Age option value, 1 to 4 bytes, returns the length
+uint8_t LWM2M_max_age_option(uint32_t seconds, uint8_t *buf);
+
+#endif // LWM2M_RESPONSE_CACHE_H
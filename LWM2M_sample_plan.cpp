@@ -0,0 +1,82 @@
+/*
+LWM2M sample planning
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_sample_plan.h"
+#include <math.h>
+
+void LWM2M_plan_init(LWM2M_sample_plan *plan, uint32_t min_period_ms, uint32_t max_period_ms)
+{
+    plan->min_period_ms = min_period_ms;
+    plan->max_period_ms = (max_period_ms > min_period_ms) ? max_period_ms : min_period_ms;
+    plan->delay_ms = min_period_ms;
+    plan->last_ms = 0;
+    plan->last_value = 0;
+    plan->slope = 0;
+    plan->primed = false;
+}
+
+void LWM2M_plan_sample(LWM2M_sample_plan *plan, sample s, uint32_t now)
+{
+    if (s != s){
+        return; // NaN carries no rate
+    }
+    uint32_t dt = now - plan->last_ms;
+    if (plan->primed && dt > 0){
+        float rate = fabsf(s - plan->last_value) / dt;
+        if (rate >= plan->slope){
+            plan->slope = rate;
+        }
+        else{
+            plan->slope -= (plan->slope - rate) * dt / (dt + LWM2M_PLAN_SLOPE_DECAY_MS);
+        }
+    }
+    plan->last_value = s;
+    plan->last_ms = now;
+    plan->primed = true;
+}
+
+uint32_t LWM2M_plan_delay(LWM2M_sample_plan *plan, sample margin, uint32_t report_in_ms)
+{
+    uint32_t delay = plan->max_period_ms;
+
+    if (margin < HUGE_VALF){
+        if (!plan->primed || !(margin > 0)){
+            delay = plan->min_period_ms; // no rate yet, or any change is reportable
+        }
+        else if (plan->slope > 0){
+            float time_ms = margin / (plan->slope * LWM2M_PLAN_SAFETY);
+            if (time_ms < delay){
+                delay = (uint32_t)time_ms;
+            }
+        }
+        if (delay / 2 > plan->delay_ms){
+            delay = 2 * plan->delay_ms;
+        }
+    }
+    if (delay < plan->min_period_ms){
+        delay = plan->min_period_ms;
+    }
+    plan->delay_ms = delay;
+
+    // the report reads the sensor, look again once it is sent
+    if (report_in_ms < delay){
+        return report_in_ms + plan->min_period_ms;
+    }
+    return delay;
+}
@@ -0,0 +1,71 @@
+/*
+LWM2M sample planning
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+When a sensor needs to be read again, from what the notification
+attributes of its observations can still report.
+
+After each read the planner keeps an estimate of how fast the signal moves,
+taking a faster rate at once and letting a slower one in gradually. The
+next read is due when the signal could have covered the margin to the
+nearest band or step edge (LWM2M_resource_margin) at LWM2M_PLAN_SAFETY
+times that rate, between min_period_ms and max_period_ms. The delay grows
+by at most a factor of 2 per read, so a signal that has been still is not
+left unwatched for max_period_ms at once.
+
+A pmax or pmin report reads the sensor itself through get_sample, so a
+read that would fall after the next report is left to the report, and the
+planner only looks again just after it. With pmin and pmax alone (no band
+or step change reportable) that is one read per pmax.
+*/
+
+#ifndef LWM2M_SAMPLE_PLAN_H
+#define LWM2M_SAMPLE_PLAN_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// rate of change assumed above the estimate
+#ifndef LWM2M_PLAN_SAFETY
+#define LWM2M_PLAN_SAFETY 2.0f
+#endif
+// time for the estimate to settle on a slower rate
+#ifndef LWM2M_PLAN_SLOPE_DECAY_MS
+#define LWM2M_PLAN_SLOPE_DECAY_MS 30000
+#endif
+
+struct LWM2M_sample_plan {
+    uint32_t min_period_ms, max_period_ms;
+    uint32_t delay_ms; // last planned delay
+    uint32_t last_ms; // time of the last read
+    sample last_value;
+    float slope; // estimated rate of change, units per ms
+    bool primed; // last_value is set
+};
+
+void LWM2M_plan_init(LWM2M_sample_plan *plan, uint32_t min_period_ms, uint32_t max_period_ms);
+
+// the sensor was read
+void LWM2M_plan_sample(LWM2M_sample_plan *plan, sample s, uint32_t now);
+
+/*
+delay from now to the next read, given the margin and report_in_ms of
+LWM2M_resource_margin for the latest value
+*/
+uint32_t LWM2M_plan_delay(LWM2M_sample_plan *plan, sample margin, uint32_t report_in_ms);
+
+#endif // LWM2M_SAMPLE_PLAN_H
@@ -0,0 +1,265 @@
+/*
+LWM2M sensor sources
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_sensor.h"
+#include "LWM2M_sample_plan.h"
+#include "LWM2M_timer_wheel.h"
+#include <stddef.h>
+
+struct LWM2M_sensor_source {
+    LWM2M_sensor_read read; // NULL if no sensor is registered
+    void *context;
+    uint32_t period_ms;
+    uint32_t read_ms; // LWM2M_clock_ms() of the last read
+    uint16_t reads; // counts reads, a change since planned_reads means a report read it
+    uint16_t planned_reads;
+    sample value; // latest value, reported by get_sample
+    volatile sample pushed_value; // written by LWM2M_sensor_push
+    volatile bool pushed; // set after pushed_value
+    LWM2M_sample_plan plan; // planned sampling if plan.max_period_ms > period_ms
+};
+
+static LWM2M_sensor_source sensors[LWM2M_MAX_RESOURCES];
+
+// sampling timers, timer n samples resource n
+static LWM2M_timer sample_timers[LWM2M_MAX_RESOURCES];
+static LWM2M_timer_wheel sample_wheel;
+static bool sample_wheel_ready = false;
+
+// set by a push, checked before scanning the sources
+static volatile bool push_pending = false;
+
+// changes of any value, see LWM2M_sensor_changes
+static volatile uint32_t value_changes = 0;
+
+/*
+evaluate a new value, on_update only runs when the value changes
+*/
+static void sensor_update(uint16_t resource, sample value)
+{
+    if (value != sensors[resource].value){
+        sensors[resource].value = value;
+        value_changes++;
+        LWM2M_resource_update(resource, value);
+    }
+}
+
+static bool planned(const LWM2M_sensor_source *sensor)
+{
+    return sensor->plan.max_period_ms > sensor->period_ms;
+}
+
+static sample read_sensor(uint16_t resource, uint32_t now)
+{
+    LWM2M_sensor_source *sensor = &sensors[resource];
+    sample value = sensor->read(sensor->context);
+    sensor->read_ms = now;
+    sensor->reads++;
+    LWM2M_plan_sample(&sensor->plan, value, now);
+    return value;
+}
+
+/*
+arm the sampling timer for the next read the observations need
+*/
+static void plan_next(uint16_t resource, uint32_t now)
+{
+    sample margin;
+    uint32_t report_in_ms;
+    if (LWM2M_resource_margin(resource, LWM2M_sensor_value(resource), now, &margin, &report_in_ms)){
+        sensors[resource].planned_reads = sensors[resource].reads;
+        LWM2M_timer_arm(&sample_wheel, resource, LWM2M_plan_delay(&sensors[resource].plan, margin, report_in_ms), now);
+    }
+}
+
+/*
+sampling timer expired, read and re-arm while the resource is observed
+*/
+static void on_sample_timer(int32_t timer, void * /*context*/)
+{
+    LWM2M_sensor_source *sensor = &sensors[timer];
+    if (!sensor->read || !LWM2M_resource_observed(timer)){
+        return; // idle until LWM2M_sensor_resume
+    }
+    uint32_t now = LWM2M_clock_ms();
+    uint32_t hold_ms = LWM2M_resource_hold_ms(timer, now);
+    if (hold_ms){
+        // no observation evaluates a value before the end of its epmin
+        LWM2M_timer_arm(&sample_wheel, timer, hold_ms, now);
+        return;
+    }
+    if (planned(sensor)){
+        if (sensor->reads == sensor->planned_reads){
+            sensor_update(timer, read_sensor(timer, now));
+        } // else a report read the sensor since, only plan again
+        plan_next(timer, now);
+        return;
+    }
+    sensor_update(timer, read_sensor(timer, now));
+    if (sensor->period_ms){
+        LWM2M_timer_arm(&sample_wheel, timer, sensor->period_ms, now);
+    }
+}
+
+bool LWM2M_sensor_register(uint16_t resource, LWM2M_sensor_read read, void *context, uint32_t period_ms)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return false;
+    }
+    if (!sample_wheel_ready){
+        LWM2M_timer_wheel_init(&sample_wheel, sample_timers, LWM2M_MAX_RESOURCES, 
+            LWM2M_TIMER_TICK_MS, LWM2M_clock_ms(), &on_sample_timer, NULL);
+        sample_wheel_ready = true;
+    }
+    sensors[resource].read = read;
+    sensors[resource].context = context;
+    sensors[resource].period_ms = period_ms;
+    sensors[resource].pushed = false;
+    sensors[resource].reads = sensors[resource].planned_reads = 0;
+    LWM2M_plan_init(&sensors[resource].plan, period_ms, period_ms);
+    if (read){
+        sensors[resource].value = read_sensor(resource, LWM2M_clock_ms());
+    }
+    LWM2M_timer_cancel(&sample_wheel, resource); // a new source starts its own schedule
+    LWM2M_sensor_resume(resource);
+    return true;
+}
+
+void LWM2M_sensor_set_period(uint16_t resource, uint32_t period_ms)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return;
+    }
+    sensors[resource].period_ms = period_ms;
+    LWM2M_plan_init(&sensors[resource].plan, period_ms, sensors[resource].plan.max_period_ms);
+    if (period_ms == 0){
+        LWM2M_timer_cancel(&sample_wheel, resource);
+    }
+    else{
+        LWM2M_sensor_resume(resource);
+    }
+}
+
+void LWM2M_sensor_set_max_period(uint16_t resource, uint32_t max_period_ms)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return;
+    }
+    LWM2M_plan_init(&sensors[resource].plan, sensors[resource].period_ms, max_period_ms);
+    LWM2M_sensor_resume(resource);
+}
+
+void LWM2M_sensor_resume(uint16_t resource)
+{
+    if (resource >= LWM2M_MAX_RESOURCES || !sensors[resource].read || !sensors[resource].period_ms){
+        return;
+    }
+    LWM2M_sensor_source *sensor = &sensors[resource];
+    if (LWM2M_resource_observed(resource) && (planned(sensor) || !LWM2M_timer_armed(&sample_wheel, resource))){
+        // a plan made for other attributes is dropped, the next read plans again
+        sensor->planned_reads = sensor->reads;
+        LWM2M_timer_arm(&sample_wheel, resource, sensor->period_ms, LWM2M_clock_ms());
+    }
+}
+
+void LWM2M_sensor_push(uint16_t resource, sample value)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return;
+    }
+    sensors[resource].pushed_value = value;
+    sensors[resource].pushed = true;
+    push_pending = true;
+    LWM2M_wakeup();
+}
+
+sample LWM2M_sensor_value(uint16_t resource)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return 0;
+    }
+    // a push not yet polled is still the latest value
+    return sensors[resource].pushed ? sensors[resource].pushed_value : sensors[resource].value;
+}
+
+sample LWM2M_sensor_cached_value(uint16_t resource, uint32_t now, uint32_t max_age_ms)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return 0;
+    }
+    LWM2M_sensor_source *sensor = &sensors[resource];
+    if (!sensor->read || sensor->pushed || now - sensor->read_ms < max_age_ms){
+        return LWM2M_sensor_value(resource);
+    }
+    // handed over like a push, on_update must not run from inside a report
+    sensor->pushed_value = read_sensor(resource, now);
+    sensor->pushed = true;
+    push_pending = true;
+    LWM2M_wakeup();
+    return sensor->pushed_value;
+}
+
+sample LWM2M_sensor_fresh_value(uint16_t resource, uint32_t now)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return 0;
+    }
+    return LWM2M_sensor_cached_value(resource, now, sensors[resource].period_ms);
+}
+
+uint32_t LWM2M_sensor_changes(void)
+{
+    return value_changes;
+}
+
+uint32_t LWM2M_sensor_valid_ms(uint16_t resource, uint32_t now)
+{
+    if (resource >= LWM2M_MAX_RESOURCES){
+        return 0;
+    }
+    if (!sensors[resource].read){
+        return UINT32_MAX;
+    }
+    uint32_t next_ms;
+    if (!sample_wheel_ready || !LWM2M_timer_expiry(&sample_wheel, resource, &next_ms)){
+        return 0;
+    }
+    return ((int32_t)(next_ms - now) > 0) ? next_ms - now : 0;
+}
+
+void LWM2M_sensor_poll(uint32_t now)
+{
+    if (push_pending){
+        push_pending = false;
+        for (uint16_t resource = 0; resource < LWM2M_MAX_RESOURCES; resource++){
+            if (sensors[resource].pushed){
+                sensors[resource].pushed = false;
+                sensor_update(resource, sensors[resource].pushed_value);
+            }
+        }
+    }
+    if (sample_wheel_ready){
+        LWM2M_timer_wheel_advance(&sample_wheel, now);
+    }
+}
+
+bool LWM2M_sensor_next_tick(uint32_t *next_ms)
+{
+    return sample_wheel_ready && LWM2M_timer_wheel_next(&sample_wheel, next_ms);
+}
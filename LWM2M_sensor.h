@@ -0,0 +1,102 @@
+/*
+LWM2M sensor sources
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Event driven sensor ingestion for the attribute engine.
+
+A sensor source feeds one resource, either by being sampled with its read
+function every period_ms, or by the driver pushing values with
+LWM2M_sensor_push() (e.g. from a conversion complete interrupt). Sampling
+only runs while the resource is observed; changed values go to on_update
+through LWM2M_resource_update.
+
+With a max_period_ms above period_ms sampling is planned instead: the
+sensor is read when the attributes of its observations may find a new
+value reportable (see LWM2M_sample_plan.h), and pmax and pmin reports read
+it on demand through LWM2M_sensor_fresh_value. A signal far from its band
+and step edges, or observed with pmin and pmax alone, is read a few times
+per pmax instead of every period_ms.
+
+While every observation of the resource is within its epmin no read is
+taken, the next one waits for the first epmin to end.
+
+Nothing here polls. The platform thread sleeps until LWM2M_sensor_next_tick
+or LWM2M_obs_next_tick, whichever is earlier, or until LWM2M_wakeup() is
+called by a push.
+*/
+
+#ifndef LWM2M_SENSOR_H
+#define LWM2M_SENSOR_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// read the sensor, converted to the resource units
+typedef sample (*LWM2M_sensor_read)(void *context);
+
+/*
+register a sensor for a resource, period_ms 0 means push only
+*/
+bool LWM2M_sensor_register(uint16_t resource, LWM2M_sensor_read read, void *context, uint32_t period_ms);
+void LWM2M_sensor_set_period(uint16_t resource, uint32_t period_ms);
+
+// planned sampling, at most every period_ms and at least every max_period_ms.
+// A max_period_ms of period_ms or less returns to sampling every period_ms.
+void LWM2M_sensor_set_max_period(uint16_t resource, uint32_t max_period_ms);
+
+// (re)start periodic sampling, call when an observation of the resource starts.
+// Planned sampling is also re-planned, call it when attributes are written.
+void LWM2M_sensor_resume(uint16_t resource);
+
+// new value from a driver, callable from ISR context
+void LWM2M_sensor_push(uint16_t resource, sample value);
+
+// latest value of a resource
+sample LWM2M_sensor_value(uint16_t resource);
+
+/*
+latest value of a resource, read first if the last read is max_age_ms or
+more before now, e.g. for a GET answered with a Max-Age. A value read here
+is evaluated by the observations at the next LWM2M_sensor_poll, as a push.
+*/
+sample LWM2M_sensor_cached_value(uint16_t resource, uint32_t now, uint32_t max_age_ms);
+
+// latest value, read first if older than period_ms, what get_sample returns
+sample LWM2M_sensor_fresh_value(uint16_t resource, uint32_t now);
+
+// counts the changes of the values of all resources, for caches of values
+uint32_t LWM2M_sensor_changes(void);
+
+/*
+how long from now the latest value stays the latest: until the next read
+while the resource is sampled, UINT32_MAX for a push only source, 0 if the
+sensor is not being read
+*/
+uint32_t LWM2M_sensor_valid_ms(uint16_t resource, uint32_t now);
+
+// run due sampling and deliver pushed values, in thread context
+void LWM2M_sensor_poll(uint32_t now);
+
+// when LWM2M_sensor_poll next has sampling to do, false if none
+bool LWM2M_sensor_next_tick(uint32_t *next_ms);
+
+/*
+Platform hook, wake the thread that calls LWM2M_sensor_poll. ISR safe.
+*/
+void LWM2M_wakeup(void);
+
+#endif // LWM2M_SENSOR_H
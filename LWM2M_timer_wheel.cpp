@@ -0,0 +1,251 @@
+/*
+LWM2M timer wheel
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+A timer in level L is in the slot selected by bits [6L, 6L+6) of its expiry
+tick. When the low 6L bits of the current tick wrap to zero, the matching
+slot of level L is cascaded: its timers are re-inserted relative to the
+current tick and move down one or more levels. Level 0 slots are expired
+directly.
+*/
+
+#include "LWM2M_timer_wheel.h"
+
+#define TIMER_UNARMED INT32_MIN
+#define SLOT_MASK (LWM2M_TIMER_SLOTS - 1)
+#define MAX_DELTA ((1UL << (LWM2M_TIMER_LEVELS * LWM2M_TIMER_SLOT_BITS)) - 1)
+
+/*
+slot heads use negative indexes so that timers and heads share one link format
+*/
+static LWM2M_timer *node(LWM2M_timer_wheel *wheel, int32_t index)
+{
+    return (index >= 0) ? &wheel->timers[index] : &wheel->slots[-1 - index];
+}
+
+static int32_t head_index(int level, int slot)
+{
+    return -1 - (level * LWM2M_TIMER_SLOTS + slot);
+}
+
+static void unlink_timer(LWM2M_timer_wheel *wheel, int32_t timer)
+{
+    LWM2M_timer *t = &wheel->timers[timer];
+    node(wheel, t->prev)->next = t->next;
+    node(wheel, t->next)->prev = t->prev;
+    t->next = t->prev = TIMER_UNARMED;
+    wheel->pending--;
+}
+
+/*
+place a timer in the slot for its expiry tick, expires must not be before
+the current tick
+*/
+static void insert_timer(LWM2M_timer_wheel *wheel, int32_t timer)
+{
+    LWM2M_timer *t = &wheel->timers[timer];
+    uint32_t delta = t->expires - wheel->current;
+    uint32_t slot_tick = t->expires;
+    int level = 0;
+
+    if (delta > MAX_DELTA){
+        // beyond the wheel range, park it and re-insert when it cascades
+        delta = MAX_DELTA;
+        slot_tick = wheel->current + MAX_DELTA;
+    }
+    while (level < LWM2M_TIMER_LEVELS - 1 && delta >= (1UL << ((level + 1) * LWM2M_TIMER_SLOT_BITS))){
+        level++;
+    }
+    int32_t head = head_index(level, (slot_tick >> (level * LWM2M_TIMER_SLOT_BITS)) & SLOT_MASK);
+    LWM2M_timer *h = node(wheel, head);
+
+    t->next = head;
+    t->prev = h->prev;
+    node(wheel, h->prev)->next = timer;
+    h->prev = timer;
+    wheel->pending++;
+}
+
+void LWM2M_timer_wheel_init(LWM2M_timer_wheel *wheel, LWM2M_timer *timers, int32_t num_timers,
+    uint32_t tick_ms, uint32_t now_ms, void (*expired)(int32_t timer, void *context), void *context)
+{
+    wheel->timers = timers;
+    wheel->num_timers = num_timers;
+    wheel->pending = 0;
+    wheel->tick_ms = tick_ms ? tick_ms : 1;
+    wheel->current = 0;
+    wheel->current_ms = now_ms;
+    wheel->expired = expired;
+    wheel->context = context;
+    for (int32_t slot = 0; slot < LWM2M_TIMER_LEVELS * LWM2M_TIMER_SLOTS; slot++){
+        wheel->slots[slot].next = wheel->slots[slot].prev = -1 - slot;
+    }
+    for (int32_t timer = 0; timer < num_timers; timer++){
+        timers[timer].next = timers[timer].prev = TIMER_UNARMED;
+        timers[timer].expires = 0;
+    }
+}
+
+/*
+arm or re-arm, rounds up to whole ticks and never expires in the tick being processed.
+The delay counts from now_ms, not from the start of the current tick, which may
+be up to a tick or, between two advances, far behind: the time since is added
+before rounding up so that the timer never expires early.
+*/
+void LWM2M_timer_arm(LWM2M_timer_wheel *wheel, int32_t timer, uint32_t delay_ms, uint32_t now_ms)
+{
+    int32_t since_ms = (int32_t)(now_ms - wheel->current_ms);
+    since_ms = (since_ms > 0) ? since_ms : 0;
+    uint32_t ticks = (uint32_t)since_ms / wheel->tick_ms
+        + (delay_ms + (uint32_t)since_ms % wheel->tick_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+    if (wheel->timers[timer].next != TIMER_UNARMED){
+        unlink_timer(wheel, timer);
+    }
+    wheel->timers[timer].expires = wheel->current + (ticks ? ticks : 1);
+    insert_timer(wheel, timer);
+}
+
+void LWM2M_timer_cancel(LWM2M_timer_wheel *wheel, int32_t timer)
+{
+    if (wheel->timers[timer].next != TIMER_UNARMED){
+        unlink_timer(wheel, timer);
+    }
+}
+
+bool LWM2M_timer_armed(const LWM2M_timer_wheel *wheel, int32_t timer)
+{
+    return wheel->timers[timer].next != TIMER_UNARMED;
+}
+
+bool LWM2M_timer_expiry(const LWM2M_timer_wheel *wheel, int32_t timer, uint32_t *expires_ms)
+{
+    if (wheel->timers[timer].next == TIMER_UNARMED){
+        return false;
+    }
+    *expires_ms = wheel->current_ms + (wheel->timers[timer].expires - wheel->current) * wheel->tick_ms;
+    return true;
+}
+
+/*
+re-insert all timers of one upper level slot relative to the current tick
+*/
+static void cascade(LWM2M_timer_wheel *wheel, int level)
+{
+    int32_t head = head_index(level, (wheel->current >> (level * LWM2M_TIMER_SLOT_BITS)) & SLOT_MASK);
+    LWM2M_timer *h = node(wheel, head);
+    while (h->next != head){
+        int32_t timer = h->next;
+        unlink_timer(wheel, timer);
+        insert_timer(wheel, timer);
+    }
+}
+
+/*
+the ticks elapsed since the current one started, from the clock difference,
+the part of a tick left over is carried in current_ms
+*/
+void LWM2M_timer_wheel_advance(LWM2M_timer_wheel *wheel, uint32_t now_ms)
+{
+    int32_t elapsed_ms = (int32_t)(now_ms - wheel->current_ms);
+    if (elapsed_ms <= 0){
+        return;
+    }
+    uint32_t target = wheel->current + (uint32_t)elapsed_ms / wheel->tick_ms;
+
+    while ((int32_t)(target - wheel->current) > 0){
+        if (wheel->pending == 0){
+            // nothing armed, skip the idle period
+            wheel->current_ms += (target - wheel->current) * wheel->tick_ms;
+            wheel->current = target;
+            return;
+        }
+        wheel->current++;
+        wheel->current_ms += wheel->tick_ms;
+
+        // cascade upper levels whose lower bits just wrapped
+        for (int level = 1; level < LWM2M_TIMER_LEVELS; level++){
+            if (wheel->current & ((1UL << (level * LWM2M_TIMER_SLOT_BITS)) - 1)){
+                break;
+            }
+            cascade(wheel, level);
+        }
+
+        // expire level 0, handlers may arm or cancel any timer including
+        // ones still in this slot, armed timers never land in this slot
+        int32_t head = head_index(0, wheel->current & SLOT_MASK);
+        LWM2M_timer *h = node(wheel, head);
+        while (h->next != head){
+            int32_t timer = h->next;
+            unlink_timer(wheel, timer);
+            if ((int32_t)(wheel->timers[timer].expires - wheel->current) > 0){
+                insert_timer(wheel, timer);
+                continue;
+            }
+            wheel->expired(timer, wheel->context);
+        }
+    }
+}
+
+/*
+earliest expiry of the timers of one slot, as ticks from the current one
+*/
+static uint32_t slot_earliest(const LWM2M_timer_wheel *wheel, int level, int slot)
+{
+    int32_t head = head_index(level, slot);
+    uint32_t earliest = UINT32_MAX;
+    for (int32_t timer = wheel->slots[-1 - head].next; timer != head; timer = wheel->timers[timer].next){
+        uint32_t delta = wheel->timers[timer].expires - wheel->current;
+        earliest = (delta < earliest) ? delta : earliest;
+    }
+    return earliest;
+}
+
+/*
+the earliest expiry of any armed timer. Level 0 holds the next 63 ticks, a
+slot each, so its first non-empty slot is exact. A timer in an upper level
+expires at or after the cascade of its slot, and the slots of a level come
+due in order from the one after the current tick's, so the first non-empty
+one holds the earliest timers of the level. The top level also holds the
+timers parked beyond the wheel range, it is searched whole.
+*/
+bool LWM2M_timer_wheel_next(const LWM2M_timer_wheel *wheel, uint32_t *next_ms)
+{
+    if (wheel->pending == 0){
+        return false;
+    }
+    uint32_t earliest = UINT32_MAX;
+    for (uint32_t delta = 1; delta < LWM2M_TIMER_SLOTS; delta++){
+        int slot = (wheel->current + delta) & SLOT_MASK;
+        if (wheel->slots[slot].next != head_index(0, slot)){
+            earliest = delta;
+            break;
+        }
+    }
+    for (int level = 1; level < LWM2M_TIMER_LEVELS; level++){
+        uint32_t position = wheel->current >> (level * LWM2M_TIMER_SLOT_BITS);
+        bool top = level == LWM2M_TIMER_LEVELS - 1;
+        for (uint32_t i = 1; i <= LWM2M_TIMER_SLOTS; i++){
+            uint32_t level_earliest = slot_earliest(wheel, level, (position + i) & SLOT_MASK);
+            earliest = (level_earliest < earliest) ? level_earliest : earliest;
+            if (level_earliest != UINT32_MAX && !top){
+                break;
+            }
+        }
+    }
+    *next_ms = wheel->current_ms + earliest * wheel->tick_ms;
+    return true;
+}
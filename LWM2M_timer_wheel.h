@@ -0,0 +1,79 @@
+/*
+LWM2M timer wheel
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Hierarchical timer wheel used to drive the pmin quiet period and the pmax
+deadline of every observation from one tick source.
+
+4 levels of 64 slots each cover 2^24 ticks, longer delays are parked in the
+top level and re-inserted when they cascade. Arm, re-arm and cancel are O(1);
+each slot is an intrusive doubly linked list threaded through a timer array
+owned by the caller, so the wheel never allocates.
+
+The wheel is advanced with LWM2M_timer_wheel_advance(now) from whatever
+clock the platform has, a hardware ticker on the target or a simulated clock
+on the host. Ticks are counted from the differences of now between calls,
+so the wheel keeps running when the 32 bit ms clock wraps after 49.7 days,
+whether or not tick_ms divides 2^32.
+*/
+
+#ifndef LWM2M_TIMER_WHEEL_H
+#define LWM2M_TIMER_WHEEL_H
+
+#include <stdint.h>
+
+#define LWM2M_TIMER_LEVELS    4
+#define LWM2M_TIMER_SLOT_BITS 6
+#define LWM2M_TIMER_SLOTS     (1 << LWM2M_TIMER_SLOT_BITS)
+
+// one timer, indexes refer to other timers (>= 0) or to slot heads (< 0)
+struct LWM2M_timer {
+    uint32_t expires; // in ticks
+    int32_t next, prev;
+};
+
+struct LWM2M_timer_wheel {
+    LWM2M_timer *timers;
+    int32_t num_timers;
+    int32_t pending; // armed timers, lets advance skip idle periods
+    uint32_t current; // last processed tick
+    uint32_t current_ms; // clock time at which the current tick started
+    uint32_t tick_ms;
+    void (*expired)(int32_t timer, void *context);
+    void *context;
+    LWM2M_timer slots[LWM2M_TIMER_LEVELS * LWM2M_TIMER_SLOTS]; // list heads
+};
+
+void LWM2M_timer_wheel_init(LWM2M_timer_wheel *wheel, LWM2M_timer *timers, int32_t num_timers,
+    uint32_t tick_ms, uint32_t now_ms, void (*expired)(int32_t timer, void *context), void *context);
+
+// arm or re-arm a timer to expire no earlier than delay_ms after now_ms (same clock as advance)
+void LWM2M_timer_arm(LWM2M_timer_wheel *wheel, int32_t timer, uint32_t delay_ms, uint32_t now_ms);
+void LWM2M_timer_cancel(LWM2M_timer_wheel *wheel, int32_t timer);
+bool LWM2M_timer_armed(const LWM2M_timer_wheel *wheel, int32_t timer);
+
+// time (same clock as now_ms) at which an armed timer expires, false if not armed
+bool LWM2M_timer_expiry(const LWM2M_timer_wheel *wheel, int32_t timer, uint32_t *expires_ms);
+
+// process every tick up to now_ms, calling expired() for each due timer
+void LWM2M_timer_wheel_advance(LWM2M_timer_wheel *wheel, uint32_t now_ms);
+
+// time (same clock as now_ms) at which the earliest armed timer expires, so
+// the caller can sleep until then. false if no timer is armed.
+bool LWM2M_timer_wheel_next(const LWM2M_timer_wheel *wheel, uint32_t *next_ms);
+
+#endif // LWM2M_TIMER_WHEEL_H
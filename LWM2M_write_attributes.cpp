@@ -0,0 +1,249 @@
+/*
+LWM2M Write Attributes query parser
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+*/
+
+#include "LWM2M_write_attributes.h"
+#include <string.h>
+
+enum attribute_id {
+    ATTR_PMIN, ATTR_PMAX, ATTR_GT, ATTR_LT, ATTR_ST, ATTR_EPMIN, ATTR_EPMAX, ATTR_STAT, ATTR_HYST,
+    ATTR_DWELL, ATTR_CANCEL
+};
+
+struct attribute_name {
+    const char *name;
+    uint8_t len;
+    int8_t id; // -1 for an empty slot
+};
+
+/*
+perfect hash over the attribute names: (3 * len + first + 2 * last) mod 32 
+is unique for each name, a match is confirmed with one memcmp
+*/
+#define ATTR_HASH(name, len) ((3 * (len) + (name)[0] + ((name)[(len) - 1] << 1)) & 31)
+
+static const attribute_name attribute_table[32] = {
+    {0, 0, -1},
+    {"st", 2, ATTR_ST},         // 1
+    {0, 0, -1}, {0, 0, -1},
+    {"epmax", 5, ATTR_EPMAX},   // 4
+    {0, 0, -1}, {0, 0, -1},
+    {"stat", 4, ATTR_STAT},     // 7
+    {0, 0, -1}, {0, 0, -1}, {0, 0, -1},
+    {"dwell", 5, ATTR_DWELL},   // 11
+    {"pmax", 4, ATTR_PMAX},     // 12
+    {"cancel", 6, ATTR_CANCEL}, // 13
+    {0, 0, -1}, {0, 0, -1},
+    {"epmin", 5, ATTR_EPMIN},   // 16
+    {0, 0, -1}, {0, 0, -1}, {0, 0, -1}, {0, 0, -1},
+    {"gt", 2, ATTR_GT},         // 21
+    {0, 0, -1}, {0, 0, -1},
+    {"pmin", 4, ATTR_PMIN},     // 24
+    {0, 0, -1},
+    {"lt", 2, ATTR_LT},         // 26
+    {0, 0, -1},
+    {"hyst", 4, ATTR_HYST},     // 28
+    {0, 0, -1}, {0, 0, -1}, {0, 0, -1}
+};
+
+static int lookup_attribute(const uint8_t *name, uint16_t len)
+{
+    if (len == 0 || len > 6){
+        return -1;
+    }
+    const attribute_name *entry = &attribute_table[ATTR_HASH(name, len)];
+    if (entry->len == len && memcmp(entry->name, name, len) == 0){
+        return entry->id;
+    }
+    return -1;
+}
+
+/*
+digits are accumulated as an integer mantissa and scaled once, which is
+exact for the short decimal values used in attributes
+*/
+bool LWM2M_parse_float(const uint8_t *text, uint16_t len, float *value)
+{
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    uint16_t i = 0;
+    bool negative = false;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+
+    if (i < len && (text[i] == '-' || text[i] == '+')){
+        negative = (text[i++] == '-');
+    }
+    for (; i < len && text[i] >= '0' && text[i] <= '9'; i++, digits++){
+        if (mantissa < 100000000000000000ULL){
+            mantissa = mantissa * 10 + (text[i] - '0');
+        }
+        else{
+            exponent++; // beyond precision, keep the magnitude
+        }
+    }
+    if (i < len && text[i] == '.'){
+        for (i++; i < len && text[i] >= '0' && text[i] <= '9'; i++, digits++){
+            if (mantissa < 100000000000000000ULL){
+                mantissa = mantissa * 10 + (text[i] - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0){
+        return false;
+    }
+    if (i < len && (text[i] == 'e' || text[i] == 'E')){
+        bool exp_negative = false;
+        int exp = 0, exp_digits = 0;
+        i++;
+        if (i < len && (text[i] == '-' || text[i] == '+')){
+            exp_negative = (text[i++] == '-');
+        }
+        for (; i < len && text[i] >= '0' && text[i] <= '9'; i++, exp_digits++){
+            if (exp < 1000){
+                exp = exp * 10 + (text[i] - '0');
+            }
+        }
+        if (exp_digits == 0){
+            return false;
+        }
+        exponent += exp_negative ? -exp : exp;
+    }
+    if (i != len){
+        return false;
+    }
+
+    double result = (double)mantissa;
+    while (exponent > 0){
+        int step = exponent > 18 ? 18 : exponent;
+        result *= pow10[step];
+        exponent -= step;
+    }
+    while (exponent < 0){
+        int step = -exponent > 18 ? 18 : -exponent;
+        result /= pow10[step];
+        exponent += step;
+    }
+    if (result > 3.4e38){
+        return false;
+    }
+    *value = (float)(negative ? -result : result);
+    return true;
+}
+
+/*
+value of an attribute, or its default when written without a value
+*/
+static bool attribute_value(int id, const uint8_t *value, uint16_t value_len, bool has_value, float *out)
+{
+    static const float defaults[] = {D_PMIN, D_PMAX, D_GT, D_LT, D_STEP, D_EPMIN, D_EPMAX, D_STATISTICS, D_HYST, D_DWELL};
+    if (!has_value){
+        *out = defaults[id];
+        return true;
+    }
+    return LWM2M_parse_float(value, value_len, out);
+}
+
+int LWM2M_parse_write_attributes(const uint8_t *query, uint16_t query_len,
+    const LWM2M_attributes *current, LWM2M_attributes *result, bool *cancel)
+{
+    int found = 0;
+    uint16_t pos = 0;
+
+    *result = *current;
+    *cancel = false;
+
+    while (pos < query_len){
+        // one name[=value] option, up to '&' or the end
+        uint16_t start = pos, equals = 0;
+        bool has_value = false;
+        while (pos < query_len && query[pos] != '&'){
+            if (query[pos] == '=' && !has_value){
+                equals = pos;
+                has_value = true;
+            }
+            pos++;
+        }
+        uint16_t name_len = (has_value ? equals : pos) - start;
+        const uint8_t *value = query + equals + 1;
+        uint16_t value_len = has_value ? pos - equals - 1 : 0;
+        if (pos < query_len){
+            pos++; // skip '&'
+        }
+
+        int id = lookup_attribute(query + start, name_len);
+        if (id < 0){
+            continue; // not a notification attribute
+        }
+        found++;
+        if (id == ATTR_CANCEL){
+            *cancel = true;
+            continue;
+        }
+        float v;
+        if (!attribute_value(id, value, value_len, has_value, &v)){
+            return LWM2M_ATTR_ERR_VALUE;
+        }
+        switch (id){
+        case ATTR_PMIN: result->pmin = v; break;
+        case ATTR_PMAX: result->pmax = v; break;
+        case ATTR_GT: result->gt = v; result->num_limits = 0; break;
+        case ATTR_LT: result->lt = v; result->num_limits = 0; break;
+        case ATTR_ST: result->step = v; break;
+        case ATTR_EPMIN: result->epmin = v; break;
+        case ATTR_EPMAX: result->epmax = v; break;
+        case ATTR_STAT:
+            // LWM2M_STAT_* bits as an integer
+            if (v < 0 || v > 255 || v != (float)(int)v){
+                return LWM2M_ATTR_ERR_VALUE;
+            }
+            result->statistics = (uint8_t)v;
+            break;
+        case ATTR_HYST: result->hysteresis = v; break;
+        case ATTR_DWELL: result->dwell = v; break;
+        }
+    }
+
+    if (!found){
+        return LWM2M_ATTR_ERR_NONE;
+    }
+    // periods are seconds and steps are magnitudes
+    if (result->pmin < 0 || result->pmax < 0 || result->epmin < 0 || result->epmax < 0 || result->step < 0
+        || result->hysteresis < 0 || result->dwell < 0){
+        return LWM2M_ATTR_ERR_VALUE;
+    }
+    if (result->pmin > LWM2M_MAX_PERIOD_S || result->pmax > LWM2M_MAX_PERIOD_S || result->epmin > LWM2M_MAX_PERIOD_S
+        || result->epmax > LWM2M_MAX_PERIOD_S || result->dwell > LWM2M_MAX_PERIOD_S){
+        return LWM2M_ATTR_ERR_VALUE;
+    }
+    // pmax 0 means no maximum period, likewise for epmax
+    if (result->pmax > 0 && result->pmin > result->pmax){
+        return LWM2M_ATTR_ERR_PMIN_PMAX;
+    }
+    if (result->epmax > 0 && result->epmin > result->epmax){
+        return LWM2M_ATTR_ERR_EPMIN_EPMAX;
+    }
+    // lt and gt are not used while application band limits are set
+    if (result->num_limits == 0 
+        && (result->lt >= result->gt || result->lt + 2 * result->step >= result->gt)){
+        return LWM2M_ATTR_ERR_LT_GT;
+    }
+    return LWM2M_ATTR_OK;
+}
@@ -0,0 +1,57 @@
+/*
+LWM2M Write Attributes query parser
+------------------------------------------------
+Copyright (c) 2006-2015 ARM Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+------------------------------------------------
+
+Parses the Uri-Query of a Write Attributes PUT, e.g. "pmin=10&pmax=60&st=1",
+in one pass over the raw option bytes, without copying or allocating.
+
+Recognized attributes are pmin, pmax, gt, lt, st, epmin, epmax and cancel,
+and stat, the LWM2M_STAT_* bits of the statistics reported along with the
+value, hyst, the hysteresis of lt and gt, and dwell, which are particular to
+this implementation.
+An attribute without a value ("?pmin") is reset to its default. Unknown
+attribute names are ignored, but at least one known attribute is required.
+The result is validated as a whole against the current attributes before
+anything is applied.
+*/
+
+#ifndef LWM2M_WRITE_ATTRIBUTES_H
+#define LWM2M_WRITE_ATTRIBUTES_H
+
+#include <stdint.h>
+#include "LWM2M_resource_attributes.h"
+
+// parse results, 4.00 Bad Request for anything but LWM2M_ATTR_OK
+#define LWM2M_ATTR_OK               0
+#define LWM2M_ATTR_ERR_NONE         -1 // no known attribute in the query
+#define LWM2M_ATTR_ERR_VALUE        -2 // value is not a number or out of range
+#define LWM2M_ATTR_ERR_LT_GT        -3 // lt >= gt, or lt + 2*st >= gt
+#define LWM2M_ATTR_ERR_PMIN_PMAX    -4 // pmin > pmax
+#define LWM2M_ATTR_ERR_EPMIN_EPMAX  -5 // epmin > epmax
+
+/*
+parse query (query_len bytes, not terminated) into result, starting from
+current. cancel is set if the cancel attribute is present.
+result is only meaningful when LWM2M_ATTR_OK is returned.
+*/
+int LWM2M_parse_write_attributes(const uint8_t *query, uint16_t query_len,
+    const LWM2M_attributes *current, LWM2M_attributes *result, bool *cancel);
+
+// decimal number with optional sign, fraction and exponent, false if invalid
+bool LWM2M_parse_float(const uint8_t *text, uint16_t len, float *value);
+
+#endif // LWM2M_WRITE_ATTRIBUTES_H